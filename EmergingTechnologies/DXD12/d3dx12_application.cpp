@@ -1,5 +1,9 @@
 #include "d3dx12_application.h"
 
+d3dx12_application::d3dx12_application(const std::string& statistics_path) : statistics_path_(statistics_path)
+{
+}
+
 void d3dx12_application::run()
 {
 	initialize_window();
@@ -294,7 +298,10 @@ void d3dx12_application::wait_for_previous_frame()
 void d3dx12_application::update_pipeline()
 {
 	//wait for the previous frame to finish rendering
+	const auto acquire_start = std::chrono::high_resolution_clock::now();
 	wait_for_previous_frame();
+	frame_timings_.acquire_wait_ms = frame_statistics::elapsed_ms(acquire_start,
+	                                                              std::chrono::high_resolution_clock::now());
 
 	//reset the allocated command list for this frame
 	command_allocator_[frame_index_]->Reset();
@@ -339,11 +346,15 @@ void d3dx12_application::render()
 	//obtain the command list
 	ID3D12CommandList* id3_d12_command_lists[] = {command_list_};
 	//execute each command list
+	const auto submit_start = std::chrono::high_resolution_clock::now();
 	command_queue_->ExecuteCommandLists(_countof(id3_d12_command_lists), id3_d12_command_lists);
 	//signal that the frame has finished rendering
 	command_queue_->Signal(fence_[frame_index_], fence_value_[frame_index_]);
+	const auto present_start = std::chrono::high_resolution_clock::now();
+	frame_timings_.submit_ms = frame_statistics::elapsed_ms(submit_start, present_start);
 	//present the framge
 	swap_chain_->Present(0, 0);
+	frame_timings_.present_ms = frame_statistics::elapsed_ms(present_start, std::chrono::high_resolution_clock::now());
 }
 
 void d3dx12_application::cleanup()
@@ -376,6 +387,9 @@ void d3dx12_application::cleanup()
 
 void d3dx12_application::mainloop()
 {
+	frame_statistics_.init("d3d12");
+	auto frame_start = std::chrono::high_resolution_clock::now();
+
 	auto running = true;
 	while (running)
 	{
@@ -387,6 +401,21 @@ void d3dx12_application::mainloop()
 		}
 		//render the frame
 		render();
+
+		//the frame time runs from the start of one frame to the start of the next
+		const auto frame_end = std::chrono::high_resolution_clock::now();
+		frame_timings_.cpu_frame_ms = frame_statistics::elapsed_ms(frame_start, frame_end);
+		frame_statistics_.record(frame_timings_);
+		frame_timings_ = frame_record();
+		frame_start = frame_end;
+	}
+
+	//report the frame times, and export them for comparison with the vulkan example
+	frame_statistics_.print_summary(std::cout);
+	if (!statistics_path_.empty())
+	{
+		frame_statistics_.write_csv(statistics_path_ + ".csv");
+		frame_statistics_.write_json(statistics_path_ + ".json");
 	}
 }
 
@@ -38,6 +38,7 @@
 #include <SDL.h>
 #include <SDL_syswm.h>
 #include <iostream>
+#include "../Vulkan/frame_statistics.h"
 
 //define the safe_release macro which destroys a directx objects
 #define SAFE_RELEASE(p) { if ( (p) ) { (p)->Release(); (p) = 0; } }
@@ -56,6 +57,13 @@ struct vertex {
 class d3dx12_application
 {
 public:
+	/**
+	 * \brief Create the application
+	 * \param statistics_path the frame timings are written to this path with .csv and .json appended, nothing is
+	 * written if empty
+	 */
+	explicit d3dx12_application(const std::string& statistics_path = std::string());
+
 	void run();
 protected:
 	int width_ = 800;
@@ -82,6 +90,11 @@ private:
 	ID3D12Resource* vertex_buffer_;
 	D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view_;
 
+	//Records the CPU timings of every frame, in the same format as the vulkan example
+	frame_statistics frame_statistics_;
+	frame_record frame_timings_; //the timings of the frame being drawn
+	std::string statistics_path_;
+
 	/**
 	 * \brief Create the SDL2 window and obtain the win32 handle of it
 	 * \return 
@@ -6,7 +6,9 @@
 */
 int main(int argc, char * argv[])
 {
-	d3dx12_application app;
+	//--stats <path> writes the frame timings to path.csv and path.json
+	const auto write_statistics = argc == 3 && std::string(argv[1]) == "--stats";
+	d3dx12_application app(write_statistics ? argv[2] : std::string());
 
 	try
 	{
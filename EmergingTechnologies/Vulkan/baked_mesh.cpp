@@ -0,0 +1,320 @@
+#include "baked_mesh.h"
+#include "mesh_optimizer.h"
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+//the first bytes of every baked file, and the version of the layout in baked_mesh.h
+static const char baked_mesh_magic[4] = {'V', 'K', 'M', 'B'};
+static const uint32_t baked_mesh_version = 1;
+
+//the draw table is read in place from the mapping, so it has to start aligned
+static_assert(sizeof(baked_mesh_header) % 8 == 0, "the draw table must follow the header aligned");
+static_assert(sizeof(baked_mesh_draw) % 8 == 0, "the draw table entries must be aligned");
+
+/**
+* \brief Round an offset up to a multiple of an alignment
+* \param offset the offset
+* \param alignment the alignment, a power of 2
+* \return the aligned offset
+*/
+static uint64_t align(const uint64_t offset, const uint64_t alignment)
+{
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+* \brief Read the elements of an accessor, dropping anything interleaved with them
+* \param accessor the accessor
+* \param data the elements
+*/
+template <typename T>
+static void read_elements(const gltf_accessor& accessor, std::vector<T>& data)
+{
+	data.resize(accessor.count);
+	for (uint32_t i = 0; i < accessor.count; i++)
+	{
+		memcpy(&data[i], accessor.data + static_cast<size_t>(i) * accessor.stride, sizeof(T));
+	}
+}
+
+/**
+* \brief A primitive read out of a scene into packed streams
+*/
+struct baked_primitive
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<uint32_t> indices;
+	uint32_t index_size; //the size of the indices in the file, the size they had in the scene
+};
+
+/**
+* \brief Call a function on ranges of indices, on the threads of a job system if there is one
+* \param jobs the job system, or null to call the function once on the calling thread
+* \param count the number of indices
+* \param function called with the first and one past the last index of each range
+*/
+static void for_each_range(job_system* jobs, const size_t count, const std::function<void(size_t, size_t)>& function)
+{
+	if (jobs == nullptr)
+	{
+		function(0, count);
+	}
+	else
+	{
+		jobs->parallel_for(0, count, 1, function);
+	}
+}
+
+void baked_mesh::bake(const gltf_model& model, const std::string& path, const bool optimize, const bool quantize,
+                      std::ostream* report, job_system* jobs)
+{
+	//check every primitive first, so nothing is read unless the whole scene can be baked
+	std::vector<const gltf_primitive*> sources;
+	std::vector<const std::string*> mesh_names;
+	for (const auto& mesh : model.get_meshes())
+	{
+		for (const auto& primitive : mesh.primitives)
+		{
+			if (primitive.position.component_type != gltf_float || primitive.position.component_count != 3 ||
+				primitive.normal.component_type != gltf_float || primitive.normal.component_count != 3)
+			{
+				throw std::runtime_error("baked primitives must have float3 positions and normals!");
+			}
+			if (primitive.indices.component_type != gltf_unsigned_short &&
+				primitive.indices.component_type != gltf_unsigned_int)
+			{
+				throw std::runtime_error("baked primitives must have 16 or 32 bit indices!");
+			}
+			if (primitive.normal.count != primitive.position.count)
+			{
+				throw std::runtime_error("baked primitives must have a normal for every position!");
+			}
+			sources.push_back(&primitive);
+			mesh_names.push_back(&mesh.name);
+		}
+	}
+
+	//the primitives are independent, so each is read and optimized as a task of its own. The reports are kept and
+	//printed afterwards in the order of the primitives
+	std::vector<baked_primitive> primitives(sources.size());
+	std::vector<std::string> reports(sources.size());
+	for_each_range(jobs, sources.size(), [&](const size_t first, const size_t last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto& primitive = *sources[i];
+			auto& baked = primitives[i];
+			read_elements(primitive.position, baked.positions);
+			read_elements(primitive.normal, baked.normals);
+			baked.index_size = primitive.indices.get_element_size();
+			if (baked.index_size == 2)
+			{
+				std::vector<uint16_t> indices;
+				read_elements(primitive.indices, indices);
+				baked.indices.assign(indices.begin(), indices.end());
+			}
+			else
+			{
+				read_elements(primitive.indices, baked.indices);
+			}
+
+			//reorder the triangles for the vertex cache, then to reduce overdraw, and the vertices for fetching
+			const auto before = analyze_vertex_cache(baked.indices, baked.positions.size());
+			if (optimize)
+			{
+				const auto boundaries = optimize_vertex_cache(baked.indices, baked.positions.size());
+				optimize_overdraw(baked.indices, baked.positions, boundaries);
+				const auto remap = optimize_vertex_fetch(baked.indices, baked.positions.size());
+				remap_vertices(baked.positions, remap);
+				remap_vertices(baked.normals, remap);
+			}
+			const auto after = analyze_vertex_cache(baked.indices, baked.positions.size());
+
+			if (report != nullptr)
+			{
+				std::ostringstream line;
+				line << std::fixed << std::setprecision(3) << *mesh_names[i] << ": " << baked.indices.size() / 3 <<
+					" triangles, " << baked.positions.size() << " vertices, ACMR " << before.acmr << " -> " <<
+					after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+				reports[i] = line.str();
+			}
+		}
+	});
+	if (report != nullptr)
+	{
+		for (const auto& line : reports)
+		{
+			*report << line;
+		}
+	}
+
+	//lay the draws out the same way the renderer lays out a glTF scene, but with every stream packed
+	std::vector<baked_mesh_draw> draws;
+	uint64_t vertex_data_size = 0;
+	uint64_t index_data_size = 0;
+	for (const auto& primitive : primitives)
+	{
+		baked_mesh_draw draw = {};
+		draw.position_offset = align(vertex_data_size, 16);
+		if (quantize)
+		{
+			draw.normal_offset = draw.position_offset;
+			vertex_data_size = draw.position_offset + primitive.positions.size() * quantized_mesh_layout::get_stride();
+		}
+		else
+		{
+			vertex_data_size = draw.position_offset + primitive.positions.size() * sizeof(glm::vec3);
+			draw.normal_offset = align(vertex_data_size, 16);
+			vertex_data_size = draw.normal_offset + primitive.normals.size() * sizeof(glm::vec3);
+		}
+		draw.vertex_count = static_cast<uint32_t>(primitive.positions.size());
+		draw.index_size = primitive.index_size;
+		draw.index_count = static_cast<uint32_t>(primitive.indices.size());
+		draw.index_offset = align(index_data_size, 4);
+		index_data_size = draw.index_offset + static_cast<uint64_t>(draw.index_count) * draw.index_size;
+		draws.push_back(draw);
+	}
+
+	baked_mesh_header header = {};
+	memcpy(header.magic, baked_mesh_magic, sizeof(header.magic));
+	header.version = baked_mesh_version;
+	header.draw_count = static_cast<uint32_t>(draws.size());
+	header.vertex_format = quantize ? baked_vertex_format_quantized : baked_vertex_format_float;
+	memcpy(header.bounds_min, &model.get_bounds_min()[0], sizeof(header.bounds_min));
+	memcpy(header.bounds_max, &model.get_bounds_max()[0], sizeof(header.bounds_max));
+	header.vertex_data_offset = align(sizeof(header) + draws.size() * sizeof(baked_mesh_draw), 16);
+	header.vertex_data_size = vertex_data_size;
+	header.index_data_offset = align(header.vertex_data_offset + vertex_data_size, 16);
+	header.index_data_size = index_data_size;
+
+	//build the whole file in memory, the padding between blocks is left as zeros
+	std::vector<char> data(static_cast<size_t>(header.index_data_offset + index_data_size));
+	memcpy(data.data(), &header, sizeof(header));
+	memcpy(data.data() + sizeof(header), draws.data(), draws.size() * sizeof(baked_mesh_draw));
+
+	//quantized positions are relative to the bounds of the whole file, so the renderer needs one scale and bias
+	const auto position_scale = (model.get_bounds_max() - model.get_bounds_min()) * 0.5F;
+	const auto position_bias = (model.get_bounds_max() + model.get_bounds_min()) * 0.5F;
+
+	const auto vertex_data = data.data() + header.vertex_data_offset;
+	const auto index_data = data.data() + header.index_data_offset;
+
+	//every primitive is written to its own part of the file, so they are encoded in parallel too
+	for_each_range(jobs, primitives.size(), [&](const size_t first, const size_t last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto& primitive = primitives[i];
+			if (quantize)
+			{
+				for (size_t vertex = 0; vertex < primitive.positions.size(); vertex++)
+				{
+					const auto destination = vertex_data + draws[i].position_offset + vertex *
+						quantized_mesh_layout::get_stride();
+					quantized_mesh_layout::write<0>(destination, vertex_attribute_snorm16_position::encode(
+						                                primitive.positions[vertex], position_scale, position_bias));
+					quantized_mesh_layout::write<1>(destination, vertex_attribute_oct_normal::encode(
+						                                primitive.normals[vertex]));
+				}
+			}
+			else
+			{
+				memcpy(vertex_data + draws[i].position_offset, primitive.positions.data(),
+				       primitive.positions.size() * sizeof(glm::vec3));
+				memcpy(vertex_data + draws[i].normal_offset, primitive.normals.data(),
+				       primitive.normals.size() * sizeof(glm::vec3));
+			}
+
+			//the indices go back to the size they had in the scene
+			for (size_t index = 0; index < primitive.indices.size(); index++)
+			{
+				const auto destination = index_data + draws[i].index_offset + index * primitive.index_size;
+				if (primitive.index_size == 2)
+				{
+					const auto value = static_cast<uint16_t>(primitive.indices[index]);
+					memcpy(destination, &value, sizeof(value));
+				}
+				else
+				{
+					memcpy(destination, &primitive.indices[index], sizeof(uint32_t));
+				}
+			}
+		}
+	});
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open() || !file.write(data.data(), data.size()))
+	{
+		throw std::runtime_error("failed to write " + path + "!");
+	}
+}
+
+void baked_mesh::open(const std::string& path)
+{
+	close();
+	file_.open(path);
+
+	//the mapping starts on a page boundary, so the header and draw table can be read in place
+	header_ = reinterpret_cast<const baked_mesh_header*>(file_.data());
+	if (file_.size() < sizeof(baked_mesh_header) || memcmp(header_->magic, baked_mesh_magic, sizeof(header_->magic))
+		!= 0)
+	{
+		close();
+		throw std::runtime_error(path + " is not a baked mesh!");
+	}
+	if (header_->version != baked_mesh_version || (header_->vertex_format != baked_vertex_format_float &&
+		header_->vertex_format != baked_vertex_format_quantized))
+	{
+		close();
+		throw std::runtime_error(path + " was baked with a different version, bake it again!");
+	}
+
+	//everything the renderer reads has to be inside the file
+	const auto size = static_cast<uint64_t>(file_.size());
+	const auto table_end = sizeof(baked_mesh_header) + static_cast<uint64_t>(header_->draw_count) *
+		sizeof(baked_mesh_draw);
+	if (table_end > size || header_->vertex_data_offset % 16 != 0 || header_->index_data_offset % 16 != 0 ||
+		header_->vertex_data_offset > size || header_->vertex_data_size > size - header_->vertex_data_offset ||
+		header_->index_data_offset > size || header_->index_data_size > size - header_->index_data_offset)
+	{
+		close();
+		throw std::runtime_error(path + " is truncated or corrupt!");
+	}
+
+	draws_ = reinterpret_cast<const baked_mesh_draw*>(file_.data() + sizeof(baked_mesh_header));
+	const uint64_t vertex_size = header_->vertex_format == baked_vertex_format_quantized
+		                             ? quantized_mesh_layout::get_stride()
+		                             : sizeof(glm::vec3);
+	for (uint32_t i = 0; i < header_->draw_count; i++)
+	{
+		const auto& draw = draws_[i];
+		if ((draw.index_size != 2 && draw.index_size != 4) || draw.index_offset % draw.index_size != 0 ||
+			draw.index_offset + static_cast<uint64_t>(draw.index_count) * draw.index_size > header_->index_data_size ||
+			draw.position_offset + draw.vertex_count * vertex_size > header_->vertex_data_size ||
+			draw.normal_offset + draw.vertex_count * vertex_size > header_->vertex_data_size)
+		{
+			close();
+			throw std::runtime_error(path + " has an invalid draw table!");
+		}
+	}
+}
+
+void baked_mesh::close()
+{
+	file_.close();
+	header_ = nullptr;
+	draws_ = nullptr;
+}
+
+bool baked_mesh::is_baked_file(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	char magic[sizeof(baked_mesh_magic)] = {};
+	return file.read(magic, sizeof(magic)) && memcmp(magic, baked_mesh_magic, sizeof(magic)) == 0;
+}
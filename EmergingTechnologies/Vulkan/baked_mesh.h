@@ -0,0 +1,150 @@
+/**
+* \class baked_mesh
+*
+* \brief A scene converted offline into the layout the renderer draws from
+*
+* Parsing a glTF file means parsing JSON and resolving accessors on every launch, and the
+* vertex streams may be interleaved with data that is never drawn. A baked file has a fixed
+* header, a table with one entry per draw, then the vertex data and the index data. Each
+* data block starts on 16 bytes and already matches the renderer's vertex and index buffers,
+* with tightly packed float3 positions and normals, or interleaved quantized vertices. Loading
+* is a mapping and two uploads.
+* Baking is also where the mesh optimizer runs, so its cost is paid once rather than at startup.
+* Files are written in the byte order of the machine, which is little endian everywhere
+* the renderer runs.
+*/
+
+#ifndef BAKED_MESH_H
+#define BAKED_MESH_H
+
+#include "gltf_model.h"
+#include "job_system.h"
+#include "mapped_file.h"
+#include "vertex_layout.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+* \brief How the vertices of a baked file are stored
+*/
+enum baked_vertex_format : uint32_t
+{
+	baked_vertex_format_float = 0, //separate streams of float3 positions and float3 normals
+	baked_vertex_format_quantized = 1 //one stream of quantized_mesh_layout vertices
+};
+
+/**
+* \brief The layout of quantized vertices, 12 bytes instead of 24. Positions are relative to the bounds of the file,
+* scaled by half its size and offset by its centre
+*/
+typedef vertex_layout<vertex_attribute_snorm16_position, vertex_attribute_oct_normal> quantized_mesh_layout;
+
+/**
+* \brief The header at the start of a baked file
+*/
+struct baked_mesh_header
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t draw_count; //the number of entries in the draw table, which follows the header
+	uint32_t vertex_format; //one of baked_vertex_format
+	float bounds_min[3]; //the box around every position
+	float bounds_max[3];
+	uint64_t vertex_data_offset; //from the start of the file, a multiple of 16
+	uint64_t vertex_data_size;
+	uint64_t index_data_offset; //from the start of the file, a multiple of 16
+	uint64_t index_data_size;
+};
+
+/**
+* \brief An entry of the draw table, the offsets are from the start of the vertex or index data
+*/
+struct baked_mesh_draw
+{
+	uint64_t position_offset; //a multiple of 16, the start of the interleaved vertices when quantized
+	uint64_t normal_offset; //a multiple of 16, the same as position_offset when quantized
+	uint64_t index_offset; //a multiple of 4
+	uint32_t index_size; //2 or 4 bytes
+	uint32_t index_count;
+	uint32_t vertex_count; //the number of positions, and of normals
+	uint32_t reserved;
+};
+
+class baked_mesh
+{
+public:
+	/**
+	* \brief Convert the meshes of a scene and write them to a file
+	* \param model the scene, its primitives must have float3 positions and normals and 16 or 32 bit indices
+	* \param path the file to write
+	* \param optimize reorder the triangles and vertices of each primitive with the mesh optimizer
+	* \param quantize store the vertices in quantized_mesh_layout rather than as floats
+	* \param report if not null, the vertex cache statistics of each primitive before and after are printed to it
+	* \param jobs if not null, the primitives are read, optimized and encoded on the threads of this job system
+	*/
+	static void bake(const gltf_model& model, const std::string& path, bool optimize = true, bool quantize = false,
+	                 std::ostream* report = nullptr, job_system* jobs = nullptr);
+
+	/**
+	* \brief Map a baked file and check its header and draw table
+	* \param path the file
+	*/
+	void open(const std::string& path);
+
+	/**
+	* \brief Unmap the file, the data pointers are no longer valid afterwards
+	*/
+	void close();
+
+	/**
+	* \brief Check if a file starts with the baked file magic
+	* \param path the file
+	* \return true if the file is a baked file
+	*/
+	static bool is_baked_file(const std::string& path);
+
+	/**
+	* \brief Obtain the header of the open file
+	* \return the header
+	*/
+	const baked_mesh_header& get_header() const
+	{
+		return *header_;
+	}
+
+	/**
+	* \brief Obtain the draw table
+	* \return the first of get_header().draw_count entries
+	*/
+	const baked_mesh_draw* get_draws() const
+	{
+		return draws_;
+	}
+
+	/**
+	* \brief Obtain the vertex data, which is copied to the vertex buffer as it is
+	* \return the first byte of get_header().vertex_data_size bytes
+	*/
+	const char* get_vertex_data() const
+	{
+		return file_.data() + header_->vertex_data_offset;
+	}
+
+	/**
+	* \brief Obtain the index data, which is copied to the index buffer as it is
+	* \return the first byte of get_header().index_data_size bytes
+	*/
+	const char* get_index_data() const
+	{
+		return file_.data() + header_->index_data_offset;
+	}
+
+private:
+	mapped_file file_;
+	const baked_mesh_header* header_ = nullptr;
+	const baked_mesh_draw* draws_ = nullptr;
+};
+
+#endif
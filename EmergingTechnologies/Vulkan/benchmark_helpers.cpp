@@ -0,0 +1,49 @@
+#include "benchmark_helpers.h"
+#include "vulkan_application.h"
+#include <algorithm>
+
+std::vector<uint32_t> get_thread_sweep(const uint32_t max_threads)
+{
+	std::vector<uint32_t> thread_counts;
+	for (uint32_t count = 1; count <= max_threads; count *= 2)
+	{
+		thread_counts.push_back(count);
+	}
+	if (thread_counts.empty() || thread_counts.back() != max_threads)
+	{
+		thread_counts.push_back(std::max<uint32_t>(max_threads, 1));
+	}
+	return thread_counts;
+}
+
+application_settings get_headless_settings(const std::string& scene_path, const uint32_t frame_count)
+{
+	application_settings settings;
+	settings.headless = true;
+	settings.frame_count = frame_count;
+	settings.scene_path = scene_path;
+	return settings;
+}
+
+bool run_headless(const application_settings& settings, std::ostream& results, const std::string& label,
+                  const std::function<void(const vulkan_application& app, std::ostream& results)>& report)
+{
+	results << label << (label.empty() ? "" : ": ");
+	try
+	{
+		vulkan_application app(settings);
+		app.run();
+		report(app, results);
+		return true;
+	}
+	catch (const std::runtime_error& e)
+	{
+		results << e.what() << std::endl;
+		return false;
+	}
+}
+
+std::string align_right(const std::string& text, const size_t width)
+{
+	return text.size() < width ? std::string(width - text.size(), ' ') + text : text;
+}
@@ -0,0 +1,59 @@
+/**
+* \brief Helpers shared by the benchmarks
+*
+* Several benchmarks compare a range of thread counts in the same way, from one thread up to a
+* maximum. The list of counts is made here so they all sweep the same counts. Most benchmarks
+* also draw a scene headless with different settings and print a row for each run. The
+* applications print as they run, so the rows are gathered in a stream of their own and printed
+* together at the end. An application that fails to start or run prints its error in its row.
+*/
+
+#ifndef BENCHMARK_HELPERS_H
+#define BENCHMARK_HELPERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct application_settings;
+class vulkan_application;
+
+/**
+* \brief Obtain the thread counts to compare, doubling from one and finishing with the maximum if it is not a power
+* of two
+* \param max_threads the largest number of threads, at least one thread is compared
+* \return the thread counts, smallest first
+*/
+std::vector<uint32_t> get_thread_sweep(uint32_t max_threads);
+
+/**
+* \brief Obtain the settings of a headless run, which the benchmark then changes
+* \param scene_path the glTF or baked scene to draw, the quad if empty
+* \param frame_count the number of frames to draw
+* \return the settings
+*/
+application_settings get_headless_settings(const std::string& scene_path, uint32_t frame_count);
+
+/**
+* \brief Run an application and write its row of the results
+* \param settings the settings to run with
+* \param results the stream the rows are gathered in
+* \param label written at the start of the row, followed by a colon unless it is empty
+* \param report writes the rest of the row from the application once it has run, ending the line
+* \return true if the application ran, false if its error was written instead
+*/
+bool run_headless(const application_settings& settings, std::ostream& results, const std::string& label,
+                  const std::function<void(const vulkan_application& app, std::ostream& results)>& report);
+
+/**
+* \brief Pad text on the left, so the labels of the rows line up
+* \param text the text
+* \param width the width to pad it to
+* \return the padded text
+*/
+std::string align_right(const std::string& text, size_t width);
+
+#endif
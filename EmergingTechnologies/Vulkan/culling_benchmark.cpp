@@ -0,0 +1,68 @@
+#include "culling_benchmark.h"
+#include "frame_statistics.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+void fill_random_culling_scene(frustum_culler& culler, const uint32_t object_count)
+{
+	//the same seed every time, so runs are comparable
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-100.0F, 100.0F);
+	std::uniform_real_distribution<float> half_size(0.1F, 3.0F);
+
+	culler.reserve(object_count);
+	for (uint32_t i = 0; i < object_count; i++)
+	{
+		const auto center = glm::vec3(position(random), position(random), position(random));
+		const auto extent = glm::vec3(half_size(random), half_size(random), half_size(random));
+		culler.add(center - extent, center + extent);
+	}
+}
+
+glm::mat4 get_random_culling_camera()
+{
+	return glm::perspective(glm::radians(45.0F), 16.0F / 9.0F, 0.1F, 150.0F) *
+		lookAt(glm::vec3(0.0F), glm::vec3(1.0F, 0.2F, 0.3F), glm::vec3(0.0F, 1.0F, 0.0F));
+}
+
+void run_culling_benchmark(const uint32_t object_count, const uint32_t runs, std::ostream& stream)
+{
+	frustum_culler culler;
+	fill_random_culling_scene(culler, object_count);
+	const auto clip_from_object = get_random_culling_camera();
+
+	stream << "culling " << object_count << " objects, median of " << runs << " runs, " <<
+		frustum_culler::get_lane_count() << " lanes" << std::endl << std::fixed << std::setprecision(2);
+
+	std::vector<uint32_t> visible;
+	for (const auto volume : {culling_volume_sphere, culling_volume_box})
+	{
+		for (const auto simd : {false, true})
+		{
+			std::vector<double> timings;
+			for (uint32_t run = 0; run < std::max<uint32_t>(runs, 1); run++)
+			{
+				const auto start_time = std::chrono::high_resolution_clock::now();
+				if (simd)
+				{
+					culler.cull(clip_from_object, volume, visible);
+				}
+				else
+				{
+					culler.cull_scalar(clip_from_object, volume, visible);
+				}
+				timings.push_back(frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now()));
+			}
+			std::sort(timings.begin(), timings.end());
+
+			const auto ns_per_object = timings[timings.size() / 2] * 1000000.0 / std::max<uint32_t>(object_count, 1);
+			stream << (volume == culling_volume_sphere ? "spheres" : "boxes") << (simd ? ", simd: " : ", scalar: ") <<
+				visible.size() << " visible, " << object_count - visible.size() << " culled, " << ns_per_object <<
+				" ns per object" << std::endl;
+		}
+	}
+}
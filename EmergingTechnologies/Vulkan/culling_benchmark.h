@@ -0,0 +1,41 @@
+/**
+* \brief Compare the SIMD and scalar frustum culling of many objects
+*
+* The objects are boxes of random sizes scattered through a cube, with the camera in the
+* middle looking along a diagonal so some are in front of it and some are not. Each test
+* is run several times and the median is reported as nanoseconds per object, with the
+* number of objects that were culled so the SIMD results can be checked against the
+* scalar ones.
+*/
+
+#ifndef CULLING_BENCHMARK_H
+#define CULLING_BENCHMARK_H
+
+#include "frustum_culler.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <ostream>
+
+/**
+* \brief Fill a culler with the benchmark's scene, boxes of random sizes scattered through a cube. The seed is always
+* the same, so runs are comparable
+* \param culler the culler to add the boxes to
+* \param object_count the number of boxes
+*/
+void fill_random_culling_scene(frustum_culler& culler, uint32_t object_count);
+
+/**
+* \brief Obtain the camera the benchmark's scene is culled with, in the middle of the cube looking along a diagonal
+* \return the transform from the scene to clip space
+*/
+glm::mat4 get_random_culling_camera();
+
+/**
+* \brief Run the benchmark and print the results
+* \param object_count the number of objects to cull
+* \param runs the number of timed runs of each test
+* \param stream the stream to print to
+*/
+void run_culling_benchmark(uint32_t object_count, uint32_t runs, std::ostream& stream);
+
+#endif
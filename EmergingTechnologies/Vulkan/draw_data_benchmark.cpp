@@ -0,0 +1,48 @@
+#include "draw_data_benchmark.h"
+#include "benchmark_helpers.h"
+#include "vulkan_application.h"
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+void run_draw_data_benchmark(const std::string& scene_path, const uint32_t frames, std::ostream& stream)
+{
+	struct draw_data_mode
+	{
+		std::string name;
+		draw_data_path path;
+	};
+	const std::vector<draw_data_mode> modes = {
+		{"push constants", draw_data_push_constants}, {"dynamic uniform offsets", draw_data_dynamic_uniform},
+		{"storage buffer index", draw_data_storage_index}, {"instanced, for reference", draw_data_instanced}
+	};
+	const uint32_t counts[] = {10000, 25000, 50000, 100000};
+
+	std::ostringstream results;
+	results << std::fixed << std::setprecision(3);
+	for (const auto count : counts)
+	{
+		for (const auto& mode : modes)
+		{
+			//every instance is drawn, and every mode records every frame so they are compared on equal terms
+			auto settings = get_headless_settings(scene_path, frames);
+			settings.instance_count = count;
+			settings.cpu_culling = false;
+			settings.dynamic_recording = true;
+			settings.draw_data = mode.path;
+
+			//the draws are the instances times the primitives of the scene, which is only known once it has loaded
+			const auto label = align_right(std::to_string(count), 9) + " instances, " + align_right(mode.name, 24);
+			run_headless(settings, results, label, [](const vulkan_application& app, std::ostream& row)
+			{
+				const auto summary = app.get_frame_summary();
+				row << app.get_primitive_count() << " primitives, cpu frame median " << summary.cpu_frame.p50 <<
+					" ms, p99 " << summary.cpu_frame.p99 << " ms, recording median " << summary.record.p50 <<
+					" ms, gpu render pass " << app.get_render_pass_summary().avg_ms << " ms" << std::endl;
+			});
+		}
+	}
+
+	stream << "per draw data for " << scene_path << ", " << frames << " headless frames per mode and count" << std::endl
+		<< results.str();
+}
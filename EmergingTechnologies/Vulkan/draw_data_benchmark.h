@@ -0,0 +1,29 @@
+/**
+* \brief Compare the ways of giving each draw its own transform when there are many small draws
+*
+* The scene is drawn headless with 10k, 25k, 50k and 100k instances, every instance visible, and
+* each visible instance of each primitive is a draw of its own. A draw is given its transform in
+* push constants, by binding the descriptor set again with the dynamic offset of a uniform buffer
+* moved to the transform, or through its first instance, which the vertex shader uses to index
+* the storage buffer of transforms. The view and projection stay in the uniform buffer of the
+* frame in every case. The command buffers are recorded every frame, so the cost of recording
+* the draws is part of the frame. One instanced indirect draw per primitive is run as well for
+* reference. A scene with one primitive gives exactly as many draws as instances.
+*/
+
+#ifndef DRAW_DATA_BENCHMARK_H
+#define DRAW_DATA_BENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+* \brief Run the benchmark and print the results
+* \param scene_path the glTF or baked scene to draw
+* \param frames the number of frames to draw in each way at each instance count
+* \param stream the stream to print to
+*/
+void run_draw_data_benchmark(const std::string& scene_path, uint32_t frames, std::ostream& stream);
+
+#endif
@@ -0,0 +1,9 @@
+//Draws flat grey while the full pipeline is created in the background, compiled at startup by shader_compiler
+#version 450
+
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+	out_color = vec4(0.5, 0.5, 0.5, 1.0);
+}
@@ -0,0 +1,219 @@
+#include "frame_statistics.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+//the width and number of the histogram buckets, frames of 63ms or more share the last bucket
+static const double histogram_bucket_ms = 1.0;
+static const size_t histogram_bucket_count = 64;
+
+/**
+* \brief Calculate the percentiles of a set of timings
+* \param values the timings, they are sorted in place
+* \return the percentiles
+*/
+static frame_percentiles calculate_percentiles(std::vector<double>& values)
+{
+	frame_percentiles percentiles;
+	if (values.empty())
+	{
+		return percentiles;
+	}
+
+	std::sort(values.begin(), values.end());
+
+	//nearest rank, the smallest value that at least the given fraction of frames are no slower than
+	const auto rank = [&values](const double fraction)
+	{
+		const auto index = static_cast<size_t>(std::ceil(fraction * values.size()));
+		return values[std::max<size_t>(index, 1) - 1];
+	};
+
+	auto total = 0.0;
+	for (const auto value : values)
+	{
+		total += value;
+	}
+
+	percentiles.min = values.front();
+	percentiles.mean = total / values.size();
+	percentiles.p50 = rank(0.5);
+	percentiles.p90 = rank(0.9);
+	percentiles.p99 = rank(0.99);
+	percentiles.p999 = rank(0.999);
+	percentiles.max = values.back();
+	return percentiles;
+}
+
+/**
+* \brief Write a set of percentiles as a JSON object
+* \param stream the stream to write to
+* \param name the name of the object
+* \param percentiles the percentiles
+*/
+static void write_json_percentiles(std::ostream& stream, const char* name, const frame_percentiles& percentiles)
+{
+	stream << "    \"" << name << "\": {\"min\": " << percentiles.min << ", \"mean\": " << percentiles.mean <<
+		", \"p50\": " << percentiles.p50 << ", \"p90\": " << percentiles.p90 << ", \"p99\": " << percentiles.p99 <<
+		", \"p99.9\": " << percentiles.p999 << ", \"max\": " << percentiles.max << "}";
+}
+
+void frame_statistics::init(const std::string& api_name, const size_t capacity)
+{
+	api_name_ = api_name;
+	ring_.assign(std::max<size_t>(capacity, 1), frame_record());
+	frame_count_.store(0, std::memory_order_release);
+}
+
+void frame_statistics::record(const frame_record& record)
+{
+	//only this thread writes the counter, so a relaxed load is enough. The release store publishes the frame
+	//to any thread that loads the counter with acquire
+	const auto index = frame_count_.load(std::memory_order_relaxed);
+	ring_[index % ring_.size()] = record;
+	frame_count_.store(index + 1, std::memory_order_release);
+}
+
+std::vector<frame_record> frame_statistics::snapshot() const
+{
+	const auto count = get_frame_count();
+	const auto kept = std::min<uint64_t>(count, ring_.size());
+
+	//the oldest frame still in the ring is the one that will be overwritten next
+	std::vector<frame_record> frames;
+	frames.reserve(static_cast<size_t>(kept));
+	for (auto i = count - kept; i < count; i++)
+	{
+		frames.push_back(ring_[i % ring_.size()]);
+	}
+	return frames;
+}
+
+frame_summary frame_statistics::summarise() const
+{
+	const auto frames = snapshot();
+
+	frame_summary summary;
+	summary.frame_count = frames.size();
+	summary.histogram.assign(histogram_bucket_count, 0);
+
+	std::vector<double> cpu_frame, acquire_wait, update, record, submit, present;
+	cpu_frame.reserve(frames.size());
+	acquire_wait.reserve(frames.size());
+	update.reserve(frames.size());
+	record.reserve(frames.size());
+	submit.reserve(frames.size());
+	present.reserve(frames.size());
+	for (const auto& frame : frames)
+	{
+		cpu_frame.push_back(frame.cpu_frame_ms);
+		acquire_wait.push_back(frame.acquire_wait_ms);
+		update.push_back(frame.update_ms);
+		record.push_back(frame.record_ms);
+		submit.push_back(frame.submit_ms);
+		present.push_back(frame.present_ms);
+
+		const auto bucket = static_cast<size_t>(std::max(frame.cpu_frame_ms, 0.0) / histogram_bucket_ms);
+		summary.histogram[std::min(bucket, histogram_bucket_count - 1)]++;
+	}
+
+	summary.cpu_frame = calculate_percentiles(cpu_frame);
+	summary.acquire_wait = calculate_percentiles(acquire_wait);
+	summary.update = calculate_percentiles(update);
+	summary.record = calculate_percentiles(record);
+	summary.submit = calculate_percentiles(submit);
+	summary.present = calculate_percentiles(present);
+
+	//a stutter is a frame that is noticeably longer than a typical frame, so it is measured against the median
+	//rather than a fixed frame rate
+	for (const auto ms : cpu_frame)
+	{
+		if (ms > summary.cpu_frame.p50 * 2.0)
+		{
+			summary.stutter_count++;
+		}
+		if (ms > summary.cpu_frame.p50 * 4.0)
+		{
+			summary.severe_stutter_count++;
+		}
+	}
+
+	return summary;
+}
+
+void frame_statistics::write_csv(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	file << std::fixed << std::setprecision(4);
+	file << "api,frame,cpu_frame_ms,acquire_wait_ms,update_ms,record_ms,submit_ms,present_ms\n";
+
+	const auto frames = snapshot();
+	const auto first = get_frame_count() - frames.size();
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		file << api_name_ << ',' << first + i << ',' << frames[i].cpu_frame_ms << ',' << frames[i].acquire_wait_ms <<
+			',' << frames[i].update_ms << ',' << frames[i].record_ms << ',' << frames[i].submit_ms << ',' <<
+			frames[i].present_ms << '\n';
+	}
+}
+
+void frame_statistics::write_json(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	const auto summary = summarise();
+	file << std::fixed << std::setprecision(4);
+	file << "{\n";
+	file << "  \"api\": \"" << api_name_ << "\",\n";
+	file << "  \"frame_count\": " << summary.frame_count << ",\n";
+	file << "  \"timings_ms\": {\n";
+	write_json_percentiles(file, "cpu_frame", summary.cpu_frame);
+	file << ",\n";
+	write_json_percentiles(file, "acquire_wait", summary.acquire_wait);
+	file << ",\n";
+	write_json_percentiles(file, "update", summary.update);
+	file << ",\n";
+	write_json_percentiles(file, "record", summary.record);
+	file << ",\n";
+	write_json_percentiles(file, "submit", summary.submit);
+	file << ",\n";
+	write_json_percentiles(file, "present", summary.present);
+	file << "\n  },\n";
+	file << "  \"stutter_count\": " << summary.stutter_count << ",\n";
+	file << "  \"severe_stutter_count\": " << summary.severe_stutter_count << ",\n";
+	file << "  \"histogram\": {\"bucket_ms\": " << histogram_bucket_ms << ", \"counts\": [";
+	for (size_t i = 0; i < summary.histogram.size(); i++)
+	{
+		file << (i == 0 ? "" : ", ") << summary.histogram[i];
+	}
+	file << "]}\n";
+	file << "}\n";
+}
+
+void frame_statistics::print_summary(std::ostream& stream) const
+{
+	const auto summary = summarise();
+
+	//format into a local stream so the caller's stream keeps its own formatting
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(3) << "cpu frame: " << summary.frame_count << " frames, mean " <<
+		summary.cpu_frame.mean << " ms, p50 " << summary.cpu_frame.p50 << " ms, p90 " << summary.cpu_frame.p90 <<
+		" ms, p99 " << summary.cpu_frame.p99 << " ms, p99.9 " << summary.cpu_frame.p999 << " ms, " <<
+		summary.stutter_count << " stutters (" << summary.severe_stutter_count << " severe)" << std::endl;
+	text << "acquire wait p99 " << summary.acquire_wait.p99 << " ms, update p99 " << summary.update.p99 <<
+		" ms, record p99 " << summary.record.p99 << " ms, submit p99 " << summary.submit.p99 << " ms, present p99 " <<
+		summary.present.p99 << " ms" << std::endl;
+	stream << text.str();
+}
@@ -0,0 +1,141 @@
+/**
+* \class frame_statistics
+*
+* \brief Record the CPU timings of every frame and export percentiles, stutters and a histogram
+*
+* Frames are written into a ring that is allocated up front, so recording a frame never
+* allocates or locks. The render loop is the only writer and publishes each frame with an
+* atomic counter. The frames themselves are not guarded, so the ring is only to be read on the
+* render thread, or once it has stopped recording. Once the ring is full the oldest frames are
+* overwritten. The results can be written as CSV, one row per frame, or as a JSON summary,
+* using the same format for every graphics API so that runs can be compared by a script.
+*/
+
+#ifndef FRAME_STATISTICS_H
+#define FRAME_STATISTICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+* \brief The timings of one frame, in milliseconds
+*/
+struct frame_record
+{
+	double cpu_frame_ms = 0.0; //from the start of this frame to the start of the next
+	double acquire_wait_ms = 0.0; //waiting for a free frame slot and the next image to render to
+	double update_ms = 0.0; //writing the uniforms and instance transforms of the frame, culling included
+	double record_ms = 0.0; //recording the command buffers, 0 if they were recorded ahead of time
+	double submit_ms = 0.0; //submitting the command buffers
+	double present_ms = 0.0; //queueing the image for presentation
+};
+
+/**
+* \brief The percentiles of one of the timings, in milliseconds
+*/
+struct frame_percentiles
+{
+	double min = 0.0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p90 = 0.0;
+	double p99 = 0.0;
+	double p999 = 0.0;
+	double max = 0.0;
+};
+
+/**
+* \brief A summary of all the recorded frames
+*/
+struct frame_summary
+{
+	uint64_t frame_count = 0; //the number of frames the summary was made from
+	frame_percentiles cpu_frame;
+	frame_percentiles acquire_wait;
+	frame_percentiles update;
+	frame_percentiles record;
+	frame_percentiles submit;
+	frame_percentiles present;
+	uint64_t stutter_count = 0; //frames that took more than twice the median frame time
+	uint64_t severe_stutter_count = 0; //frames that took more than four times the median frame time
+	std::vector<uint64_t> histogram; //the number of frames in each 1ms bucket of cpu frame time, the last bucket holds the rest
+};
+
+class frame_statistics
+{
+public:
+	/**
+	* \brief Allocate the ring
+	* \param api_name the name of the graphics API, written to the exported files
+	* \param capacity the number of frames to keep, older frames are overwritten
+	*/
+	void init(const std::string& api_name, const size_t capacity = 65536);
+
+	/**
+	* \brief Add a frame to the ring, this is only to be called from one thread
+	* \param record the timings of the frame
+	*/
+	void record(const frame_record& record);
+
+	/**
+	* \brief Obtain the number of frames that have been recorded, including any that have been overwritten
+	* \return the number of frames
+	*/
+	uint64_t get_frame_count() const
+	{
+		return frame_count_.load(std::memory_order_acquire);
+	}
+
+	/**
+	* \brief Copy the frames that are still in the ring, oldest first, not while another thread is recording
+	* \return the frames
+	*/
+	std::vector<frame_record> snapshot() const;
+
+	/**
+	* \brief Calculate the percentiles, stutter counts and histogram of the frames in the ring
+	* \return the summary
+	*/
+	frame_summary summarise() const;
+
+	/**
+	* \brief Write the timings of every frame in the ring to a CSV file
+	* \param path the file to write
+	*/
+	void write_csv(const std::string& path) const;
+
+	/**
+	* \brief Write the summary to a JSON file
+	* \param path the file to write
+	*/
+	void write_json(const std::string& path) const;
+
+	/**
+	* \brief Write the summary in a human readable form
+	* \param stream the stream to write to
+	*/
+	void print_summary(std::ostream& stream) const;
+
+	/**
+	* \brief Obtain the milliseconds between two points in time
+	* \param begin the earlier point
+	* \param end the later point
+	* \return the milliseconds
+	*/
+	static double elapsed_ms(const std::chrono::high_resolution_clock::time_point begin,
+	                         const std::chrono::high_resolution_clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - begin).count();
+	}
+
+private:
+	std::string api_name_;
+	std::vector<frame_record> ring_;
+	std::atomic<uint64_t> frame_count_{0}; //the frames published, the next frame is written at frame_count_ % size
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "frustum_culler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//the objects each task of a parallel cull tests, enough that a task costs far more than spawning it
+static const size_t parallel_chunk_size = 16384;
+
+//a register of floats, one per object, and the few operations the plane tests need
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+typedef __m256 float_lanes;
+static const uint32_t lane_count = 8;
+
+static float_lanes lanes_load(const float* data)
+{
+	return _mm256_loadu_ps(data);
+}
+
+static float_lanes lanes_set(const float value)
+{
+	return _mm256_set1_ps(value);
+}
+
+static float_lanes lanes_add(const float_lanes a, const float_lanes b)
+{
+	return _mm256_add_ps(a, b);
+}
+
+static float_lanes lanes_mul(const float_lanes a, const float_lanes b)
+{
+	return _mm256_mul_ps(a, b);
+}
+
+static float_lanes lanes_and(const float_lanes a, const float_lanes b)
+{
+	return _mm256_and_ps(a, b);
+}
+
+static float_lanes lanes_greater_equal(const float_lanes a, const float_lanes b)
+{
+	return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+}
+
+static uint32_t lanes_mask(const float_lanes a)
+{
+	return static_cast<uint32_t>(_mm256_movemask_ps(a));
+}
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+typedef __m128 float_lanes;
+static const uint32_t lane_count = 4;
+
+static float_lanes lanes_load(const float* data)
+{
+	return _mm_loadu_ps(data);
+}
+
+static float_lanes lanes_set(const float value)
+{
+	return _mm_set1_ps(value);
+}
+
+static float_lanes lanes_add(const float_lanes a, const float_lanes b)
+{
+	return _mm_add_ps(a, b);
+}
+
+static float_lanes lanes_mul(const float_lanes a, const float_lanes b)
+{
+	return _mm_mul_ps(a, b);
+}
+
+static float_lanes lanes_and(const float_lanes a, const float_lanes b)
+{
+	return _mm_and_ps(a, b);
+}
+
+static float_lanes lanes_greater_equal(const float_lanes a, const float_lanes b)
+{
+	return _mm_cmpge_ps(a, b);
+}
+
+static uint32_t lanes_mask(const float_lanes a)
+{
+	return static_cast<uint32_t>(_mm_movemask_ps(a));
+}
+#else
+static const uint32_t lane_count = 1;
+#endif
+
+std::array<glm::vec4, 6> frustum_culler::extract_planes(const glm::mat4& clip_from_object)
+{
+	//a point is inside when -w <= x, y, z <= w in clip space, each bound is a plane made from two rows of the matrix
+	const auto row = [&](const glm::length_t i)
+	{
+		return glm::vec4(clip_from_object[0][i], clip_from_object[1][i], clip_from_object[2][i], clip_from_object[3][i]);
+	};
+	std::array<glm::vec4, 6> planes = {
+		{row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(3) + row(2), row(3) - row(2)}
+	};
+
+	//normalized planes give the distance to a point, which is what the sphere radius is compared with
+	for (auto& plane : planes)
+	{
+		plane /= std::max(length(glm::vec3(plane)), 1e-20F);
+	}
+	return planes;
+}
+
+void frustum_culler::reserve(const size_t count)
+{
+	for (auto component : {&center_x_, &center_y_, &center_z_, &extent_x_, &extent_y_, &extent_z_, &radius_})
+	{
+		component->reserve(count);
+	}
+}
+
+void frustum_culler::clear()
+{
+	for (auto component : {&center_x_, &center_y_, &center_z_, &extent_x_, &extent_y_, &extent_z_, &radius_})
+	{
+		component->clear();
+	}
+}
+
+uint32_t frustum_culler::add(const glm::vec3& min, const glm::vec3& max)
+{
+	const auto center = (min + max) * 0.5F;
+	const auto extent = (max - min) * 0.5F;
+	center_x_.push_back(center.x);
+	center_y_.push_back(center.y);
+	center_z_.push_back(center.z);
+	extent_x_.push_back(extent.x);
+	extent_y_.push_back(extent.y);
+	extent_z_.push_back(extent.z);
+	radius_.push_back(length(extent));
+	return static_cast<uint32_t>(radius_.size() - 1);
+}
+
+uint32_t frustum_culler::add_sphere(const glm::vec3& center, const float radius)
+{
+	const auto index = add(center - radius, center + radius);
+	radius_[index] = radius;
+	return index;
+}
+
+void frustum_culler::cull(const glm::mat4& clip_from_object, const culling_volume volume,
+                          std::vector<uint32_t>& visible) const
+{
+	//every object may be visible, the list is shrunk to the ones that are at the end
+	visible.resize(size());
+	size_t count = 0;
+	cull_range(extract_planes(clip_from_object), volume, 0, size(), visible.data(), count);
+	visible.resize(count);
+}
+
+void frustum_culler::cull(const glm::mat4& clip_from_object, const culling_volume volume,
+                          std::vector<uint32_t>& visible, job_system& jobs) const
+{
+	const auto chunk_count = (size() + parallel_chunk_size - 1) / parallel_chunk_size;
+	if (chunk_count <= 1 || jobs.get_thread_count() <= 1)
+	{
+		cull(clip_from_object, volume, visible);
+		return;
+	}
+
+	//each chunk writes its visible objects to the start of its own part of the list
+	const auto planes = extract_planes(clip_from_object);
+	visible.resize(size());
+	std::vector<size_t> chunk_counts(chunk_count, 0);
+	jobs.parallel_for(0, chunk_count, 1, [&](const size_t first_chunk, const size_t last_chunk)
+	{
+		for (auto chunk = first_chunk; chunk < last_chunk; chunk++)
+		{
+			const auto first = chunk * parallel_chunk_size;
+			const auto last = std::min(first + parallel_chunk_size, size());
+			cull_range(planes, volume, first, last, visible.data() + first, chunk_counts[chunk]);
+		}
+	});
+
+	//then the parts are moved down to follow each other, the first part is already in place
+	auto count = chunk_counts[0];
+	for (size_t chunk = 1; chunk < chunk_count; chunk++)
+	{
+		memmove(visible.data() + count, visible.data() + chunk * parallel_chunk_size,
+		        sizeof(uint32_t) * chunk_counts[chunk]);
+		count += chunk_counts[chunk];
+	}
+	visible.resize(count);
+}
+
+void frustum_culler::cull_range(const std::array<glm::vec4, 6>& planes, const culling_volume volume,
+                                size_t first, const size_t last, uint32_t* visible, size_t& count) const
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	//the plane components, the same in every lane
+	float_lanes plane_x[6], plane_y[6], plane_z[6], plane_w[6], plane_abs_x[6], plane_abs_y[6], plane_abs_z[6];
+	for (size_t i = 0; i < planes.size(); i++)
+	{
+		plane_x[i] = lanes_set(planes[i].x);
+		plane_y[i] = lanes_set(planes[i].y);
+		plane_z[i] = lanes_set(planes[i].z);
+		plane_w[i] = lanes_set(planes[i].w);
+		plane_abs_x[i] = lanes_set(std::abs(planes[i].x));
+		plane_abs_y[i] = lanes_set(std::abs(planes[i].y));
+		plane_abs_z[i] = lanes_set(std::abs(planes[i].z));
+	}
+	const auto zero = lanes_set(0.0F);
+
+	for (; first + lane_count <= last; first += lane_count)
+	{
+		const auto center_x = lanes_load(&center_x_[first]);
+		const auto center_y = lanes_load(&center_y_[first]);
+		const auto center_z = lanes_load(&center_z_[first]);
+
+		//the furthest the volume reaches towards each plane, the radius for a sphere and the box projected onto the
+		//plane's normal for a box
+		float_lanes reach[6];
+		if (volume == culling_volume_sphere)
+		{
+			const auto radius = lanes_load(&radius_[first]);
+			for (auto& plane_reach : reach)
+			{
+				plane_reach = radius;
+			}
+		}
+		else
+		{
+			const auto extent_x = lanes_load(&extent_x_[first]);
+			const auto extent_y = lanes_load(&extent_y_[first]);
+			const auto extent_z = lanes_load(&extent_z_[first]);
+			for (size_t i = 0; i < planes.size(); i++)
+			{
+				reach[i] = lanes_add(lanes_add(lanes_mul(plane_abs_x[i], extent_x), lanes_mul(plane_abs_y[i], extent_y)),
+				                     lanes_mul(plane_abs_z[i], extent_z));
+			}
+		}
+
+		//an object is culled if it is entirely behind any plane
+		auto inside = lanes_greater_equal(zero, zero); //every lane true
+		for (size_t i = 0; i < planes.size(); i++)
+		{
+			const auto distance = lanes_add(lanes_add(lanes_mul(plane_x[i], center_x), lanes_mul(plane_y[i], center_y)),
+			                                lanes_add(lanes_mul(plane_z[i], center_z), plane_w[i]));
+			inside = lanes_and(inside, lanes_greater_equal(lanes_add(distance, reach[i]), zero));
+		}
+
+		//write every index and only advance past the visible ones, so nothing branches on the result
+		const auto mask = lanes_mask(inside);
+		for (uint32_t lane = 0; lane < lane_count; lane++)
+		{
+			visible[count] = static_cast<uint32_t>(first + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+#endif
+
+	//the objects that do not fill a register
+	cull_range_scalar(planes, volume, first, last, visible, count);
+}
+
+void frustum_culler::cull_scalar(const glm::mat4& clip_from_object, const culling_volume volume,
+                                 std::vector<uint32_t>& visible) const
+{
+	visible.resize(size());
+	size_t count = 0;
+	cull_range_scalar(extract_planes(clip_from_object), volume, 0, size(), visible.data(), count);
+	visible.resize(count);
+}
+
+uint32_t frustum_culler::get_lane_count()
+{
+	return lane_count;
+}
+
+void frustum_culler::cull_range_scalar(const std::array<glm::vec4, 6>& planes, const culling_volume volume,
+                                       const size_t first, const size_t last, uint32_t* visible,
+                                       size_t& count) const
+{
+	for (auto object = first; object < last; object++)
+	{
+		const auto center = glm::vec3(center_x_[object], center_y_[object], center_z_[object]);
+		const auto extent = glm::vec3(extent_x_[object], extent_y_[object], extent_z_[object]);
+
+		auto inside = true;
+		for (const auto& plane : planes)
+		{
+			const auto reach = volume == culling_volume_sphere ? radius_[object] : dot(abs(glm::vec3(plane)), extent);
+			inside = inside && dot(glm::vec3(plane), center) + plane.w + reach >= 0.0F;
+		}
+		visible[count] = static_cast<uint32_t>(object);
+		count += inside ? 1 : 0;
+	}
+}
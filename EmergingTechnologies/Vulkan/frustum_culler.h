@@ -0,0 +1,148 @@
+/**
+* \class frustum_culler
+*
+* \brief Test many bounding volumes against the view frustum at once
+*
+* The bounds are kept as a structure of arrays, one array per component, so a SIMD register
+* holds the same component of 4 (SSE2) or 8 (AVX) objects and each plane is tested against
+* all of them with a few multiplies and adds. The instruction set is chosen at compile time
+* from the GLM_ARCH macros in glm/simd/platform.h, and a scalar loop is used when neither
+* is available or for the objects left over at the end. Each object is stored as an axis
+* aligned box and the sphere around it, and either can be tested. Spheres are cheaper and
+* stay valid when the object rotates around its centre, boxes are tighter. The indices of
+* the visible objects are written out as a compact list, without branches on the result. Large
+* sets can be split into chunks that are culled on the threads of a job system.
+*/
+
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include "job_system.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+* \brief The bounding volume to test
+*/
+enum culling_volume
+{
+	culling_volume_sphere,
+	culling_volume_box
+};
+
+class frustum_culler
+{
+public:
+	/**
+	* \brief Obtain the planes of the frustum of a matrix, the normals point inwards and are normalized. The near
+	* plane is for a -1 to 1 depth range, which also keeps everything in a 0 to 1 range
+	* \param clip_from_object the matrix that takes the bounds to clip space
+	* \return the left, right, bottom, top, near and far planes as (normal, distance)
+	*/
+	static std::array<glm::vec4, 6> extract_planes(const glm::mat4& clip_from_object);
+
+	/**
+	* \brief Make room for a number of objects
+	* \param count the number of objects
+	*/
+	void reserve(size_t count);
+
+	/**
+	* \brief Remove every object
+	*/
+	void clear();
+
+	/**
+	* \brief Add an object
+	* \param min the minimum corner of the box around the object
+	* \param max the maximum corner of the box around the object
+	* \return the index of the object, which is what the visible list holds
+	*/
+	uint32_t add(const glm::vec3& min, const glm::vec3& max);
+
+	/**
+	* \brief Add an object bounded by a sphere, its box is the cube around the sphere
+	* \param center the centre of the sphere
+	* \param radius the radius of the sphere
+	* \return the index of the object, which is what the visible list holds
+	*/
+	uint32_t add_sphere(const glm::vec3& center, float radius);
+
+	/**
+	* \brief Obtain the number of objects
+	* \return the number of objects
+	*/
+	size_t size() const
+	{
+		return radius_.size();
+	}
+
+	/**
+	* \brief Find the objects that are at least partly inside the frustum, using SIMD when it is available
+	* \param clip_from_object the matrix that takes the bounds to clip space
+	* \param volume the bounding volume to test
+	* \param visible the indices of the visible objects in order, replaced
+	*/
+	void cull(const glm::mat4& clip_from_object, culling_volume volume, std::vector<uint32_t>& visible) const;
+
+	/**
+	* \brief Find the visible objects on the threads of a job system, each task testing a chunk of the objects. Small
+	* sets are culled on the calling thread
+	* \param clip_from_object the matrix that takes the bounds to clip space
+	* \param volume the bounding volume to test
+	* \param visible the indices of the visible objects in order, replaced
+	* \param jobs the job system, called from one of its threads
+	*/
+	void cull(const glm::mat4& clip_from_object, culling_volume volume, std::vector<uint32_t>& visible,
+	          job_system& jobs) const;
+
+	/**
+	* \brief Find the visible objects one at a time, the reference the SIMD version is compared with
+	* \param clip_from_object the matrix that takes the bounds to clip space
+	* \param volume the bounding volume to test
+	* \param visible the indices of the visible objects in order, replaced
+	*/
+	void cull_scalar(const glm::mat4& clip_from_object, culling_volume volume, std::vector<uint32_t>& visible) const;
+
+	/**
+	* \brief Obtain the number of objects tested at once by cull
+	* \return 8 with AVX, 4 with SSE2, otherwise 1
+	*/
+	static uint32_t get_lane_count();
+
+private:
+	//the centre and half size of each box, and the radius of the sphere around it
+	std::vector<float> center_x_, center_y_, center_z_;
+	std::vector<float> extent_x_, extent_y_, extent_z_;
+	std::vector<float> radius_;
+
+	/**
+	* \brief Test a range of objects, using SIMD when it is available, appending the visible ones
+	* \param planes the frustum planes
+	* \param volume the bounding volume to test
+	* \param first the first object to test
+	* \param last one past the last object to test
+	* \param visible the visible list, the first count entries are kept
+	* \param count the number of visible objects so far, updated
+	*/
+	void cull_range(const std::array<glm::vec4, 6>& planes, culling_volume volume, size_t first, size_t last,
+	                uint32_t* visible, size_t& count) const;
+
+	/**
+	* \brief Test objects one at a time, appending the visible ones
+	* \param planes the frustum planes
+	* \param volume the bounding volume to test
+	* \param first the first object to test
+	* \param last one past the last object to test
+	* \param visible the visible list, the first count entries are kept
+	* \param count the number of visible objects so far, updated
+	*/
+	void cull_range_scalar(const std::array<glm::vec4, 6>& planes, culling_volume volume, size_t first, size_t last,
+	                       uint32_t* visible, size_t& count) const;
+};
+
+#endif
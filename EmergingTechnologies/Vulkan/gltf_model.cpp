@@ -0,0 +1,256 @@
+#include "gltf_model.h"
+#include "json_value.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+//the primitive mode of triangle lists, the only mode the renderer draws
+static const uint32_t gltf_mode_triangles = 4;
+
+/**
+* \brief Look up an entry of a top level collection. glTF 1.0 stores the collections as objects and refers to
+* entries by name, glTF 2.0 stores them as arrays and refers to entries by index
+* \param collection the collection
+* \param reference the name or index of the entry
+* \return the entry, a null value if it does not exist
+*/
+static const json_value& resolve(const json_value& collection, const json_value& reference)
+{
+	if (reference.get_type() == json_value::type::number)
+	{
+		return collection[static_cast<size_t>(reference.as_number())];
+	}
+	return collection[reference.as_string()];
+}
+
+/**
+* \brief Obtain the number of components in an accessor type
+* \param type the type, such as "VEC3"
+* \return the number of components
+*/
+static uint32_t get_component_count(const std::string& type)
+{
+	if (type == "SCALAR")
+	{
+		return 1;
+	}
+	if (type == "VEC2")
+	{
+		return 2;
+	}
+	if (type == "VEC3")
+	{
+		return 3;
+	}
+	if (type == "VEC4" || type == "MAT2")
+	{
+		return 4;
+	}
+	if (type == "MAT3")
+	{
+		return 9;
+	}
+	if (type == "MAT4")
+	{
+		return 16;
+	}
+	throw std::runtime_error("unknown gltf accessor type " + type + "!");
+}
+
+uint32_t gltf_accessor::get_element_size() const
+{
+	switch (component_type)
+	{
+	case gltf_byte:
+	case gltf_unsigned_byte:
+		return component_count;
+	case gltf_short:
+	case gltf_unsigned_short:
+		return component_count * 2;
+	default:
+		return component_count * 4;
+	}
+}
+
+void gltf_model::load(const std::string& path)
+{
+	unload();
+
+	//the JSON is only needed while the accessors are resolved, so it is parsed straight from a mapping too
+	mapped_file document_file;
+	document_file.open(path);
+	const auto document = json_value::parse(document_file.data(), document_file.size());
+
+	if (document["asset"]["version"].as_string("1.0")[0] > '2')
+	{
+		throw std::runtime_error("unsupported gltf version in " + path + "!");
+	}
+
+	//buffer uris are relative to the .gltf file
+	const auto separator = path.find_last_of("/\\");
+	const auto directory = separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+
+	const auto& buffers = document["buffers"];
+	const auto& buffer_views = document["bufferViews"];
+	const auto& accessors = document["accessors"];
+
+	//each buffer is mapped the first time an accessor uses it
+	std::map<const json_value*, const mapped_file*> mapped_buffers;
+	const auto map_buffer = [&](const json_value& buffer) -> const mapped_file&
+	{
+		const auto found = mapped_buffers.find(&buffer);
+		if (found != mapped_buffers.end())
+		{
+			return *found->second;
+		}
+
+		const auto& uri = buffer["uri"].as_string();
+		if (uri.empty() || uri.compare(0, 5, "data:") == 0)
+		{
+			throw std::runtime_error("gltf buffers must be separate files to be mapped!");
+		}
+
+		std::unique_ptr<mapped_file> file(new mapped_file());
+		file->open(directory + uri);
+		const auto byte_length = buffer["byteLength"].as_number(static_cast<double>(file->size()));
+		if (byte_length > static_cast<double>(file->size()))
+		{
+			throw std::runtime_error("gltf buffer " + uri + " is smaller than its byteLength!");
+		}
+
+		buffers_.push_back(std::move(file));
+		mapped_buffers[&buffer] = buffers_.back().get();
+		return *buffers_.back();
+	};
+
+	const auto read_accessor = [&](const json_value& reference) -> gltf_accessor
+	{
+		gltf_accessor accessor;
+		if (reference.is_null())
+		{
+			return accessor;
+		}
+
+		const auto& json_accessor = resolve(accessors, reference);
+		const auto& buffer_view = resolve(buffer_views, json_accessor["bufferView"]);
+		if (buffer_view.is_null())
+		{
+			throw std::runtime_error("gltf accessors without a buffer view are not supported!");
+		}
+		const auto& buffer = map_buffer(resolve(buffers, buffer_view["buffer"]));
+
+		accessor.count = static_cast<uint32_t>(json_accessor["count"].as_number());
+		accessor.component_type = static_cast<uint32_t>(json_accessor["componentType"].as_number());
+		accessor.component_count = get_component_count(json_accessor["type"].as_string());
+
+		//glTF 1.0 stores the stride in the accessor and 2.0 in the buffer view, 0 means tightly packed
+		accessor.stride = static_cast<uint32_t>(json_accessor["byteStride"].as_number(
+			buffer_view["byteStride"].as_number(0.0)));
+		if (accessor.stride == 0)
+		{
+			accessor.stride = accessor.get_element_size();
+		}
+
+		//make sure the elements are inside the view and the view is inside the file, the data is read straight
+		//from the mapping so anything past the end would read invalid memory
+		const auto view_offset = static_cast<size_t>(buffer_view["byteOffset"].as_number());
+		const auto view_length = static_cast<size_t>(buffer_view["byteLength"].as_number());
+		const auto accessor_offset = static_cast<size_t>(json_accessor["byteOffset"].as_number());
+		if (accessor_offset + accessor.get_byte_length() > view_length || view_offset + view_length > buffer.size())
+		{
+			throw std::runtime_error("gltf accessor is outside of its buffer!");
+		}
+
+		accessor.data = buffer.data() + view_offset + accessor_offset;
+		return accessor;
+	};
+
+	bounds_min_ = glm::vec3(std::numeric_limits<float>::max());
+	bounds_max_ = glm::vec3(std::numeric_limits<float>::lowest());
+
+	const auto read_mesh = [&](const std::string& name, const json_value& json_mesh)
+	{
+		gltf_mesh mesh;
+		mesh.name = json_mesh["name"].as_string(name);
+
+		const auto& json_primitives = json_mesh["primitives"];
+		for (size_t i = 0; i < json_primitives.size(); i++)
+		{
+			const auto& json_primitive = json_primitives[i];
+			if (static_cast<uint32_t>(json_primitive["mode"].as_number(gltf_mode_triangles)) != gltf_mode_triangles)
+			{
+				continue;
+			}
+
+			gltf_primitive primitive;
+			const auto& attributes = json_primitive["attributes"];
+			primitive.position = read_accessor(attributes["POSITION"]);
+			primitive.normal = read_accessor(attributes["NORMAL"]);
+			primitive.indices = read_accessor(json_primitive["indices"]);
+			if (primitive.position.data == nullptr)
+			{
+				continue;
+			}
+
+			//the bounds are stored with the accessor, glTF 2.0 requires them for positions
+			const auto& json_position = resolve(accessors, attributes["POSITION"]);
+			const auto& min = json_position["min"];
+			const auto& max = json_position["max"];
+			if (min.size() == 3 && max.size() == 3)
+			{
+				for (glm::length_t axis = 0; axis < 3; axis++)
+				{
+					bounds_min_[axis] = std::min(bounds_min_[axis], static_cast<float>(min[axis].as_number()));
+					bounds_max_[axis] = std::max(bounds_max_[axis], static_cast<float>(max[axis].as_number()));
+				}
+			}
+			else if (primitive.position.component_type == gltf_float)
+			{
+				for (uint32_t vertex = 0; vertex < primitive.position.count; vertex++)
+				{
+					//the mapping gives no alignment guarantees, so the position is copied out rather than cast
+					glm::vec3 position;
+					memcpy(&position, primitive.position.data + vertex * primitive.position.stride, sizeof(position));
+					bounds_min_ = glm::min(bounds_min_, position);
+					bounds_max_ = glm::max(bounds_max_, position);
+				}
+			}
+
+			mesh.primitives.push_back(primitive);
+		}
+
+		if (!mesh.primitives.empty())
+		{
+			meshes_.push_back(std::move(mesh));
+		}
+	};
+
+	const auto& meshes = document["meshes"];
+	if (meshes.is_array())
+	{
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			read_mesh(std::to_string(i), meshes[i]);
+		}
+	}
+	else
+	{
+		for (const auto& member : meshes.get_members())
+		{
+			read_mesh(member.first, member.second);
+		}
+	}
+
+	if (meshes_.empty())
+	{
+		bounds_min_ = bounds_max_ = glm::vec3(0.0F);
+	}
+}
+
+void gltf_model::unload()
+{
+	meshes_.clear();
+	buffers_.clear();
+}
@@ -0,0 +1,133 @@
+/**
+* \class gltf_model
+*
+* \brief Load the meshes of a glTF 1.0 or 2.0 scene
+*
+* The JSON part of the scene is parsed, while the .bin buffers it references are memory
+* mapped and never copied. Every accessor points straight into a mapping, so the vertex and
+* index data can be uploaded to the GPU from where the OS paged it in. The pointers are
+* only valid until the model is unloaded, so upload the data before calling unload().
+* Node transforms, materials and textures are not read, only the mesh geometry.
+*/
+
+#ifndef GLTF_MODEL_H
+#define GLTF_MODEL_H
+
+#include "mapped_file.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+* \brief The glTF component types, which are the OpenGL type enums
+*/
+enum gltf_component_type : uint32_t
+{
+	gltf_byte = 5120,
+	gltf_unsigned_byte = 5121,
+	gltf_short = 5122,
+	gltf_unsigned_short = 5123,
+	gltf_unsigned_int = 5125,
+	gltf_float = 5126
+};
+
+/**
+* \brief A typed view of elements in a mapped buffer
+*/
+struct gltf_accessor
+{
+	const char* data = nullptr; //the first element, null if the primitive does not have this accessor
+	uint32_t count = 0; //the number of elements
+	uint32_t component_type = 0; //one of gltf_component_type
+	uint32_t component_count = 0; //1 for SCALAR, 3 for VEC3 and so on
+	uint32_t stride = 0; //the distance in bytes between the start of each element
+
+	/**
+	* \brief Obtain the size of one element
+	* \return the size in bytes
+	*/
+	uint32_t get_element_size() const;
+
+	/**
+	* \brief Obtain the size of the range the elements occupy, from the first byte of the first element to the
+	* last byte of the last element
+	* \return the size in bytes
+	*/
+	size_t get_byte_length() const
+	{
+		return count == 0 ? 0 : static_cast<size_t>(count - 1) * stride + get_element_size();
+	}
+};
+
+/**
+* \brief A set of triangles drawn with one draw call
+*/
+struct gltf_primitive
+{
+	gltf_accessor position;
+	gltf_accessor normal;
+	gltf_accessor indices;
+};
+
+/**
+* \brief A named set of primitives
+*/
+struct gltf_mesh
+{
+	std::string name;
+	std::vector<gltf_primitive> primitives;
+};
+
+class gltf_model
+{
+public:
+	/**
+	* \brief Parse a scene and map the buffers it references, any scene that is already loaded is unloaded first
+	* \param path the .gltf file
+	*/
+	void load(const std::string& path);
+
+	/**
+	* \brief Unmap the buffers, the accessors no longer point to valid memory afterwards
+	*/
+	void unload();
+
+	/**
+	* \brief Obtain the meshes of the scene, only primitives made of triangles are included
+	* \return the meshes
+	*/
+	const std::vector<gltf_mesh>& get_meshes() const
+	{
+		return meshes_;
+	}
+
+	/**
+	* \brief Obtain the corner of the box around every position with the lowest coordinates
+	* \return the corner
+	*/
+	const glm::vec3& get_bounds_min() const
+	{
+		return bounds_min_;
+	}
+
+	/**
+	* \brief Obtain the corner of the box around every position with the highest coordinates
+	* \return the corner
+	*/
+	const glm::vec3& get_bounds_max() const
+	{
+		return bounds_max_;
+	}
+
+private:
+	std::vector<std::unique_ptr<mapped_file>> buffers_; //the mapped .bin files
+	std::vector<gltf_mesh> meshes_;
+	glm::vec3 bounds_min_ = glm::vec3(0.0F);
+	glm::vec3 bounds_max_ = glm::vec3(0.0F);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "instancing_benchmark.h"
+#include "benchmark_helpers.h"
+#include "vulkan_application.h"
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+void run_instancing_benchmark(const std::string& scene_path, const uint32_t max_instances, const uint32_t frames,
+                              std::ostream& stream)
+{
+	//sweep the powers of ten, finishing with the maximum if it is not one of them
+	std::vector<uint32_t> counts;
+	for (uint64_t count = 1; count <= max_instances; count *= 10)
+	{
+		counts.push_back(static_cast<uint32_t>(count));
+	}
+	if (counts.empty() || counts.back() != max_instances)
+	{
+		counts.push_back(max_instances);
+	}
+
+	std::ostringstream results;
+	results << std::fixed << std::setprecision(3);
+	for (const auto count : counts)
+	{
+		auto settings = get_headless_settings(scene_path, frames);
+		settings.instance_count = count;
+
+		const auto ran = run_headless(settings, results, align_right(std::to_string(count), 9) + " instances",
+		                              [](const vulkan_application& app, std::ostream& row)
+		                              {
+			                              const auto cpu = app.get_frame_summary().cpu_frame;
+			                              row << "cpu frame median " << cpu.p50 << " ms, p99 " << cpu.p99 <<
+				                              " ms, gpu render pass " << app.get_render_pass_summary().avg_ms << " ms"
+				                              << std::endl;
+		                              });
+
+		//larger counts would fail in the same way, so stop here
+		if (!ran)
+		{
+			break;
+		}
+	}
+
+	stream << "instancing " << scene_path << ", " << frames << " headless frames per count" << std::endl << results.str();
+}
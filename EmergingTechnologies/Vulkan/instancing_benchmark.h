@@ -0,0 +1,28 @@
+/**
+* \brief Measure how the frame time grows with the number of instances of a scene
+*
+* The scene is drawn headless with 1, 10, 100 and so on instances up to the maximum, each
+* count in a fresh application so every run starts from the same state. The instances are
+* laid out on a grid and spun every frame, so the CPU cost of filling the instance buffer
+* is part of the frame time, as it would be for a scene of moving objects. The median and
+* 99th percentile CPU frame times are printed with the average GPU time of the render pass.
+*/
+
+#ifndef INSTANCING_BENCHMARK_H
+#define INSTANCING_BENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+* \brief Run the benchmark and print the results
+* \param scene_path the glTF or baked scene to instance
+* \param max_instances the largest number of instances to draw
+* \param frames the number of frames to draw at each instance count
+* \param stream the stream to print to
+*/
+void run_instancing_benchmark(const std::string& scene_path, uint32_t max_instances, uint32_t frames,
+                              std::ostream& stream);
+
+#endif
@@ -0,0 +1,365 @@
+#include "job_system.h"
+#include <algorithm>
+#include <stdexcept>
+
+//the jobs each thread's deque holds, a thread that spawns more than this runs the extra tasks itself
+static const size_t deque_capacity = 4096;
+
+//the free jobs each thread keeps, threads that mostly run other threads' tasks would otherwise collect them
+static const size_t free_job_limit = 4096;
+
+//the times an idle thread looks for a job before it sleeps
+static const uint32_t idle_spin_count = 64;
+
+thread_local job_system::thread_state* job_system::current_thread_ = nullptr;
+
+work_stealing_deque::work_stealing_deque(const size_t capacity) :
+	jobs_(new std::atomic<job*>[capacity]), mask_(static_cast<int64_t>(capacity) - 1)
+{
+	for (size_t i = 0; i < capacity; i++)
+	{
+		jobs_[i].store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+bool work_stealing_deque::push(job* pushed)
+{
+	const auto bottom = bottom_.load(std::memory_order_relaxed);
+	const auto top = top_.load(std::memory_order_acquire);
+	if (bottom - top > mask_)
+	{
+		return false;
+	}
+
+	//the job has to be in place before a thief can see the new bottom
+	jobs_[bottom & mask_].store(pushed, std::memory_order_relaxed);
+	bottom_.store(bottom + 1, std::memory_order_release);
+	return true;
+}
+
+job* work_stealing_deque::pop()
+{
+	//claim the bottom job, then check a thief has not taken it
+	const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+	bottom_.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto top = top_.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		//the deque was empty
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	auto popped = jobs_[bottom & mask_].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		//the last job, which a thief may be taking at the same time, whoever moves the top first has it
+		if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			popped = nullptr;
+		}
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return popped;
+}
+
+job* work_stealing_deque::steal()
+{
+	auto top = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const auto bottom = bottom_.load(std::memory_order_acquire);
+	if (top >= bottom)
+	{
+		return nullptr;
+	}
+
+	//read the job before claiming it, once the top moves the owner may reuse the slot
+	const auto stolen = jobs_[top & mask_].load(std::memory_order_relaxed);
+	if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+	return stolen;
+}
+
+job_system::~job_system()
+{
+	destroy();
+}
+
+void job_system::init(uint32_t thread_count)
+{
+	if (current_thread_ != nullptr)
+	{
+		throw std::runtime_error("this thread already belongs to a job system!");
+	}
+
+	if (thread_count == 0)
+	{
+		thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+
+	stopping_ = false;
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		threads_.emplace_back(new thread_state(deque_capacity));
+		threads_.back()->index = i;
+		threads_.back()->random = i * 2654435761U + 1;
+	}
+
+	//the calling thread is the first thread, the others are started here
+	current_thread_ = threads_[0].get();
+	for (uint32_t i = 1; i < thread_count; i++)
+	{
+		workers_.emplace_back(&job_system::worker_loop, this, i);
+	}
+}
+
+void job_system::destroy()
+{
+	if (threads_.empty())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		stopping_ = true;
+	}
+	wake_.notify_all();
+	for (auto& worker : workers_)
+	{
+		worker.join();
+	}
+	workers_.clear();
+
+	//every group has been waited on, so the deques are empty and only the free jobs are left
+	for (auto& state : threads_)
+	{
+		for (auto free_job : state->free_jobs)
+		{
+			delete free_job;
+		}
+	}
+	threads_.clear();
+	current_thread_ = nullptr;
+}
+
+void job_system::parallel_for(const size_t first, const size_t last, const size_t grain,
+                              const std::function<void(size_t, size_t)>& function)
+{
+	//hand the upper half of the range to another thread until the range is small enough, then run what is left here
+	struct splitter
+	{
+		static void split(task_group& group, const size_t first, size_t last, const size_t grain,
+		                  const std::function<void(size_t, size_t)>& function)
+		{
+			while (last - first > grain)
+			{
+				const auto middle = first + (last - first) / 2;
+				group.run([&group, middle, last, grain, &function]()
+				{
+					split(group, middle, last, grain, function);
+				});
+				last = middle;
+			}
+			function(first, last);
+		}
+	};
+
+	if (first >= last)
+	{
+		return;
+	}
+	task_group group(*this);
+	try
+	{
+		splitter::split(group, first, last, std::max<size_t>(grain, 1), function);
+	}
+	catch (...)
+	{
+		//the tasks already spawned refer to the function, so they are finished before the error is passed on
+		group.set_error(std::current_exception());
+	}
+	group.wait();
+}
+
+job_system::thread_state& job_system::get_current_thread() const
+{
+	const auto state = current_thread_;
+	if (state == nullptr || state->index >= threads_.size() || threads_[state->index].get() != state)
+	{
+		throw std::runtime_error("tasks can only be spawned and waited on from the threads of their job system!");
+	}
+	return *state;
+}
+
+job* job_system::allocate_job()
+{
+	auto& state = get_current_thread();
+	if (state.free_jobs.empty())
+	{
+		return new job();
+	}
+	const auto free_job = state.free_jobs.back();
+	state.free_jobs.pop_back();
+	return free_job;
+}
+
+void job_system::push(job* pushed)
+{
+	auto& state = get_current_thread();
+	if (!state.deque.push(pushed))
+	{
+		run_job(state, pushed);
+		return;
+	}
+
+	//wake a sleeping thread to take the job. The count of sleeping threads is read after the job is counted, and a
+	//thread counts itself as sleeping before it checks for jobs, so one of the two always sees the other
+	queued_jobs_.fetch_add(1, std::memory_order_seq_cst);
+	if (sleeping_threads_.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		wake_.notify_one();
+	}
+}
+
+bool job_system::run_pending_job(thread_state& state)
+{
+	auto pending = state.deque.pop();
+
+	//steal from the other threads in turn, starting from a random one so thieves spread out
+	if (pending == nullptr && threads_.size() > 1)
+	{
+		state.random ^= state.random << 13;
+		state.random ^= state.random >> 17;
+		state.random ^= state.random << 5;
+		const auto start = state.random % threads_.size();
+		for (size_t i = 0; i < threads_.size() && pending == nullptr; i++)
+		{
+			const auto victim = (start + i) % threads_.size();
+			if (victim != state.index)
+			{
+				pending = threads_[victim]->deque.steal();
+			}
+		}
+	}
+
+	if (pending == nullptr)
+	{
+		return false;
+	}
+	queued_jobs_.fetch_sub(1, std::memory_order_relaxed);
+	run_job(state, pending);
+	return true;
+}
+
+void job_system::run_job(thread_state& state, job* pending)
+{
+	const auto group = pending->group;
+	try
+	{
+		pending->execute(*pending);
+	}
+	catch (...)
+	{
+		group->set_error(std::current_exception());
+	}
+
+	//recycle the job before the group is told, once the count reaches 0 the waiting thread may destroy the group
+	if (state.free_jobs.size() < free_job_limit)
+	{
+		state.free_jobs.push_back(pending);
+	}
+	else
+	{
+		delete pending;
+	}
+	group->pending_.fetch_sub(1, std::memory_order_release);
+}
+
+void job_system::worker_loop(const uint32_t index)
+{
+	auto& state = *threads_[index];
+	current_thread_ = &state;
+
+	while (!stopping_.load(std::memory_order_relaxed))
+	{
+		if (run_pending_job(state))
+		{
+			continue;
+		}
+
+		//look again for a while, a task is often spawned soon after the last one finishes
+		auto found = false;
+		for (uint32_t spin = 0; spin < idle_spin_count && !found; spin++)
+		{
+			std::this_thread::yield();
+			found = run_pending_job(state);
+		}
+		if (found)
+		{
+			continue;
+		}
+
+		//sleep until a job is pushed
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		sleeping_threads_.fetch_add(1, std::memory_order_seq_cst);
+		wake_.wait(lock, [this]
+		{
+			return stopping_.load(std::memory_order_relaxed) || queued_jobs_.load(std::memory_order_seq_cst) > 0;
+		});
+		sleeping_threads_.fetch_sub(1, std::memory_order_relaxed);
+	}
+	current_thread_ = nullptr;
+}
+
+task_group::~task_group()
+{
+	//an error can only be thrown from a destructor by terminating, so it is dropped here
+	try
+	{
+		wait();
+	}
+	catch (...)
+	{
+	}
+}
+
+void task_group::wait()
+{
+	if (pending_.load(std::memory_order_acquire) > 0)
+	{
+		//run any task while waiting, the group's own tasks are usually on this thread's deque
+		auto& state = jobs_.get_current_thread();
+		while (pending_.load(std::memory_order_acquire) > 0)
+		{
+			if (!jobs_.run_pending_job(state))
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(error_mutex_);
+		std::swap(error, error_);
+	}
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void task_group::set_error(const std::exception_ptr error)
+{
+	std::lock_guard<std::mutex> lock(error_mutex_);
+	if (!error_)
+	{
+		error_ = error;
+	}
+}
@@ -0,0 +1,282 @@
+/**
+* \class job_system
+*
+* \brief A fixed set of threads that run small tasks, balancing the work between them by stealing
+*
+* Every thread, including the one that started the system, has a Chase-Lev deque of tasks.
+* A thread pushes the tasks it spawns onto the bottom of its own deque and pops them from the
+* bottom again, newest first, so the owner never contends with anyone while it has work. A
+* thread that runs out steals the oldest task from the top of another thread's deque, which
+* for recursively split work is the largest piece left. Tasks belong to a task group, and
+* waiting on a group runs other tasks until the group's tasks are finished rather than
+* blocking, so groups can be nested. Idle threads spin briefly and then sleep until a task is
+* pushed. Tasks are stored in fixed size jobs that are recycled through a free list on each
+* thread, so spawning a task does not allocate once the lists are warm.
+*/
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class task_group;
+
+/**
+* \brief A task waiting to run, the callable is stored in place
+*/
+struct job
+{
+	static const size_t storage_size = 64;
+
+	void (*execute)(job& self); //runs the callable and destroys it
+	task_group* group; //the group the task belongs to
+	std::aligned_storage<storage_size, alignof(std::max_align_t)>::type storage;
+};
+
+/**
+* \class work_stealing_deque
+*
+* \brief A Chase-Lev deque of a fixed capacity. Only the owning thread pushes and pops, at the bottom, any thread can
+* steal from the top. The memory orders follow Le et al., Correct and Efficient Work-Stealing for Weak Memory Models
+*/
+class work_stealing_deque
+{
+public:
+	/**
+	* \brief Create the deque
+	* \param capacity the number of jobs it holds, a power of 2
+	*/
+	explicit work_stealing_deque(size_t capacity);
+
+	/**
+	* \brief Push a job onto the bottom, only called by the owner
+	* \param pushed the job
+	* \return false if the deque is full
+	*/
+	bool push(job* pushed);
+
+	/**
+	* \brief Pop the newest job from the bottom, only called by the owner
+	* \return the job, or null if the deque is empty or the last job was stolen
+	*/
+	job* pop();
+
+	/**
+	* \brief Steal the oldest job from the top
+	* \return the job, or null if the deque is empty or another thread took the job first
+	*/
+	job* steal();
+
+private:
+	//the owner and the thieves write different ends, so the ends are padded onto cache lines of their own
+	std::atomic<int64_t> top_{0};
+	char top_padding_[64];
+	std::atomic<int64_t> bottom_{0};
+	char bottom_padding_[64];
+	std::unique_ptr<std::atomic<job*>[]> jobs_;
+	int64_t mask_;
+};
+
+class job_system
+{
+public:
+	job_system() = default;
+	job_system(const job_system&) = delete;
+	job_system& operator=(const job_system&) = delete;
+
+	/**
+	* \brief Stop the threads if they are still running, so an error cannot leave them running
+	*/
+	~job_system();
+
+	/**
+	* \brief Start the threads, the calling thread becomes the first thread of the system
+	* \param thread_count the number of threads including the calling thread, 0 uses every hardware thread
+	*/
+	void init(uint32_t thread_count);
+
+	/**
+	* \brief Stop the threads, every task group must have been waited on. Does nothing if the system is not running
+	*/
+	void destroy();
+
+	/**
+	* \brief Obtain the number of threads, including the thread that started the system
+	* \return the number of threads
+	*/
+	uint32_t get_thread_count() const
+	{
+		return static_cast<uint32_t>(threads_.size());
+	}
+
+	/**
+	* \brief Call a function on ranges of indices from the threads of the system, and wait for every range. The range is
+	* split in half recursively, so idle threads steal large pieces first
+	* \param first the first index
+	* \param last one past the last index
+	* \param grain the largest range the function is called with, ranges this size or smaller are not split
+	* \param function called with the first and one past the last index of each range
+	*/
+	void parallel_for(size_t first, size_t last, size_t grain, const std::function<void(size_t, size_t)>& function);
+
+private:
+	friend class task_group;
+
+	/**
+	* \brief The deque, free jobs and steal state of one thread
+	*/
+	struct thread_state
+	{
+		explicit thread_state(size_t capacity) : deque(capacity)
+		{
+		}
+
+		work_stealing_deque deque;
+		std::vector<job*> free_jobs; //only touched by the thread itself
+		uint32_t index = 0;
+		uint32_t random = 0; //chooses the thread to steal from
+	};
+
+	static thread_local thread_state* current_thread_; //the state of the calling thread, null if it has none
+
+	std::vector<std::unique_ptr<thread_state>> threads_; //the first is the thread that started the system
+	std::vector<std::thread> workers_; //the threads started by the system
+
+	//idle threads sleep until a job is pushed
+	std::atomic<int64_t> queued_jobs_{0};
+	std::atomic<uint32_t> sleeping_threads_{0};
+	std::atomic<bool> stopping_{false};
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+
+	/**
+	* \brief Obtain the state of the calling thread
+	* \return the state, an error is thrown if the thread does not belong to the system
+	*/
+	thread_state& get_current_thread() const;
+
+	/**
+	* \brief Take a free job from the calling thread, or allocate one
+	* \return the job
+	*/
+	job* allocate_job();
+
+	/**
+	* \brief Push a job onto the calling thread's deque, or run it straight away if the deque is full
+	* \param pushed the job
+	*/
+	void push(job* pushed);
+
+	/**
+	* \brief Run one job, the calling thread's newest job or one stolen from another thread
+	* \param state the state of the calling thread
+	* \return false if there was no job to run
+	*/
+	bool run_pending_job(thread_state& state);
+
+	/**
+	* \brief Run a job, record any error in its group, then recycle the job on the calling thread
+	* \param state the state of the calling thread
+	* \param pending the job
+	*/
+	void run_job(thread_state& state, job* pending);
+
+	/**
+	* \brief Run jobs until the system is destroyed
+	* \param index the index of the thread's state
+	*/
+	void worker_loop(uint32_t index);
+};
+
+/**
+* \class task_group
+*
+* \brief A set of tasks that can be waited on together. The first error thrown by a task is rethrown by wait
+*/
+class task_group
+{
+public:
+	/**
+	* \brief Create an empty group
+	* \param jobs the job system the tasks run on
+	*/
+	explicit task_group(job_system& jobs) : jobs_(jobs)
+	{
+	}
+
+	task_group(const task_group&) = delete;
+	task_group& operator=(const task_group&) = delete;
+
+	/**
+	* \brief Wait for any tasks that are left, so none of them outlives what it refers to
+	*/
+	~task_group();
+
+	/**
+	* \brief Spawn a task, which may run on any thread of the system. Only the system's threads can spawn tasks
+	* \param function the callable to run, its captures have to fit in a job
+	*/
+	template <typename Function>
+	void run(Function function);
+
+	/**
+	* \brief Run tasks until every task of the group has finished, then rethrow the first error any of them threw
+	*/
+	void wait();
+
+private:
+	friend class job_system;
+
+	job_system& jobs_;
+	std::atomic<uint32_t> pending_{0}; //tasks spawned and not yet finished
+	std::mutex error_mutex_;
+	std::exception_ptr error_;
+
+	/**
+	* \brief Keep the first error thrown by a task
+	* \param error the error
+	*/
+	void set_error(std::exception_ptr error);
+};
+
+template <typename Function>
+void task_group::run(Function function)
+{
+	static_assert(sizeof(Function) <= job::storage_size && alignof(Function) <= alignof(std::max_align_t),
+		"the task's captures do not fit in a job, capture a pointer to them instead");
+
+	auto spawned = jobs_.allocate_job();
+	new(&spawned->storage) Function(std::move(function));
+	spawned->execute = [](job& self)
+	{
+		auto& callable = *reinterpret_cast<Function*>(&self.storage);
+		//the callable is destroyed even if it throws
+		struct destroy_callable
+		{
+			Function& callable;
+
+			~destroy_callable()
+			{
+				callable.~Function();
+			}
+		} guard = {callable};
+		callable();
+	};
+	spawned->group = this;
+	pending_.fetch_add(1, std::memory_order_relaxed);
+	jobs_.push(spawned);
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "job_system_benchmark.h"
+#include "benchmark_helpers.h"
+#include "culling_benchmark.h"
+#include "frame_statistics.h"
+#include "job_system.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+//the empty tasks spawned by each spawn test, in batches that fit in a thread's deque
+static const uint32_t spawn_task_count = 1 << 20;
+static const uint32_t spawn_batch_size = 1024;
+
+//the elements of the compute kernel, and the objects of the parallel cull
+static const uint32_t kernel_element_count = 1 << 20;
+static const uint32_t culling_object_count = 1 << 22;
+
+/**
+* \brief Run a test several times
+* \param runs the number of timed runs
+* \param test the test
+* \return the median time of a run in milliseconds
+*/
+static double time_median(const uint32_t runs, const std::function<void()>& test)
+{
+	std::vector<double> timings;
+	for (uint32_t run = 0; run < std::max<uint32_t>(runs, 1); run++)
+	{
+		const auto start_time = std::chrono::high_resolution_clock::now();
+		test();
+		timings.push_back(frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now()));
+	}
+	std::sort(timings.begin(), timings.end());
+	return timings[timings.size() / 2];
+}
+
+void run_job_system_benchmark(const uint32_t max_threads, const uint32_t runs, std::ostream& stream)
+{
+	const auto thread_counts = get_thread_sweep(max_threads);
+
+	//the scene of the culling benchmark, culled on the job system instead of one thread
+	frustum_culler culler;
+	fill_random_culling_scene(culler, culling_object_count);
+	const auto clip_from_object = get_random_culling_camera();
+	std::vector<uint32_t> visible;
+	std::vector<float> elements(kernel_element_count);
+
+	stream << "job system, median of " << runs << " runs, " << std::thread::hardware_concurrency() <<
+		" hardware threads" << std::endl << std::fixed << std::setprecision(2);
+
+	double kernel_single_ms = 0.0;
+	double culling_single_ms = 0.0;
+	for (const auto count : thread_counts)
+	{
+		job_system jobs;
+		jobs.init(count);
+
+		//spawn from one thread, the other threads steal the tasks as they are pushed
+		const auto group_ms = time_median(runs, [&]
+		{
+			task_group group(jobs);
+			for (uint32_t first = 0; first < spawn_task_count; first += spawn_batch_size)
+			{
+				for (uint32_t i = 0; i < spawn_batch_size; i++)
+				{
+					group.run([]
+					{
+					});
+				}
+				group.wait();
+			}
+		});
+
+		//split a range down to single indices, every split spawns a task
+		const auto parallel_for_ms = time_median(runs, [&]
+		{
+			jobs.parallel_for(0, spawn_task_count, 1, [](size_t, size_t)
+			{
+			});
+		});
+
+		//a few hundred operations per element, so the kernel is bound by the threads rather than memory
+		const auto kernel_ms = time_median(runs, [&]
+		{
+			jobs.parallel_for(0, elements.size(), 4096, [&](const size_t first, const size_t last)
+			{
+				for (auto i = first; i < last; i++)
+				{
+					auto value = static_cast<float>(i);
+					for (uint32_t step = 0; step < 64; step++)
+					{
+						value = std::sqrt(value * 1.0001F + 1.0F);
+					}
+					elements[i] = value;
+				}
+			});
+		});
+
+		const auto culling_ms = time_median(runs, [&]
+		{
+			culler.cull(clip_from_object, culling_volume_box, visible, jobs);
+		});
+		jobs.destroy();
+
+		if (count == 1)
+		{
+			kernel_single_ms = kernel_ms;
+			culling_single_ms = culling_ms;
+		}
+		const auto kernel_speedup = kernel_single_ms / std::max(kernel_ms, 0.001);
+		const auto culling_speedup = culling_single_ms / std::max(culling_ms, 0.001);
+		stream << std::setw(3) << count << " threads: spawn " << group_ms * 1000000.0 / spawn_task_count <<
+			" ns per task from one thread, " << parallel_for_ms * 1000000.0 / spawn_task_count <<
+			" ns per task split by parallel_for" << std::endl << "             kernel " << kernel_ms << " ms, " <<
+			kernel_speedup << "x, " << kernel_speedup * 100.0 / count << "% efficient, culling " << culling_ms <<
+			" ms, " << culling_speedup << "x, " << culling_speedup * 100.0 / count << "% efficient, " <<
+			visible.size() << " visible" << std::endl;
+	}
+}
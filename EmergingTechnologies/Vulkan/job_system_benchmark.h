@@ -0,0 +1,27 @@
+/**
+* \brief Measure the overhead of spawning tasks on the job system, and how its work scales with threads
+*
+* The spawn tests run empty tasks, so only the cost of the job system is measured. Tasks are
+* spawned in batches from one thread into a task group that is then waited on, and spawned by
+* parallel_for splitting a range down to single indices, which spreads the spawning across the
+* threads. Both are reported as nanoseconds per task. The scaling tests run a compute bound
+* kernel over many elements, and a parallel frustum cull of many objects, with each number of
+* threads from one up to the maximum, doubling each time. They report the median time, the
+* speedup over one thread and the efficiency, the speedup divided by the number of threads.
+*/
+
+#ifndef JOB_SYSTEM_BENCHMARK_H
+#define JOB_SYSTEM_BENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+
+/**
+* \brief Run the benchmark and print the results
+* \param max_threads the largest number of threads
+* \param runs the number of timed runs of each test
+* \param stream the stream to print to
+*/
+void run_job_system_benchmark(uint32_t max_threads, uint32_t runs, std::ostream& stream);
+
+#endif
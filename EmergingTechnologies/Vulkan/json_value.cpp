@@ -0,0 +1,350 @@
+#include "json_value.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+const std::string json_value::empty_string_;
+const json_value json_value::null_value_;
+
+//documents nested deeper than this are rejected rather than overflowing the stack
+static const int max_depth = 256;
+
+/**
+* \brief A recursive descent parser over a block of text
+*/
+class json_value::parser
+{
+public:
+	parser(const char* text, const size_t size) : current_(text), end_(text + size)
+	{
+	}
+
+	json_value parse_document()
+	{
+		auto value = parse_value(0);
+		skip_whitespace();
+		if (current_ != end_)
+		{
+			fail("unexpected data after the document");
+		}
+		return value;
+	}
+
+private:
+	const char* current_;
+	const char* end_;
+
+	[[noreturn]] static void fail(const char* reason)
+	{
+		throw std::runtime_error(std::string("failed to parse json: ") + reason + "!");
+	}
+
+	void skip_whitespace()
+	{
+		while (current_ != end_ && (*current_ == ' ' || *current_ == '\t' || *current_ == '\n' || *current_ == '\r'))
+		{
+			++current_;
+		}
+	}
+
+	char peek()
+	{
+		skip_whitespace();
+		if (current_ == end_)
+		{
+			fail("unexpected end of document");
+		}
+		return *current_;
+	}
+
+	void expect(const char character)
+	{
+		if (peek() != character)
+		{
+			fail("unexpected character");
+		}
+		++current_;
+	}
+
+	bool consume_literal(const char* literal)
+	{
+		const auto length = strlen(literal);
+		if (static_cast<size_t>(end_ - current_) < length || strncmp(current_, literal, length) != 0)
+		{
+			return false;
+		}
+		current_ += length;
+		return true;
+	}
+
+	json_value parse_value(const int depth)
+	{
+		if (depth > max_depth)
+		{
+			fail("document is nested too deeply");
+		}
+
+		json_value value;
+		const auto character = peek();
+		if (character == '{')
+		{
+			value.type_ = type::object;
+			++current_;
+			if (peek() == '}')
+			{
+				++current_;
+				return value;
+			}
+			for (;;)
+			{
+				if (peek() != '"')
+				{
+					fail("expected a member name");
+				}
+				auto key = parse_string();
+				expect(':');
+				value.members_.emplace_back(std::move(key), parse_value(depth + 1));
+				if (peek() == ',')
+				{
+					++current_;
+					continue;
+				}
+				expect('}');
+				return value;
+			}
+		}
+		if (character == '[')
+		{
+			value.type_ = type::array;
+			++current_;
+			if (peek() == ']')
+			{
+				++current_;
+				return value;
+			}
+			for (;;)
+			{
+				value.elements_.push_back(parse_value(depth + 1));
+				if (peek() == ',')
+				{
+					++current_;
+					continue;
+				}
+				expect(']');
+				return value;
+			}
+		}
+		if (character == '"')
+		{
+			value.type_ = type::string;
+			value.string_ = parse_string();
+			return value;
+		}
+		if (consume_literal("true"))
+		{
+			value.type_ = type::boolean;
+			value.number_ = 1.0;
+			return value;
+		}
+		if (consume_literal("false"))
+		{
+			value.type_ = type::boolean;
+			return value;
+		}
+		if (consume_literal("null"))
+		{
+			return value;
+		}
+		if (character == '-' || (character >= '0' && character <= '9'))
+		{
+			value.type_ = type::number;
+			value.number_ = parse_number();
+			return value;
+		}
+		fail("unexpected character");
+	}
+
+	double parse_number()
+	{
+		//strtod needs a terminated string, and a number is never longer than a few dozen characters
+		const auto begin = current_;
+		while (current_ != end_ && strchr("+-.eE0123456789", *current_) != nullptr)
+		{
+			++current_;
+		}
+		const std::string text(begin, current_);
+		char* parsed_end = nullptr;
+		const auto number = strtod(text.c_str(), &parsed_end);
+		if (parsed_end != text.c_str() + text.size())
+		{
+			fail("invalid number");
+		}
+		return number;
+	}
+
+	uint32_t parse_hex4()
+	{
+		if (end_ - current_ < 4)
+		{
+			fail("invalid escape sequence");
+		}
+		uint32_t code = 0;
+		for (auto i = 0; i < 4; i++)
+		{
+			const auto character = *current_++;
+			code <<= 4;
+			if (character >= '0' && character <= '9')
+			{
+				code |= character - '0';
+			}
+			else if (character >= 'a' && character <= 'f')
+			{
+				code |= character - 'a' + 10;
+			}
+			else if (character >= 'A' && character <= 'F')
+			{
+				code |= character - 'A' + 10;
+			}
+			else
+			{
+				fail("invalid escape sequence");
+			}
+		}
+		return code;
+	}
+
+	static void append_utf8(std::string& string, const uint32_t code)
+	{
+		if (code < 0x80)
+		{
+			string += static_cast<char>(code);
+		}
+		else if (code < 0x800)
+		{
+			string += static_cast<char>(0xc0 | (code >> 6));
+			string += static_cast<char>(0x80 | (code & 0x3f));
+		}
+		else if (code < 0x10000)
+		{
+			string += static_cast<char>(0xe0 | (code >> 12));
+			string += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+			string += static_cast<char>(0x80 | (code & 0x3f));
+		}
+		else
+		{
+			string += static_cast<char>(0xf0 | (code >> 18));
+			string += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+			string += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+			string += static_cast<char>(0x80 | (code & 0x3f));
+		}
+	}
+
+	std::string parse_string()
+	{
+		expect('"');
+		std::string string;
+		for (;;)
+		{
+			if (current_ == end_)
+			{
+				fail("unterminated string");
+			}
+			const auto character = *current_++;
+			if (character == '"')
+			{
+				return string;
+			}
+			if (character != '\\')
+			{
+				string += character;
+				continue;
+			}
+
+			if (current_ == end_)
+			{
+				fail("unterminated string");
+			}
+			switch (*current_++)
+			{
+			case '"': string += '"'; break;
+			case '\\': string += '\\'; break;
+			case '/': string += '/'; break;
+			case 'b': string += '\b'; break;
+			case 'f': string += '\f'; break;
+			case 'n': string += '\n'; break;
+			case 'r': string += '\r'; break;
+			case 't': string += '\t'; break;
+			case 'u':
+				{
+					auto code = parse_hex4();
+					//characters outside the basic multilingual plane are written as a surrogate pair
+					if (code >= 0xd800 && code < 0xdc00 && consume_literal("\\u"))
+					{
+						const auto low = parse_hex4();
+						code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+					}
+					append_utf8(string, code);
+					break;
+				}
+			default:
+				fail("invalid escape sequence");
+			}
+		}
+	}
+};
+
+json_value json_value::parse(const char* text, const size_t size)
+{
+	return parser(text, size).parse_document();
+}
+
+bool json_value::as_bool(const bool fallback) const
+{
+	return type_ == type::boolean ? number_ != 0.0 : fallback;
+}
+
+double json_value::as_number(const double fallback) const
+{
+	return type_ == type::number ? number_ : fallback;
+}
+
+const std::string& json_value::as_string(const std::string& fallback) const
+{
+	return type_ == type::string ? string_ : fallback;
+}
+
+size_t json_value::size() const
+{
+	if (type_ == type::array)
+	{
+		return elements_.size();
+	}
+	if (type_ == type::object)
+	{
+		return members_.size();
+	}
+	return 0;
+}
+
+const json_value& json_value::operator[](const size_t index) const
+{
+	if (type_ != type::array || index >= elements_.size())
+	{
+		return null_value_;
+	}
+	return elements_[index];
+}
+
+const json_value& json_value::operator[](const std::string& key) const
+{
+	//scenes have a handful of members per object, a linear search is faster than building a map
+	for (const auto& member : members_)
+	{
+		if (member.first == key)
+		{
+			return member.second;
+		}
+	}
+	return null_value_;
+}
@@ -0,0 +1,127 @@
+/**
+* \class json_value
+*
+* \brief A parsed JSON document
+*
+* Just enough JSON to read scene descriptions. Objects keep their members in the order
+* they appear in the file, and looking up a member or element that does not exist returns
+* a shared null value rather than throwing, so optional fields can be read without
+* checking for them first.
+*/
+
+#ifndef JSON_VALUE_H
+#define JSON_VALUE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class json_value
+{
+public:
+	enum class type
+	{
+		null,
+		boolean,
+		number,
+		string,
+		array,
+		object
+	};
+
+	/**
+	* \brief Parse a JSON document
+	* \param text the document, which does not need to be null terminated
+	* \param size the length of the document in bytes
+	* \return the root value
+	*/
+	static json_value parse(const char* text, size_t size);
+
+	/**
+	* \brief Obtain the type of the value
+	* \return the type
+	*/
+	type get_type() const
+	{
+		return type_;
+	}
+
+	bool is_null() const
+	{
+		return type_ == type::null;
+	}
+
+	bool is_array() const
+	{
+		return type_ == type::array;
+	}
+
+	bool is_object() const
+	{
+		return type_ == type::object;
+	}
+
+	/**
+	* \brief Obtain a boolean
+	* \param fallback the value to return if this is not a boolean
+	* \return the boolean
+	*/
+	bool as_bool(bool fallback = false) const;
+
+	/**
+	* \brief Obtain a number
+	* \param fallback the value to return if this is not a number
+	* \return the number
+	*/
+	double as_number(double fallback = 0.0) const;
+
+	/**
+	* \brief Obtain a string
+	* \param fallback the value to return if this is not a string
+	* \return the string
+	*/
+	const std::string& as_string(const std::string& fallback = empty_string_) const;
+
+	/**
+	* \brief Obtain the number of elements of an array or members of an object
+	* \return the count, 0 for any other type
+	*/
+	size_t size() const;
+
+	/**
+	* \brief Obtain an element of an array
+	* \param index the index of the element
+	* \return the element, or a null value if this is not an array or the index is out of range
+	*/
+	const json_value& operator[](size_t index) const;
+
+	/**
+	* \brief Obtain a member of an object
+	* \param key the name of the member
+	* \return the member, or a null value if this is not an object or has no such member
+	*/
+	const json_value& operator[](const std::string& key) const;
+
+	/**
+	* \brief Obtain the members of an object in the order they appear in the document
+	* \return the members, empty if this is not an object
+	*/
+	const std::vector<std::pair<std::string, json_value>>& get_members() const
+	{
+		return members_;
+	}
+
+private:
+	class parser;
+
+	type type_ = type::null;
+	double number_ = 0.0;
+	std::string string_;
+	std::vector<json_value> elements_;
+	std::vector<std::pair<std::string, json_value>> members_;
+
+	static const std::string empty_string_;
+	static const json_value null_value_;
+};
+
+#endif
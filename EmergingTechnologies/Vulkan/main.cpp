@@ -1,5 +1,148 @@
 #include "vulkan_application.h"
+#include "scene_load_benchmark.h"
+#include "instancing_benchmark.h"
+#include "culling_benchmark.h"
+#include "recording_benchmark.h"
+#include "job_system_benchmark.h"
+#include "pipeline_variant_benchmark.h"
+#include "draw_data_benchmark.h"
 #include <iostream>
+#include <string>
+#include <thread>
+
+/**
+ * \brief Convert a command line value to an unsigned integer
+ * \param argument the name of the argument, used for error reporting
+ * \param value the value to convert
+ * \return the converted value
+ */
+static uint32_t parse_unsigned(const std::string& argument, const std::string& value)
+{
+	try
+	{
+		return static_cast<uint32_t>(std::stoul(value));
+	}
+	catch (const std::logic_error&)
+	{
+		throw std::runtime_error("invalid value " + value + " for argument " + argument);
+	}
+}
+
+/**
+ * \brief Convert a command line value to the way the draws are given their transforms
+ * \param argument the name of the argument, used for error reporting
+ * \param value instanced, push, uniform or storage
+ * \return the converted value
+ */
+static draw_data_path parse_draw_data(const std::string& argument, const std::string& value)
+{
+	const std::string names[] = {"instanced", "push", "uniform", "storage"};
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		if (value == names[i])
+		{
+			return static_cast<draw_data_path>(i);
+		}
+	}
+	throw std::runtime_error("invalid value " + value + " for argument " + argument);
+}
+
+/**
+ * \brief Read the application settings from the command line
+ * \param argc the number of arguments
+ * \param argv the arguments
+ * \return the settings to run the application with
+ */
+static application_settings parse_arguments(int argc, char * argv[])
+{
+	application_settings settings;
+
+	for (auto i = 1; i < argc; i++)
+	{
+		const std::string argument = argv[i];
+
+		//every option takes a value, so make sure one follows it
+		if (i + 1 >= argc)
+		{
+			throw std::runtime_error("missing value for argument " + argument);
+		}
+
+		if (argument == "--frames-in-flight")
+		{
+			settings.max_frames_in_flight = parse_unsigned(argument, argv[++i]);
+		}
+		else if (argument == "--transfer-queue")
+		{
+			settings.use_transfer_queue = parse_unsigned(argument, argv[++i]) != 0;
+		}
+		else if (argument == "--headless")
+		{
+			settings.headless = parse_unsigned(argument, argv[++i]) != 0;
+		}
+		else if (argument == "--frames")
+		{
+			settings.frame_count = parse_unsigned(argument, argv[++i]);
+		}
+		else if (argument == "--stats")
+		{
+			settings.statistics_path = argv[++i];
+		}
+		else if (argument == "--pipeline-cache")
+		{
+			settings.pipeline_cache_path = argv[++i];
+		}
+		else if (argument == "--shader-cache")
+		{
+			settings.shader_cache_path = argv[++i];
+		}
+		else if (argument == "--pipeline-threads")
+		{
+			settings.pipeline_threads = parse_unsigned(argument, argv[++i]);
+		}
+		else if (argument == "--shader-features")
+		{
+			settings.shader_features = parse_unsigned(argument, argv[++i]);
+		}
+		else if (argument == "--scene")
+		{
+			settings.scene_path = argv[++i];
+		}
+		else if (argument == "--instances")
+		{
+			settings.instance_count = parse_unsigned(argument, argv[++i]);
+		}
+		else if (argument == "--cpu-culling")
+		{
+			settings.cpu_culling = parse_unsigned(argument, argv[++i]) != 0;
+		}
+		else if (argument == "--gpu-culling")
+		{
+			settings.gpu_culling = parse_unsigned(argument, argv[++i]) != 0;
+		}
+		else if (argument == "--worker-threads")
+		{
+			settings.worker_threads = parse_unsigned(argument, argv[++i]);
+		}
+		else if (argument == "--recording-threads")
+		{
+			settings.recording_threads = parse_unsigned(argument, argv[++i]);
+		}
+		else if (argument == "--draw-data")
+		{
+			settings.draw_data = parse_draw_data(argument, argv[++i]);
+		}
+		else if (argument == "--dynamic-recording")
+		{
+			settings.dynamic_recording = parse_unsigned(argument, argv[++i]) != 0;
+		}
+		else
+		{
+			throw std::runtime_error("unknown argument " + argument);
+		}
+	}
+
+	return settings;
+}
 
 /**
  * \brief The entry point of the Vulkan Example
@@ -7,10 +150,75 @@
  */
 int main(int argc, char * argv[])
 {
-	vulkan_application app;
-
 	try
 	{
+		//tools that run without a window or a device
+		if (argc >= 4 && argc <= 6 && std::string(argv[1]) == "--bake")
+		{
+			//the optimizer runs unless it is turned off with a 0 after the output path, a 1 after that quantizes
+			const auto optimize = argc < 5 || parse_unsigned(argv[1], argv[4]) != 0;
+			const auto quantize = argc == 6 && parse_unsigned(argv[1], argv[5]) != 0;
+			gltf_model model;
+			model.load(argv[2]);
+			job_system jobs;
+			jobs.init(0);
+			baked_mesh::bake(model, argv[3], optimize, quantize, &std::cout, &jobs);
+			std::cout << "baked " << argv[2] << " to " << argv[3] << std::endl;
+			return EXIT_SUCCESS;
+		}
+		if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--benchmark-scene-load")
+		{
+			const auto copies = argc == 4 ? parse_unsigned(argv[1], argv[3]) : 256;
+			run_scene_load_benchmark(argv[2], copies, 20, std::cout);
+			return EXIT_SUCCESS;
+		}
+		if ((argc == 2 || argc == 3) && std::string(argv[1]) == "--benchmark-culling")
+		{
+			const auto object_count = argc == 3 ? parse_unsigned(argv[1], argv[2]) : 1000000;
+			run_culling_benchmark(object_count, 20, std::cout);
+			return EXIT_SUCCESS;
+		}
+		if ((argc == 2 || argc == 3) && std::string(argv[1]) == "--benchmark-jobs")
+		{
+			const auto max_threads = argc == 3 ? parse_unsigned(argv[1], argv[2]) : std::thread::hardware_concurrency();
+			run_job_system_benchmark(max_threads, 10, std::cout);
+			return EXIT_SUCCESS;
+		}
+		if (argc >= 3 && argc <= 5 && std::string(argv[1]) == "--benchmark-instances")
+		{
+			const auto max_instances = argc >= 4 ? parse_unsigned(argv[1], argv[3]) : 1000000;
+			const auto frames = argc == 5 ? parse_unsigned(argv[1], argv[4]) : 200;
+			run_instancing_benchmark(argv[2], max_instances, frames, std::cout);
+			return EXIT_SUCCESS;
+		}
+		if (argc >= 3 && argc <= 5 && std::string(argv[1]) == "--benchmark-recording")
+		{
+			const auto copies = argc >= 4 ? parse_unsigned(argv[1], argv[3]) : 1024;
+			const auto max_threads = argc == 5 ? parse_unsigned(argv[1], argv[4]) : std::thread::hardware_concurrency();
+			run_recording_benchmark(argv[2], copies, max_threads, 20, std::cout);
+			return EXIT_SUCCESS;
+		}
+		if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--benchmark-variants")
+		{
+			const auto runs = argc == 4 ? parse_unsigned(argv[1], argv[3]) : 10;
+			run_pipeline_variant_benchmark(argv[2], runs, std::cout);
+			return EXIT_SUCCESS;
+		}
+		if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--benchmark-draw-data")
+		{
+			const auto frames = argc == 4 ? parse_unsigned(argv[1], argv[3]) : 200;
+			run_draw_data_benchmark(argv[2], frames, std::cout);
+			return EXIT_SUCCESS;
+		}
+		if (argc >= 3 && argc <= 5 && std::string(argv[1]) == "--benchmark-submission")
+		{
+			const auto copies = argc >= 4 ? parse_unsigned(argv[1], argv[3]) : 1024;
+			const auto frames = argc == 5 ? parse_unsigned(argv[1], argv[4]) : 500;
+			run_submission_benchmark(argv[2], copies, frames, std::thread::hardware_concurrency(), std::cout);
+			return EXIT_SUCCESS;
+		}
+
+		vulkan_application app(parse_arguments(argc, argv));
 		app.run();
 	}
 	catch (const std::runtime_error& e)
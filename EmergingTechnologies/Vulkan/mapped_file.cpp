@@ -0,0 +1,121 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_file::~mapped_file()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+void mapped_file::open(const std::string& path)
+{
+	close();
+
+	file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+	                    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file_ == INVALID_HANDLE_VALUE)
+	{
+		file_ = nullptr;
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file_, &file_size);
+	size_ = static_cast<size_t>(file_size.QuadPart);
+
+	//an empty file cannot be mapped, but there is nothing to read anyway
+	if (size_ == 0)
+	{
+		return;
+	}
+
+	mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_ != nullptr)
+	{
+		data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (data_ == nullptr)
+	{
+		close();
+		throw std::runtime_error("failed to map " + path + "!");
+	}
+}
+
+void mapped_file::close()
+{
+	if (data_ != nullptr)
+	{
+		UnmapViewOfFile(data_);
+	}
+	if (mapping_ != nullptr)
+	{
+		CloseHandle(mapping_);
+	}
+	if (file_ != nullptr)
+	{
+		CloseHandle(file_);
+	}
+
+	data_ = nullptr;
+	size_ = 0;
+	mapping_ = nullptr;
+	file_ = nullptr;
+}
+
+#else
+
+void mapped_file::open(const std::string& path)
+{
+	close();
+
+	const auto file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	struct stat file_stat;
+	if (fstat(file, &file_stat) != 0)
+	{
+		::close(file);
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+
+	//the mapping keeps its own reference to the file, so the descriptor is not needed afterwards
+	if (size_ > 0)
+	{
+		const auto data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED)
+		{
+			::close(file);
+			size_ = 0;
+			throw std::runtime_error("failed to map " + path + "!");
+		}
+		data_ = static_cast<const char*>(data);
+	}
+	::close(file);
+}
+
+void mapped_file::close()
+{
+	if (data_ != nullptr)
+	{
+		munmap(const_cast<char*>(data_), size_);
+	}
+
+	data_ = nullptr;
+	size_ = 0;
+}
+
+#endif
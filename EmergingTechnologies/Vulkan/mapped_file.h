@@ -0,0 +1,65 @@
+/**
+* \class mapped_file
+*
+* \brief Map a file into memory read only
+*
+* The contents of the file are paged in by the OS as they are read, so data can be copied
+* straight from the file to where it is needed without first reading it into a buffer.
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+class mapped_file
+{
+public:
+	mapped_file() = default;
+	~mapped_file();
+
+	//the mapping is owned by a single object
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	/**
+	* \brief Map a file, any file that is already mapped is closed first
+	* \param path the file to map
+	*/
+	void open(const std::string& path);
+
+	/**
+	* \brief Unmap the file
+	*/
+	void close();
+
+	/**
+	* \brief Obtain the contents of the file
+	* \return a pointer to the first byte, null if no file is mapped
+	*/
+	const char* data() const
+	{
+		return data_;
+	}
+
+	/**
+	* \brief Obtain the size of the file
+	* \return the size in bytes
+	*/
+	size_t size() const
+	{
+		return size_;
+	}
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+
+#ifdef _WIN32
+	void* file_ = nullptr; //the file handle
+	void* mapping_ = nullptr; //the file mapping handle
+#endif
+};
+
+#endif
@@ -0,0 +1,340 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <stdexcept>
+
+/**
+* \brief A FIFO post-transform cache, vertices are only added when they miss and the oldest is evicted
+*/
+class fifo_cache
+{
+public:
+	fifo_cache(const size_t vertex_count, const uint32_t cache_size) : cache_size_(cache_size),
+	                                                                   entry_time_(vertex_count, 0)
+	{
+	}
+
+	/**
+	* \brief Look a vertex up, adding it if it is not in the cache
+	* \param vertex the vertex
+	* \return true if the vertex had to be transformed
+	*/
+	bool miss(const uint32_t vertex)
+	{
+		//a vertex is in the cache if fewer than cache_size vertices have been added since it was
+		if (entry_time_[vertex] != 0 && time_ - entry_time_[vertex] < cache_size_)
+		{
+			return false;
+		}
+		entry_time_[vertex] = ++time_;
+		return true;
+	}
+
+private:
+	uint64_t cache_size_;
+	uint64_t time_ = 0;
+	std::vector<uint64_t> entry_time_;
+};
+
+/**
+* \brief Check that a triangle list is complete and in range
+* \param indices the triangle list
+* \param vertex_count the number of vertices
+*/
+static void validate(const std::vector<uint32_t>& indices, const size_t vertex_count)
+{
+	if (indices.size() % 3 != 0)
+	{
+		throw std::runtime_error("triangle lists must have a multiple of 3 indices!");
+	}
+	for (const auto index : indices)
+	{
+		if (index >= vertex_count)
+		{
+			throw std::runtime_error("triangle list index is out of range!");
+		}
+	}
+}
+
+vertex_cache_statistics analyze_vertex_cache(const std::vector<uint32_t>& indices, const size_t vertex_count,
+                                             const uint32_t cache_size)
+{
+	validate(indices, vertex_count);
+
+	vertex_cache_statistics statistics;
+	if (indices.empty())
+	{
+		return statistics;
+	}
+
+	fifo_cache cache(vertex_count, cache_size);
+	std::vector<bool> used(vertex_count, false);
+	size_t transformed = 0;
+	size_t used_count = 0;
+	for (const auto index : indices)
+	{
+		transformed += cache.miss(index) ? 1 : 0;
+		if (!used[index])
+		{
+			used[index] = true;
+			used_count++;
+		}
+	}
+
+	statistics.acmr = static_cast<double>(transformed) / (indices.size() / 3);
+	statistics.atvr = static_cast<double>(transformed) / used_count;
+	return statistics;
+}
+
+std::vector<size_t> optimize_vertex_cache(std::vector<uint32_t>& indices, const size_t vertex_count,
+                                          const uint32_t cache_size)
+{
+	validate(indices, vertex_count);
+	const auto triangle_count = indices.size() / 3;
+	std::vector<size_t> hard_boundaries;
+
+	//the triangles that use each vertex, as offsets into one array
+	std::vector<uint32_t> live_triangles(vertex_count, 0);
+	for (const auto index : indices)
+	{
+		live_triangles[index]++;
+	}
+	std::vector<size_t> adjacency_offsets(vertex_count + 1, 0);
+	for (size_t vertex = 0; vertex < vertex_count; vertex++)
+	{
+		adjacency_offsets[vertex + 1] = adjacency_offsets[vertex] + live_triangles[vertex];
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		auto fill = adjacency_offsets;
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<uint64_t> cache_time(vertex_count, 0); //when each vertex last entered the cache
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<uint32_t> dead_end_stack;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	uint64_t time = cache_size + 1;
+	size_t cursor = 0; //vertices below the cursor have no live triangles left
+
+	//when the fan runs out of nearby vertices, continue from a recently used vertex or else the next unused one
+	const auto skip_dead_end = [&]() -> int64_t
+	{
+		while (!dead_end_stack.empty())
+		{
+			const auto vertex = dead_end_stack.back();
+			dead_end_stack.pop_back();
+			if (live_triangles[vertex] > 0)
+			{
+				return vertex;
+			}
+		}
+		for (; cursor < vertex_count; cursor++)
+		{
+			if (live_triangles[cursor] > 0)
+			{
+				return static_cast<int64_t>(cursor);
+			}
+		}
+		return -1;
+	};
+
+	auto fanning_vertex = skip_dead_end();
+	while (fanning_vertex >= 0)
+	{
+		//emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		const auto fan = static_cast<uint32_t>(fanning_vertex);
+		for (auto i = adjacency_offsets[fan]; i < adjacency_offsets[fan + 1]; i++)
+		{
+			const auto triangle = adjacency[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			for (auto corner = 0; corner < 3; corner++)
+			{
+				const auto vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				dead_end_stack.push_back(vertex);
+				candidates.push_back(vertex);
+				live_triangles[vertex]--;
+				if (time - cache_time[vertex] > cache_size)
+				{
+					cache_time[vertex] = time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		//fan around the candidate that is still in the cache and will stay there while its triangles are emitted,
+		//preferring the one that entered the cache first
+		int64_t next = -1;
+		int64_t best_priority = -1;
+		for (const auto vertex : candidates)
+		{
+			if (live_triangles[vertex] == 0)
+			{
+				continue;
+			}
+			int64_t priority = 0;
+			if (time - cache_time[vertex] + 2 * live_triangles[vertex] <= cache_size)
+			{
+				priority = static_cast<int64_t>(time - cache_time[vertex]);
+			}
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				next = vertex;
+			}
+		}
+
+		//no candidate is left, so the next fan starts somewhere that may not be near the last one
+		if (next < 0)
+		{
+			next = skip_dead_end();
+			if (next >= 0 && output.size() < indices.size())
+			{
+				hard_boundaries.push_back(output.size() / 3);
+			}
+		}
+		fanning_vertex = next;
+	}
+
+	indices.swap(output);
+	return hard_boundaries;
+}
+
+void optimize_overdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+                       const std::vector<size_t>& hard_boundaries, const uint32_t cache_size, const float threshold)
+{
+	validate(indices, positions.size());
+	const auto triangle_count = indices.size() / 3;
+	if (triangle_count == 0)
+	{
+		return;
+	}
+
+	//split each hard cluster where the cache misses so far are no worse than the threshold allows compared to the
+	//whole cluster, a new cluster starts with an empty cache so splitting anywhere else costs more misses
+	std::vector<size_t> cluster_starts;
+	auto hard_end = hard_boundaries.begin();
+	size_t hard_start = 0;
+	while (hard_start < triangle_count)
+	{
+		const auto hard_stop = hard_end == hard_boundaries.end() ? triangle_count : *hard_end++;
+
+		fifo_cache cluster_cache(positions.size(), cache_size);
+		size_t cluster_misses = 0;
+		for (auto i = hard_start * 3; i < hard_stop * 3; i++)
+		{
+			cluster_misses += cluster_cache.miss(indices[i]) ? 1 : 0;
+		}
+		const auto cluster_acmr = static_cast<double>(cluster_misses) / (hard_stop - hard_start);
+
+		cluster_starts.push_back(hard_start);
+		fifo_cache cache(positions.size(), cache_size);
+		size_t misses = 0;
+		size_t start = hard_start;
+		for (auto triangle = hard_start; triangle < hard_stop; triangle++)
+		{
+			for (auto corner = 0; corner < 3; corner++)
+			{
+				misses += cache.miss(indices[triangle * 3 + corner]) ? 1 : 0;
+			}
+
+			//very small clusters are not worth sorting, they just scatter the triangles
+			const auto length = triangle + 1 - start;
+			if (length >= 32 && triangle + 1 < hard_stop && misses <= cluster_acmr * threshold * length)
+			{
+				start = triangle + 1;
+				cluster_starts.push_back(start);
+				cache = fifo_cache(positions.size(), cache_size);
+				misses = 0;
+			}
+		}
+		hard_start = hard_stop;
+	}
+
+	//the centre of the mesh, weighted by area
+	glm::dvec3 mesh_centre(0.0);
+	auto mesh_area = 0.0;
+	std::vector<glm::dvec3> centres(triangle_count);
+	std::vector<glm::dvec3> normals(triangle_count);
+	for (size_t triangle = 0; triangle < triangle_count; triangle++)
+	{
+		const glm::dvec3 a = positions[indices[triangle * 3]];
+		const glm::dvec3 b = positions[indices[triangle * 3 + 1]];
+		const glm::dvec3 c = positions[indices[triangle * 3 + 2]];
+		normals[triangle] = cross(b - a, c - a); //its length is twice the area
+		centres[triangle] = (a + b + c) / 3.0;
+		const auto area = length(normals[triangle]);
+		mesh_centre += centres[triangle] * area;
+		mesh_area += area;
+	}
+	mesh_centre /= std::max(mesh_area, 1e-12);
+
+	//a cluster that faces away from the centre of the mesh is likely to be in front of the rest of it
+	struct cluster
+	{
+		size_t start;
+		size_t end;
+		double occlusion;
+	};
+	std::vector<cluster> clusters;
+	for (size_t i = 0; i < cluster_starts.size(); i++)
+	{
+		cluster current = {cluster_starts[i], i + 1 < cluster_starts.size() ? cluster_starts[i + 1] : triangle_count, 0.0};
+
+		glm::dvec3 centre(0.0);
+		glm::dvec3 normal(0.0);
+		auto area = 0.0;
+		for (auto triangle = current.start; triangle < current.end; triangle++)
+		{
+			const auto triangle_area = length(normals[triangle]);
+			centre += centres[triangle] * triangle_area;
+			normal += normals[triangle];
+			area += triangle_area;
+		}
+		if (area > 0.0 && length(normal) > 0.0)
+		{
+			current.occlusion = dot(centre / area - mesh_centre, normalize(normal));
+		}
+		clusters.push_back(current);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const cluster& a, const cluster& b)
+	{
+		return a.occlusion > b.occlusion;
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (const auto& current : clusters)
+	{
+		output.insert(output.end(), indices.begin() + current.start * 3, indices.begin() + current.end * 3);
+	}
+	indices.swap(output);
+}
+
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t>& indices, const size_t vertex_count)
+{
+	validate(indices, vertex_count);
+
+	std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+	uint32_t next = 0;
+	for (auto& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+	return remap;
+}
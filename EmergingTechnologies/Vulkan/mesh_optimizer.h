@@ -0,0 +1,95 @@
+/**
+* \brief Reorder the triangles and vertices of indexed triangle lists for faster drawing
+*
+* The GPU keeps recently transformed vertices in a small post-transform cache. Triangles that
+* share vertices should be drawn close together so the vertices are transformed once. The
+* vertex cache pass uses Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for
+* Vertex Locality and Reduced Overdraw", 2007). The overdraw pass splits that order into
+* clusters and draws the clusters most likely to hide the others first, without undoing much
+* of the cache locality. Finally the vertex fetch pass renumbers the vertices in the order
+* they are first used, so vertex fetches walk through memory instead of jumping around it.
+* Run the passes in that order.
+*/
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/**
+* \brief How well an index order uses a FIFO post-transform cache
+*/
+struct vertex_cache_statistics
+{
+	double acmr = 0.0; //average cache miss ratio, vertices transformed per triangle. 0.5 is ideal, 3 is the worst
+	double atvr = 0.0; //average transform to vertex ratio, vertices transformed per vertex used. 1 is ideal
+};
+
+/**
+* \brief Simulate a FIFO post-transform cache drawing a triangle list
+* \param indices the triangle list
+* \param vertex_count the number of vertices the indices refer to
+* \param cache_size the number of vertices the cache holds
+* \return the statistics
+*/
+vertex_cache_statistics analyze_vertex_cache(const std::vector<uint32_t>& indices, size_t vertex_count,
+                                             uint32_t cache_size = 16);
+
+/**
+* \brief Reorder the triangles to reuse the vertices in the post-transform cache, using Tipsify
+* \param indices the triangle list, reordered in place
+* \param vertex_count the number of vertices the indices refer to
+* \param cache_size the number of vertices the cache holds
+* \return the index of the first triangle of each run that ends in a non-local jump, the hard cluster boundaries
+*/
+std::vector<size_t> optimize_vertex_cache(std::vector<uint32_t>& indices, size_t vertex_count,
+                                          uint32_t cache_size = 16);
+
+/**
+* \brief Reorder clusters of triangles so the ones on the outside of the mesh facing away from its centre are drawn
+* first, as they are the most likely to hide the triangles drawn after them. The hard clusters are split further
+* wherever the cache misses so far are close to the cluster's average, so the split costs few extra misses
+* \param indices the triangle list ordered by optimize_vertex_cache, reordered in place
+* \param positions the position of each vertex
+* \param hard_boundaries the boundaries returned by optimize_vertex_cache
+* \param cache_size the number of vertices the cache holds
+* \param threshold how much worse than the cluster's average the ACMR may be at a split, 1.05 allows 5%
+*/
+void optimize_overdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+                       const std::vector<size_t>& hard_boundaries, uint32_t cache_size = 16, float threshold = 1.05F);
+
+/**
+* \brief Renumber the vertices in the order the triangle list first uses them, unused vertices are dropped
+* \param indices the triangle list, rewritten to the new numbers
+* \param vertex_count the number of vertices the indices refer to
+* \return the new number of each old vertex, or UINT32_MAX for unused vertices. The new vertex count is the
+* number of entries that are not UINT32_MAX
+*/
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t>& indices, size_t vertex_count);
+
+/**
+* \brief Move vertex data to the numbers chosen by optimize_vertex_fetch
+* \param data the data of each vertex, reordered in place and shrunk to the used vertices
+* \param remap the table returned by optimize_vertex_fetch
+*/
+template <typename T>
+void remap_vertices(std::vector<T>& data, const std::vector<uint32_t>& remap)
+{
+	std::vector<T> remapped(data.size());
+	size_t used = 0;
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		if (remap[i] != UINT32_MAX)
+		{
+			remapped[remap[i]] = data[i];
+			used++;
+		}
+	}
+	remapped.resize(used);
+	data.swap(remapped);
+}
+
+#endif
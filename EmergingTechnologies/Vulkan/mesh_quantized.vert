@@ -0,0 +1,90 @@
+//Draws baked scenes with quantized vertices, compiled at startup by shader_compiler
+#version 450
+
+layout(binding = 0) uniform uniform_buffer_object
+{
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+	vec4 position_scale;
+	vec4 position_bias;
+} ubo;
+
+//the transform of each instance, which places the copy of the scene on the grid. A draw per instance is given its
+//transform in push constants, or in the uniform buffer at the draw's dynamic offset, instead
+#if defined(DRAW_DATA_PUSH_CONSTANTS)
+layout(push_constant) uniform draw_constants
+{
+	mat4 transform;
+} draw;
+#elif defined(DRAW_DATA_DYNAMIC_UNIFORM)
+layout(binding = 1) uniform draw_uniform
+{
+	mat4 transform;
+} draw;
+#else
+layout(std430, binding = 1) readonly buffer instance_buffer
+{
+	mat4 transforms[];
+} instances;
+
+//the instances to draw, written by the CPU or by the culling compute pass
+layout(std430, binding = 2) readonly buffer visible_buffer
+{
+	uint indices[];
+} visible;
+#endif
+
+//snorm16 position and octahedral normal, the GPU has already converted them to floats in [-1, 1]
+layout(location = 0) in vec4 in_position;
+layout(location = 1) in vec2 in_normal;
+
+layout(location = 0) out vec3 frag_color;
+
+//the same features and lights as mesh.vert
+layout(constant_id = 0) const bool lighting = true;
+layout(constant_id = 1) const int light_count = 1;
+layout(constant_id = 2) const bool show_normals = false;
+
+const vec3 light_directions[3] = vec3[](
+	normalize(vec3(0.4, 1.0, 0.6)), normalize(vec3(-0.8, 0.3, -0.2)), normalize(vec3(0.1, -0.4, -1.0)));
+const float light_intensities[3] = float[](0.85, 0.3, 0.15);
+
+vec3 decode_octahedral(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0);
+	normal.x += normal.x >= 0.0 ? -fold : fold;
+	normal.y += normal.y >= 0.0 ? -fold : fold;
+	return normalize(normal);
+}
+
+void main()
+{
+#if defined(DRAW_DATA_PUSH_CONSTANTS) || defined(DRAW_DATA_DYNAMIC_UNIFORM)
+	mat4 model = ubo.model * draw.transform;
+#else
+	mat4 model = ubo.model * instances.transforms[visible.indices[gl_InstanceIndex]];
+#endif
+	vec3 position = in_position.xyz * ubo.position_scale.xyz + ubo.position_bias.xyz;
+	gl_Position = ubo.proj * ubo.view * model * vec4(position, 1.0);
+
+	vec3 normal = normalize(mat3(model) * decode_octahedral(in_normal));
+	if (show_normals)
+	{
+		frag_color = normal * 0.5 + 0.5;
+	}
+	else if (lighting)
+	{
+		float light = 0.15;
+		for (int i = 0; i < light_count; i++)
+		{
+			light += light_intensities[i] * max(dot(normal, light_directions[i]), 0.0);
+		}
+		frag_color = vec3(light);
+	}
+	else
+	{
+		frag_color = vec3(1.0);
+	}
+}
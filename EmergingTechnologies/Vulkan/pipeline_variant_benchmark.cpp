@@ -0,0 +1,33 @@
+#include "pipeline_variant_benchmark.h"
+#include "benchmark_helpers.h"
+#include "vulkan_application.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+void run_pipeline_variant_benchmark(const std::string& scene_path, const uint32_t runs, std::ostream& stream)
+{
+	//the variants are created on the render thread once the application has started, after the one frame
+	auto settings = get_headless_settings(scene_path, 1);
+	settings.pipeline_threads = 0;
+	settings.variant_runs = std::max<uint32_t>(runs, 1);
+
+	std::ostringstream results;
+	results << std::fixed << std::setprecision(3);
+	run_headless(settings, results, "", [](const vulkan_application& app, std::ostream& rows)
+	{
+		const auto& report = app.get_variant_report();
+		rows << "first variant, the parent of the derivatives: " << report.base_ms << " ms" << std::endl;
+		for (const auto& variant : report.variants)
+		{
+			rows << "features 0x" << std::hex << variant.features << std::dec << ": first " << variant.full_first_ms <<
+				" ms, warm full " << variant.full_ms << " ms, warm derivative " << variant.derivative_ms << " ms, " <<
+				std::setprecision(2) << variant.full_ms / std::max(variant.derivative_ms, 0.001) << "x" <<
+				std::setprecision(3) << std::endl;
+		}
+	});
+
+	stream << "pipeline variants of " << (scene_path.empty() ? "the quad" : scene_path) << ", first creation and " <<
+		"median of " << settings.variant_runs << " creations of each without a pipeline cache. The driver's own " <<
+		"shader cache is left on, so the medians are warm-driver times" << std::endl << results.str();
+}
@@ -0,0 +1,28 @@
+/**
+* \brief Measure how long each variant of the graphics pipeline takes to create, on its own and as a
+* derivative
+*
+* The scene is drawn headless for one frame, then every variant its shaders can tell apart is
+* created several times in each way without a pipeline cache. The derivatives have the first
+* variant as their parent. Drivers that keep their own cache of compiled shaders skip the
+* compile once they have seen a variant, and nothing here turns that off. So the first full
+* creation of each variant is reported on its own, and the medians are warm-driver times. The
+* first variant has already been created as the parent, so even its first time can be warm.
+*/
+
+#ifndef PIPELINE_VARIANT_BENCHMARK_H
+#define PIPELINE_VARIANT_BENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+* \brief Run the benchmark and print the results
+* \param scene_path the glTF or baked scene whose pipeline variants are created, the quad if empty
+* \param runs the number of times each variant is created in each way
+* \param stream the stream to print to
+*/
+void run_pipeline_variant_benchmark(const std::string& scene_path, uint32_t runs, std::ostream& stream);
+
+#endif
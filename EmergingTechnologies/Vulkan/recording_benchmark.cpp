@@ -0,0 +1,145 @@
+#include "recording_benchmark.h"
+#include "benchmark_helpers.h"
+#include "scene_load_benchmark.h"
+#include "vulkan_application.h"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+/**
+* \brief Write the scene the benchmarks draw
+* \param scene_path the glTF scene to copy
+* \param copies the number of copies of the scene's meshes
+* \param scaled_path the .gltf file to write
+* \return the number of draws in the scene, one per primitive of each copy
+*/
+static size_t write_benchmark_scene(const std::string& scene_path, const uint32_t copies,
+                                    const std::string& scaled_path)
+{
+	gltf_model model;
+	model.load(scene_path);
+	write_scaled_gltf(model, copies, scaled_path);
+
+	size_t draw_count = 0;
+	for (const auto& mesh : model.get_meshes())
+	{
+		draw_count += mesh.primitives.size() * copies;
+	}
+	return draw_count;
+}
+
+/**
+* \brief Remove the scene the benchmarks draw
+* \param scaled_path the .gltf file
+*/
+static void remove_benchmark_scene(const std::string& scaled_path)
+{
+	std::remove(scaled_path.c_str());
+	std::remove((scaled_path + ".bin").c_str());
+}
+
+/**
+* \brief Obtain the settings that draw the scene headless and record its command buffers several times
+* \param scene_path the scene
+* \param recording_threads the number of threads and slices that record, 0 records on the main thread
+* \param runs the number of timed recordings
+* \return the settings
+*/
+static application_settings get_recording_settings(const std::string& scene_path, const uint32_t recording_threads,
+                                                   const uint32_t runs)
+{
+	auto settings = get_headless_settings(scene_path, 1);
+	settings.worker_threads = std::max<uint32_t>(recording_threads, 1);
+	settings.recording_threads = recording_threads;
+	settings.recording_runs = runs;
+	return settings;
+}
+
+void run_recording_benchmark(const std::string& scene_path, const uint32_t copies, const uint32_t max_threads,
+                             const uint32_t runs, std::ostream& stream)
+{
+	const auto scaled_path = "recording_benchmark_x" + std::to_string(copies) + ".gltf";
+	const auto draw_count = write_benchmark_scene(scene_path, copies, scaled_path);
+
+	const auto thread_counts = get_thread_sweep(max_threads);
+
+	std::ostringstream results;
+	results << std::fixed << std::setprecision(3);
+	auto ran = run_headless(get_recording_settings(scaled_path, 0, runs), results,
+	                        "main thread, no secondary command buffers",
+	                        [](const vulkan_application& app, std::ostream& row)
+	                        {
+		                        row << app.get_recording_ms() << " ms" << std::endl;
+	                        });
+
+	//more threads would fail in the same way, so the sweep stops at the first failure
+	double single_thread_ms = 0.0;
+	for (const auto count : thread_counts)
+	{
+		if (!ran)
+		{
+			break;
+		}
+		ran = run_headless(get_recording_settings(scaled_path, count, runs), results,
+		                   align_right(std::to_string(count), 3) + " threads",
+		                   [&](const vulkan_application& app, std::ostream& row)
+		                   {
+			                   const auto recording_ms = app.get_recording_ms();
+			                   if (count == 1)
+			                   {
+				                   single_thread_ms = recording_ms;
+			                   }
+			                   row << recording_ms << " ms, " << std::setprecision(2) <<
+				                   single_thread_ms / std::max(recording_ms, 0.001) << "x one thread" <<
+				                   std::setprecision(3) << std::endl;
+		                   });
+	}
+	remove_benchmark_scene(scaled_path);
+
+	stream << "recording " << draw_count << " draws per command buffer from " << scene_path << " x" << copies <<
+		", median of " << runs << " recordings of every command buffer" << std::endl << results.str();
+}
+
+void run_submission_benchmark(const std::string& scene_path, const uint32_t copies, const uint32_t frames,
+                              const uint32_t max_threads, std::ostream& stream)
+{
+	const auto scaled_path = "submission_benchmark_x" + std::to_string(copies) + ".gltf";
+	const auto draw_count = write_benchmark_scene(scene_path, copies, scaled_path);
+
+	//replay the prerecorded command buffers, then record every frame on the main thread and on the threads
+	struct submission_mode
+	{
+		std::string name;
+		bool dynamic_recording;
+		uint32_t recording_threads;
+	};
+	std::vector<submission_mode> modes = {{"static replay", false, 0}, {"dynamic, main thread", true, 0}};
+	if (max_threads > 1)
+	{
+		modes.push_back({"dynamic, " + std::to_string(max_threads) + " threads", true, max_threads});
+	}
+
+	std::ostringstream results;
+	results << std::fixed << std::setprecision(3);
+	for (const auto& mode : modes)
+	{
+		auto settings = get_headless_settings(scaled_path, frames);
+		settings.dynamic_recording = mode.dynamic_recording;
+		settings.worker_threads = std::max<uint32_t>(mode.recording_threads, 1);
+		settings.recording_threads = mode.recording_threads;
+
+		run_headless(settings, results, align_right(mode.name, 22), [](const vulkan_application& app, std::ostream& row)
+		{
+			const auto summary = app.get_frame_summary();
+			row << "cpu frame median " << summary.cpu_frame.p50 << " ms, p99 " << summary.cpu_frame.p99 <<
+				" ms, recording median " << summary.record.p50 << " ms, submit median " << summary.submit.p50 <<
+				" ms, gpu render pass " << app.get_render_pass_summary().avg_ms << " ms" << std::endl;
+		});
+	}
+	remove_benchmark_scene(scaled_path);
+
+	stream << "submitting " << draw_count << " draws per frame from " << scene_path << " x" << copies << ", " << frames
+		<< " headless frames per mode" << std::endl << results.str();
+}
@@ -0,0 +1,43 @@
+/**
+* \brief Measure the cost of recording command buffers, and of recording them every frame
+*
+* A glTF scene with many copies of the meshes of a scene is written, so there are enough draws
+* to split between the threads. The recording benchmark draws it headless with each number of
+* threads from one up to the maximum, doubling each time. The command buffers are recorded
+* several times after startup and the median is reported, along with the time taken to record
+* the draws into the primary command buffers on the main thread, which is what the threads are
+* compared with. The submission benchmark draws a number of frames with the command buffers
+* recorded once and replayed, then recorded every frame on the main thread and on every thread,
+* and compares the frame times. The scene the benchmarks write is removed afterwards.
+*/
+
+#ifndef RECORDING_BENCHMARK_H
+#define RECORDING_BENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+* \brief Run the benchmark and print the results
+* \param scene_path the glTF scene to copy
+* \param copies the number of copies of the scene's meshes, each primitive of each copy is a draw
+* \param max_threads the largest number of recording threads
+* \param runs the number of timed recordings with each number of threads
+* \param stream the stream to print to
+*/
+void run_recording_benchmark(const std::string& scene_path, uint32_t copies, uint32_t max_threads, uint32_t runs,
+                             std::ostream& stream);
+
+/**
+* \brief Run the submission benchmark and print the results
+* \param scene_path the glTF scene to copy
+* \param copies the number of copies of the scene's meshes, each primitive of each copy is a draw
+* \param frames the number of headless frames to draw in each mode
+* \param max_threads the number of recording threads to compare the main thread with
+* \param stream the stream to print to
+*/
+void run_submission_benchmark(const std::string& scene_path, uint32_t copies, uint32_t frames, uint32_t max_threads,
+                              std::ostream& stream);
+
+#endif
@@ -0,0 +1,220 @@
+#include "scene_load_benchmark.h"
+#include "baked_mesh.h"
+#include "frame_statistics.h"
+#include "gltf_model.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+void write_scaled_gltf(const gltf_model& model, const uint32_t copies, const std::string& path)
+{
+	const auto bin_path = path + ".bin";
+	const auto separator = bin_path.find_last_of("/\\");
+	const auto bin_uri = separator == std::string::npos ? bin_path : bin_path.substr(separator + 1);
+
+	const auto extent = model.get_bounds_max() - model.get_bounds_min();
+	const auto spacing = std::max(std::max(extent.x, extent.y), extent.z) * 1.5F;
+	const auto grid_size = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(copies))));
+
+	std::vector<char> bin;
+	std::ostringstream views, accessors, meshes;
+	uint32_t accessor_count = 0;
+
+	//add the elements of an accessor to the buffer packed, with a view and an accessor that point at them
+	const auto add_accessor = [&](const gltf_accessor& accessor, const char* type, const glm::vec3* offset)
+	{
+		const auto element_size = accessor.get_element_size();
+		const auto byte_offset = bin.size();
+		bin.resize(byte_offset + static_cast<size_t>(accessor.count) * element_size);
+		for (uint32_t i = 0; i < accessor.count; i++)
+		{
+			const auto destination = bin.data() + byte_offset + static_cast<size_t>(i) * element_size;
+			memcpy(destination, accessor.data + static_cast<size_t>(i) * accessor.stride, element_size);
+			if (offset != nullptr)
+			{
+				glm::vec3 position;
+				memcpy(&position, destination, sizeof(position));
+				position += *offset;
+				memcpy(destination, &position, sizeof(position));
+			}
+		}
+		//keep the next accessor aligned to its component size
+		bin.resize((bin.size() + 3) & ~static_cast<size_t>(3));
+
+		views << (accessor_count == 0 ? "" : ",") << "{\"buffer\":0,\"byteOffset\":" << byte_offset <<
+			",\"byteLength\":" << static_cast<size_t>(accessor.count) * element_size << "}";
+		accessors << (accessor_count == 0 ? "" : ",") << "{\"bufferView\":" << accessor_count <<
+			",\"componentType\":" << accessor.component_type << ",\"count\":" << accessor.count << ",\"type\":\"" <<
+			type << "\"}";
+		return accessor_count++;
+	};
+
+	uint32_t mesh_count = 0;
+	for (uint32_t copy = 0; copy < copies; copy++)
+	{
+		const auto offset = glm::vec3(static_cast<float>(copy % grid_size), 0.0F, static_cast<float>(copy / grid_size)) *
+			spacing;
+		for (const auto& mesh : model.get_meshes())
+		{
+			meshes << (mesh_count++ == 0 ? "" : ",") << "{\"primitives\":[";
+			for (size_t i = 0; i < mesh.primitives.size(); i++)
+			{
+				const auto& primitive = mesh.primitives[i];
+				const auto position = add_accessor(primitive.position, "VEC3", &offset);
+				const auto normal = add_accessor(primitive.normal, "VEC3", nullptr);
+				const auto indices = add_accessor(primitive.indices, "SCALAR", nullptr);
+				meshes << (i == 0 ? "" : ",") << "{\"attributes\":{\"POSITION\":" << position << ",\"NORMAL\":" <<
+					normal << "},\"indices\":" << indices << "}";
+			}
+			meshes << "]}";
+		}
+	}
+
+	std::ofstream bin_file(bin_path, std::ios::binary | std::ios::trunc);
+	std::ofstream gltf_file(path, std::ios::trunc);
+	if (!bin_file.write(bin.data(), bin.size()) || !gltf_file.is_open())
+	{
+		throw std::runtime_error("failed to write " + path + "!");
+	}
+	gltf_file << "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"uri\":\"" << bin_uri << "\",\"byteLength\":" <<
+		bin.size() << "}],\"bufferViews\":[" << views.str() << "],\"accessors\":[" << accessors.str() <<
+		"],\"meshes\":[" << meshes.str() << "]}";
+}
+
+/**
+* \brief Load a glTF scene and copy each accessor range into the staging memory, as the renderer does
+* \param path the scene
+* \param staging the staging memory
+* \return the number of bytes copied
+*/
+static size_t load_gltf(const std::string& path, std::vector<char>& staging)
+{
+	gltf_model model;
+	model.load(path);
+
+	size_t size = 0;
+	const auto copy = [&](const gltf_accessor& accessor)
+	{
+		const auto length = accessor.get_byte_length();
+		if (size + length > staging.size())
+		{
+			staging.resize(size + length);
+		}
+		memcpy(staging.data() + size, accessor.data, length);
+		size += length;
+	};
+	for (const auto& mesh : model.get_meshes())
+	{
+		for (const auto& primitive : mesh.primitives)
+		{
+			copy(primitive.position);
+			copy(primitive.normal);
+			copy(primitive.indices);
+		}
+	}
+	return size;
+}
+
+/**
+* \brief Map a baked scene and copy its vertex and index data into the staging memory, as the renderer does
+* \param path the baked file
+* \param staging the staging memory
+* \return the number of bytes copied
+*/
+static size_t load_baked(const std::string& path, std::vector<char>& staging)
+{
+	baked_mesh mesh;
+	mesh.open(path);
+
+	const auto& header = mesh.get_header();
+	const auto size = static_cast<size_t>(header.vertex_data_size + header.index_data_size);
+	if (size > staging.size())
+	{
+		staging.resize(size);
+	}
+	memcpy(staging.data(), mesh.get_vertex_data(), static_cast<size_t>(header.vertex_data_size));
+	memcpy(staging.data() + header.vertex_data_size, mesh.get_index_data(), static_cast<size_t>(header.index_data_size));
+	return size;
+}
+
+/**
+* \brief Time loading a file several times
+* \param load the function that loads the file
+* \param path the file
+* \param runs the number of timed loads
+* \param staging the staging memory
+* \return the median time in milliseconds
+*/
+static double time_loads(size_t (*load)(const std::string&, std::vector<char>&), const std::string& path,
+                         const uint32_t runs, std::vector<char>& staging)
+{
+	//the first load pages the file in and sizes the staging memory, so it is not timed
+	load(path, staging);
+
+	std::vector<double> timings;
+	for (uint32_t i = 0; i < std::max<uint32_t>(runs, 1); i++)
+	{
+		const auto start_time = std::chrono::high_resolution_clock::now();
+		load(path, staging);
+		timings.push_back(frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now()));
+	}
+
+	std::sort(timings.begin(), timings.end());
+	return timings[timings.size() / 2];
+}
+
+/**
+* \brief Bake a glTF scene, then time loading both files
+* \param name the name to print
+* \param gltf_path the scene
+* \param runs the number of timed loads of each file
+* \param stream the stream to print to
+*/
+static void compare_formats(const std::string& name, const std::string& gltf_path, const uint32_t runs,
+                            std::ostream& stream)
+{
+	const auto baked_path = gltf_path + ".meshbin";
+	{
+		gltf_model model;
+		model.load(gltf_path);
+		//the optimizer does not change how long loading takes, so it is skipped to keep the benchmark short
+		baked_mesh::bake(model, baked_path, false);
+	}
+
+	std::vector<char> staging;
+	const auto gltf_ms = time_loads(load_gltf, gltf_path, runs, staging);
+	const auto baked_ms = time_loads(load_baked, baked_path, runs, staging);
+	const auto bytes = load_baked(baked_path, staging);
+	std::remove(baked_path.c_str());
+
+	stream << std::fixed << std::setprecision(3) << name << ": " << bytes / 1024 << " KiB of vertex and index data, glTF "
+		<< gltf_ms << " ms, baked " << baked_ms << " ms, " << std::setprecision(1) << gltf_ms / std::max(baked_ms, 0.001)
+		<< "x faster" << std::endl;
+}
+
+void run_scene_load_benchmark(const std::string& scene_path, const uint32_t scaled_copies, const uint32_t runs,
+                              std::ostream& stream)
+{
+	stream << "median of " << runs << " loads with a warm file cache" << std::endl;
+	compare_formats(scene_path, scene_path, runs, stream);
+
+	if (scaled_copies > 1)
+	{
+		const auto scaled_path = "scene_load_benchmark_x" + std::to_string(scaled_copies) + ".gltf";
+		{
+			gltf_model model;
+			model.load(scene_path);
+			write_scaled_gltf(model, scaled_copies, scaled_path);
+		}
+		compare_formats(scene_path + " x" + std::to_string(scaled_copies), scaled_path, runs, stream);
+		std::remove(scaled_path.c_str());
+		std::remove((scaled_path + ".bin").c_str());
+	}
+}
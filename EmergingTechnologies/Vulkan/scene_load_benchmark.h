@@ -0,0 +1,39 @@
+/**
+* \brief Compare how long a scene takes to load from glTF and from a baked file
+*
+* Each run loads the scene and copies its vertex and index data into a buffer the size of
+* the staging memory, which is what the renderer does before anything reaches the GPU. The
+* scene is also scaled up by writing a glTF file with many copies of its meshes, to show how
+* the two formats grow with the size of the scene. Every file is read once before timing,
+* so the results are for a warm file cache. The files the benchmark writes are removed
+* afterwards.
+*/
+
+#ifndef SCENE_LOAD_BENCHMARK_H
+#define SCENE_LOAD_BENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+class gltf_model;
+
+/**
+* \brief Write a glTF 2.0 scene that holds many copies of the meshes of another scene, laid out on a grid
+* \param model the scene to copy
+* \param copies the number of copies
+* \param path the .gltf file to write, the buffer is written next to it with .bin appended
+*/
+void write_scaled_gltf(const gltf_model& model, uint32_t copies, const std::string& path);
+
+/**
+* \brief Run the benchmark and print the results
+* \param scene_path the glTF scene to load
+* \param scaled_copies the number of copies of the scene's meshes in the scaled scene
+* \param runs the number of timed loads of each file
+* \param stream the stream to print to
+*/
+void run_scene_load_benchmark(const std::string& scene_path, uint32_t scaled_copies, uint32_t runs,
+                              std::ostream& stream);
+
+#endif
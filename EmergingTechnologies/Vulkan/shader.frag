@@ -0,0 +1,12 @@
+//Colours the quad with its interpolated vertex colours, compiled at startup by shader_compiler
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	outColor = vec4(fragColor, 1.0);
+}
@@ -0,0 +1,258 @@
+#include "shader_compiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+//changed whenever the compiler or the way it is driven changes, so results from before are not used
+static const uint32_t shader_cache_version = 1;
+
+//the first word of every SPIR-V module
+static const uint32_t spirv_magic = 0x07230203;
+
+/**
+* \brief Add bytes to an FNV-1a hash
+* \param hash the hash so far, updated
+* \param data the bytes
+* \param size the number of bytes
+*/
+static void hash_bytes(uint64_t& hash, const void* data, const size_t size)
+{
+	const auto bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+}
+
+/**
+* \brief Add a string to an FNV-1a hash, with its length so neighbouring strings cannot run together
+* \param hash the hash so far, updated
+* \param text the string
+*/
+static void hash_string(uint64_t& hash, const std::string& text)
+{
+	const uint64_t size = text.size();
+	hash_bytes(hash, &size, sizeof(size));
+	hash_bytes(hash, text.data(), text.size());
+}
+
+/**
+* \brief Read the source text of a shader
+* \param path the source file
+* \return the text
+*/
+static std::string read_source(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open shader source " + path + "!");
+	}
+	std::ostringstream source;
+	source << file.rdbuf();
+	return source.str();
+}
+
+void shader_compiler::init(const std::string& cache_directory)
+{
+	compiler_.reset(new shaderc::Compiler());
+	if (!compiler_->IsValid())
+	{
+		throw std::runtime_error("failed to create shader compiler!");
+	}
+
+	//an existing directory is fine, any other failure shows up as a failure to write the first entry
+	cache_directory_ = cache_directory;
+	if (!cache_directory_.empty())
+	{
+#ifdef _WIN32
+		CreateDirectoryA(cache_directory_.c_str(), nullptr);
+#else
+		mkdir(cache_directory_.c_str(), 0755);
+#endif
+	}
+}
+
+void shader_compiler::destroy()
+{
+	compiler_.reset();
+	std::lock_guard<std::mutex> lock(mutex_);
+	results_.clear();
+}
+
+std::vector<uint32_t> shader_compiler::compile(const shader_request& request)
+{
+	//the source is read every time, it is cheap and an edited shader gets a new hash
+	const auto source = read_source(request.path);
+	const auto hash = hash_request(request, source);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto found = results_.find(hash);
+		if (found != results_.end())
+		{
+			return found->second;
+		}
+	}
+
+	//two threads asking for the same new shader both compile it, which is rare and gives the same result
+	std::vector<uint32_t> spirv;
+	if (read_cache(hash, spirv))
+	{
+		disk_hit_count_++;
+	}
+	else
+	{
+		spirv = compile_source(request, source);
+		compile_count_++;
+		write_cache(hash, spirv);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	results_[hash] = spirv;
+	return spirv;
+}
+
+std::vector<std::vector<uint32_t>> shader_compiler::compile_all(const std::vector<shader_request>& requests,
+                                                                job_system& jobs)
+{
+	std::vector<std::vector<uint32_t>> results(requests.size());
+	jobs.parallel_for(0, requests.size(), 1, [&](const size_t first, const size_t last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			results[i] = compile(requests[i]);
+		}
+	});
+	return results;
+}
+
+uint64_t shader_compiler::hash_request(const shader_request& request, const std::string& source)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash_bytes(hash, &shader_cache_version, sizeof(shader_cache_version));
+
+	const uint32_t options[] = {
+		static_cast<uint32_t>(request.stage), static_cast<uint32_t>(request.language), request.optimize ? 1U : 0U
+	};
+	hash_bytes(hash, options, sizeof(options));
+	hash_string(hash, request.entry_point);
+
+	//the same definitions in another order compile the same way, so they are sorted first
+	auto defines = request.defines;
+	std::sort(defines.begin(), defines.end());
+	for (const auto& define : defines)
+	{
+		hash_string(hash, define.first);
+		hash_string(hash, define.second);
+	}
+
+	//the path is left out, the same source compiled from anywhere gives the same SPIR-V
+	hash_string(hash, source);
+	return hash;
+}
+
+std::vector<uint32_t> shader_compiler::compile_source(const shader_request& request, const std::string& source) const
+{
+	shaderc::CompileOptions options;
+	options.SetSourceLanguage(request.language == shader_language_hlsl
+		                          ? shaderc_source_language_hlsl
+		                          : shaderc_source_language_glsl);
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, 0);
+	options.SetOptimizationLevel(request.optimize ? shaderc_optimization_level_size : shaderc_optimization_level_zero);
+	for (const auto& define : request.defines)
+	{
+		options.AddMacroDefinition(define.first, define.second);
+	}
+
+	const shaderc_shader_kind kinds[] = {
+		shaderc_glsl_vertex_shader, shaderc_glsl_fragment_shader, shaderc_glsl_compute_shader
+	};
+	const auto result = compiler_->CompileGlslToSpv(source, kinds[request.stage], request.path.c_str(),
+	                                                request.entry_point.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		throw std::runtime_error("failed to compile " + request.path + "!\n" + result.GetErrorMessage());
+	}
+	return std::vector<uint32_t>(result.cbegin(), result.cend());
+}
+
+std::string shader_compiler::get_cache_path(const uint64_t hash) const
+{
+	std::ostringstream path;
+	path << cache_directory_ << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".spv";
+	return path.str();
+}
+
+bool shader_compiler::read_cache(const uint64_t hash, std::vector<uint32_t>& spirv) const
+{
+	if (cache_directory_.empty())
+	{
+		return false;
+	}
+
+	std::ifstream file(get_cache_path(hash), std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	//a file that is not whole words of SPIR-V is ignored, and replaced once the shader is compiled again
+	const auto size = static_cast<size_t>(file.tellg());
+	if (size < sizeof(uint32_t) || size % sizeof(uint32_t) != 0)
+	{
+		return false;
+	}
+	std::vector<uint32_t> words(size / sizeof(uint32_t));
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(words.data()), size) || words[0] != spirv_magic)
+	{
+		return false;
+	}
+	spirv = std::move(words);
+	return true;
+}
+
+void shader_compiler::write_cache(const uint64_t hash, const std::vector<uint32_t>& spirv) const
+{
+	if (cache_directory_.empty())
+	{
+		return;
+	}
+
+	//write next to the entry first, named after the thread so two threads writing the same entry do not collide
+	const auto path = get_cache_path(hash);
+	const auto temp_path = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+		".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open() || !file.write(reinterpret_cast<const char*>(spirv.data()),
+		                                   spirv.size() * sizeof(uint32_t)) || !file.flush())
+		{
+			file.close();
+			std::remove(temp_path.c_str());
+			return;
+		}
+	}
+
+	//then move it into place in one step, std::rename does not replace existing files on windows
+#ifdef _WIN32
+	const auto replaced = MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	const auto replaced = std::rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+	if (!replaced)
+	{
+		std::remove(temp_path.c_str());
+	}
+}
@@ -0,0 +1,165 @@
+/**
+* \class shader_compiler
+*
+* \brief Compile GLSL and HLSL shaders to SPIR-V at runtime with shaderc, caching the results on disk
+*
+* Each compilation is identified by a hash of everything that affects its output: the source
+* text, the language, stage and entry point, the macro definitions and the optimization
+* setting. The SPIR-V is kept in memory and written to a cache directory under the hash, so a
+* shader that has not changed is read back rather than compiled again, and a warm start does
+* no compilation at all. Editing a shader or changing a definition changes the hash, so stale
+* entries are never used, they are simply left behind. Cache files are written to a temporary
+* file and renamed into place, so a crash never leaves a truncated entry. Sources must be
+* self-contained, #include is not supported because the included files would not be hashed.
+* Compiling is safe from several threads at once, and a batch of shaders can be compiled on
+* the threads of a job system.
+*/
+
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include "job_system.h"
+
+#include <shaderc/shaderc.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+* \brief The language a shader is written in
+*/
+enum shader_language
+{
+	shader_language_glsl,
+	shader_language_hlsl
+};
+
+/**
+* \brief The pipeline stage a shader is compiled for
+*/
+enum shader_stage
+{
+	shader_stage_vertex,
+	shader_stage_fragment,
+	shader_stage_compute
+};
+
+/**
+* \brief A shader to compile and the options to compile it with
+*/
+struct shader_request
+{
+	std::string path; //the source file
+	shader_stage stage = shader_stage_vertex;
+	shader_language language = shader_language_glsl;
+	std::string entry_point = "main";
+	std::vector<std::pair<std::string, std::string>> defines; //macro names and values, the order does not matter
+	bool optimize = true; //run the SPIR-V optimizer for size
+};
+
+class shader_compiler
+{
+public:
+	/**
+	* \brief Create the compiler
+	* \param cache_directory the directory compiled shaders are cached in, created if it does not exist. The results
+	* are kept in memory only if empty
+	*/
+	void init(const std::string& cache_directory);
+
+	/**
+	* \brief Destroy the compiler and forget the results kept in memory, the cache directory is left as it is
+	*/
+	void destroy();
+
+	/**
+	* \brief Obtain the SPIR-V of a shader, compiling it only if it is not cached. Safe to call from several threads
+	* \param request the shader
+	* \return the SPIR-V words, an error with the compiler's messages is thrown if the shader does not compile
+	*/
+	std::vector<uint32_t> compile(const shader_request& request);
+
+	/**
+	* \brief Obtain the SPIR-V of several shaders, each compiled as a task on the job system
+	* \param requests the shaders
+	* \param jobs the job system, called from one of its threads
+	* \return the SPIR-V words of each shader in order
+	*/
+	std::vector<std::vector<uint32_t>> compile_all(const std::vector<shader_request>& requests, job_system& jobs);
+
+	/**
+	* \brief Obtain the number of shaders compiled since the compiler was created
+	* \return the number of compilations
+	*/
+	uint32_t get_compile_count() const
+	{
+		return compile_count_.load();
+	}
+
+	/**
+	* \brief Obtain the number of shaders read from the cache directory instead of being compiled
+	* \return the number of files read
+	*/
+	uint32_t get_disk_hit_count() const
+	{
+		return disk_hit_count_.load();
+	}
+
+	/**
+	* \brief Calculate the key a shader is cached under
+	* \param request the shader
+	* \param source the source text of the shader
+	* \return a 64 bit FNV-1a hash of the source and every option
+	*/
+	static uint64_t hash_request(const shader_request& request, const std::string& source);
+
+private:
+	std::unique_ptr<shaderc::Compiler> compiler_;
+	std::string cache_directory_;
+
+	//the results compiled or read so far, by hash, so a pipeline recreated on resize does not touch the disk
+	std::mutex mutex_;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> results_;
+
+	std::atomic<uint32_t> compile_count_{0};
+	std::atomic<uint32_t> disk_hit_count_{0};
+
+	/**
+	* \brief Compile a shader with shaderc
+	* \param request the shader
+	* \param source the source text of the shader
+	* \return the SPIR-V words
+	*/
+	std::vector<uint32_t> compile_source(const shader_request& request, const std::string& source) const;
+
+	/**
+	* \brief Obtain the file a shader is cached in
+	* \param hash the key of the shader
+	* \return the path of the file
+	*/
+	std::string get_cache_path(uint64_t hash) const;
+
+	/**
+	* \brief Read a shader from the cache directory
+	* \param hash the key of the shader
+	* \param spirv the SPIR-V words, replaced if the file is found
+	* \return false if there is no valid file for the shader
+	*/
+	bool read_cache(uint64_t hash, std::vector<uint32_t>& spirv) const;
+
+	/**
+	* \brief Write a shader to the cache directory, replacing any file there atomically. A failure to write is not an
+	* error, the shader is just compiled again next time
+	* \param hash the key of the shader
+	* \param spirv the SPIR-V words
+	*/
+	void write_cache(uint64_t hash, const std::vector<uint32_t>& spirv) const;
+};
+
+#endif
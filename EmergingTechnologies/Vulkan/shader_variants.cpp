@@ -0,0 +1,34 @@
+#include "shader_variants.h"
+
+void shader_specialization::init(const specialization_constant* constants, const size_t count, const uint32_t features)
+{
+	entries_.clear();
+	values_.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		//every value is 4 bytes, the size of a VkBool32, an int and a float
+		VkSpecializationMapEntry entry = {};
+		entry.constantID = constants[i].constant_id;
+		entry.offset = static_cast<uint32_t>(values_.size() * sizeof(uint32_t));
+		entry.size = sizeof(uint32_t);
+		entries_.push_back(entry);
+		values_.push_back((features & constants[i].feature) != 0
+			                  ? constants[i].enabled_value
+			                  : constants[i].disabled_value);
+	}
+}
+
+const VkSpecializationInfo* shader_specialization::get_info()
+{
+	if (entries_.empty())
+	{
+		return nullptr;
+	}
+
+	//the pointers are set here rather than in init, so they always point into the current vectors
+	info_.mapEntryCount = static_cast<uint32_t>(entries_.size());
+	info_.pMapEntries = entries_.data();
+	info_.dataSize = values_.size() * sizeof(uint32_t);
+	info_.pData = values_.data();
+	return &info_;
+}
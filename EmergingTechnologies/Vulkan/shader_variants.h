@@ -0,0 +1,129 @@
+/**
+* \class shader_specialization
+*
+* \brief Select shader features with specialization constants, so one SPIR-V module gives every variant
+*
+* Each shader that has features declares them as specialization constants, and a constexpr
+* table here connects each constant_id to the feature that sets it and the values it takes
+* with and without the feature. A variant is a mask of features. Creating a pipeline with the
+* mask fills a VkSpecializationInfo from the table, and the driver folds the constants into
+* the code it generates, removing the branches that are not taken and unrolling loops whose
+* count is a constant. The shaders are compiled and cached once, however many variants are
+* drawn with. The tables are checked when the application is compiled, a constant_id used
+* twice in the same shader is an error.
+*/
+
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+* \brief The features a shader variant can be created with, combined into a mask
+*/
+enum shader_feature : uint32_t
+{
+	shader_feature_lighting = 1 << 0, //shade with the key light, otherwise the geometry is drawn unlit
+	shader_feature_fill_lights = 1 << 1, //add the two fill lights to the key light
+	shader_feature_normals = 1 << 2 //draw the normals as colours instead of shading, for debugging
+};
+
+//the features drawn with by default, the look the scenes had before there were variants
+static const uint32_t default_shader_features = shader_feature_lighting;
+
+/**
+* \brief Connects a specialization constant of a shader to the feature that sets it
+*/
+struct specialization_constant
+{
+	uint32_t constant_id; //the constant_id of the constant in the shader
+	uint32_t feature; //the shader_feature that sets it
+	uint32_t enabled_value; //the value with the feature, bools are 1 or 0
+	uint32_t disabled_value; //the value without the feature
+};
+
+//the constants of mesh.vert and mesh_quantized.vert, which must declare them with the same ids
+constexpr specialization_constant mesh_vertex_constants[] = {
+	{0, shader_feature_lighting, 1, 0}, //bool lighting
+	{1, shader_feature_fill_lights, 3, 1}, //int light_count
+	{2, shader_feature_normals, 1, 0} //bool show_normals
+};
+
+/**
+* \brief Obtain every feature a table of constants depends on
+* \param constants the table
+* \return the mask of features, variants that only differ in other features are the same
+*/
+template <size_t N>
+constexpr uint32_t get_feature_mask(const specialization_constant (&constants)[N])
+{
+	uint32_t mask = 0;
+	for (size_t i = 0; i < N; i++)
+	{
+		mask |= constants[i].feature;
+	}
+	return mask;
+}
+
+/**
+* \brief Check that no constant_id appears twice in a table
+* \param constants the table
+* \return true if every constant_id is different
+*/
+template <size_t N>
+constexpr bool has_unique_constant_ids(const specialization_constant (&constants)[N])
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		for (size_t j = i + 1; j < N; j++)
+		{
+			if (constants[i].constant_id == constants[j].constant_id)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static_assert(has_unique_constant_ids(mesh_vertex_constants), "mesh_vertex_constants uses a constant_id twice");
+
+class shader_specialization
+{
+public:
+	/**
+	* \brief Fill the constants of a variant
+	* \param constants the table of the shader
+	* \param features the mask of shader_feature the variant is created with
+	*/
+	template <size_t N>
+	void init(const specialization_constant (&constants)[N], const uint32_t features)
+	{
+		init(constants, N, features);
+	}
+
+	/**
+	* \brief Fill the constants of a variant
+	* \param constants the table of the shader
+	* \param count the number of constants in the table
+	* \param features the mask of shader_feature the variant is created with
+	*/
+	void init(const specialization_constant* constants, size_t count, uint32_t features);
+
+	/**
+	* \brief Obtain the specialization info for a shader stage, valid until this is destroyed or filled again
+	* \return the info, or null if there are no constants so the shader's defaults are used
+	*/
+	const VkSpecializationInfo* get_info();
+
+private:
+	std::vector<VkSpecializationMapEntry> entries_;
+	std::vector<uint32_t> values_;
+	VkSpecializationInfo info_ = {};
+};
+
+#endif
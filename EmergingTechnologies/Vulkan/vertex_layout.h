@@ -0,0 +1,257 @@
+/**
+* \class vertex_layout
+*
+* \brief Describe an interleaved vertex from a list of attribute types
+*
+* Each attribute type names the storage it takes in the vertex, the VkFormat the GPU reads it
+* with and how to encode a value into it. The layout places the attributes one after another
+* in the order they are listed, at consecutive shader locations, and generates the binding
+* and attribute descriptions for the pipeline at compile time. The quantized attributes store
+* positions as snorm16 relative to a per-mesh scale and bias, normals octahedral encoded in
+* two snorm16s, colours as unorm8 and texture coordinates as half floats. The GPU converts
+* them back to floats as they are fetched, so shaders only need to decode the normals.
+*/
+
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+/**
+* \brief Two 32 bit floats
+*/
+struct vertex_attribute_float2
+{
+	typedef glm::vec2 storage;
+	static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT;
+
+	static storage encode(const glm::vec2& value)
+	{
+		return value;
+	}
+};
+
+/**
+* \brief Three 32 bit floats
+*/
+struct vertex_attribute_float3
+{
+	typedef glm::vec3 storage;
+	static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+
+	static storage encode(const glm::vec3& value)
+	{
+		return value;
+	}
+};
+
+/**
+* \brief A position as snorm16s, (position - bias) / scale. The shader decodes it with position * scale + bias, using
+* the scale and bias from the uniform buffer. A fourth component pads the position to 8 bytes, three component
+* 16 bit formats are rarely supported for vertex input
+*/
+struct vertex_attribute_snorm16_position
+{
+	typedef std::array<int16_t, 4> storage;
+	static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_SNORM;
+
+	/**
+	* \brief Encode a position
+	* \param value the position
+	* \param scale half the size of the box around the mesh
+	* \param bias the centre of the box around the mesh
+	* \return the encoded position
+	*/
+	static storage encode(const glm::vec3& value, const glm::vec3& scale, const glm::vec3& bias)
+	{
+		const auto normalized = (value - bias) / glm::max(scale, glm::vec3(1e-20F));
+		storage encoded = {};
+		for (glm::length_t i = 0; i < 3; i++)
+		{
+			encoded[i] = static_cast<int16_t>(glm::packSnorm1x16(normalized[i]));
+		}
+		encoded[3] = INT16_MAX; //w = 1
+		return encoded;
+	}
+};
+
+/**
+* \brief A unit vector mapped onto an octahedron and unfolded into a square, stored as two snorm16s. The error is
+* below 0.05 degrees, 4 bytes instead of 12
+*/
+struct vertex_attribute_oct_normal
+{
+	typedef std::array<int16_t, 2> storage;
+	static constexpr VkFormat format = VK_FORMAT_R16G16_SNORM;
+
+	/**
+	* \brief Encode a normal
+	* \param value the normal, it does not need to be normalized
+	* \return the encoded normal
+	*/
+	static storage encode(const glm::vec3& value)
+	{
+		const auto length = std::abs(value.x) + std::abs(value.y) + std::abs(value.z);
+		auto octahedron = length > 0.0F ? glm::vec2(value.x, value.y) / length : glm::vec2(0.0F);
+
+		//the lower half of the octahedron is folded over the corners of the square
+		if (value.z < 0.0F)
+		{
+			const auto sign = glm::vec2(octahedron.x >= 0.0F ? 1.0F : -1.0F, octahedron.y >= 0.0F ? 1.0F : -1.0F);
+			octahedron = (glm::vec2(1.0F) - glm::abs(glm::vec2(octahedron.y, octahedron.x))) * sign;
+		}
+
+		storage encoded = {};
+		encoded[0] = static_cast<int16_t>(glm::packSnorm1x16(octahedron.x));
+		encoded[1] = static_cast<int16_t>(glm::packSnorm1x16(octahedron.y));
+		return encoded;
+	}
+};
+
+/**
+* \brief A colour as four unorm8s
+*/
+struct vertex_attribute_unorm8_color
+{
+	typedef std::array<uint8_t, 4> storage;
+	static constexpr VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	static storage encode(const glm::vec4& value)
+	{
+		storage encoded = {};
+		for (glm::length_t i = 0; i < 4; i++)
+		{
+			encoded[i] = glm::packUnorm1x8(value[i]);
+		}
+		return encoded;
+	}
+};
+
+/**
+* \brief A texture coordinate as two half floats
+*/
+struct vertex_attribute_half_uv
+{
+	typedef std::array<uint16_t, 2> storage;
+	static constexpr VkFormat format = VK_FORMAT_R16G16_SFLOAT;
+
+	static storage encode(const glm::vec2& value)
+	{
+		storage encoded = {};
+		encoded[0] = glm::packHalf1x16(value.x);
+		encoded[1] = glm::packHalf1x16(value.y);
+		return encoded;
+	}
+};
+
+template <typename... Attributes>
+class vertex_layout
+{
+public:
+	/**
+	* \brief The type of an attribute
+	*/
+	template <uint32_t Index>
+	using attribute = typename std::tuple_element<Index, std::tuple<Attributes...>>::type;
+
+	/**
+	* \brief Obtain the offset of an attribute from the start of the vertex
+	* \param index the index of the attribute
+	* \return the offset in bytes
+	*/
+	static constexpr uint32_t get_offset(const uint32_t index)
+	{
+		//the trailing 0 keeps the array valid for an empty list
+		const uint32_t sizes[] = {static_cast<uint32_t>(sizeof(typename Attributes::storage))..., 0};
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < index; i++)
+		{
+			offset += sizes[i];
+		}
+		return offset;
+	}
+
+	/**
+	* \brief Obtain the size of a vertex
+	* \return the size in bytes
+	*/
+	static constexpr uint32_t get_stride()
+	{
+		return get_offset(sizeof...(Attributes));
+	}
+
+	/**
+	* \brief Describe the vertex buffer binding
+	* \param binding the binding number
+	* \param input_rate advance per vertex or per instance
+	* \return the binding description
+	*/
+	static constexpr VkVertexInputBindingDescription get_binding_description(
+		const uint32_t binding = 0, const VkVertexInputRate input_rate = VK_VERTEX_INPUT_RATE_VERTEX)
+	{
+		return {binding, get_stride(), input_rate};
+	}
+
+	/**
+	* \brief Describe every attribute, at consecutive locations
+	* \param binding the binding number
+	* \param first_location the location of the first attribute
+	* \return the attribute descriptions
+	*/
+	static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> get_attribute_descriptions(
+		const uint32_t binding = 0, const uint32_t first_location = 0)
+	{
+		static_assert(is_aligned(), "vertex attributes must be multiples of 4 bytes");
+		return get_attribute_descriptions(binding, first_location, std::index_sequence_for<Attributes...>());
+	}
+
+	/**
+	* \brief Store an encoded attribute in a vertex
+	* \param vertex the first byte of the vertex
+	* \param value the encoded attribute
+	*/
+	template <uint32_t Index>
+	static void write(char* vertex, const typename attribute<Index>::storage& value)
+	{
+		memcpy(vertex + get_offset(Index), &value, sizeof(value));
+	}
+
+private:
+	/**
+	* \brief Check that every attribute is a multiple of 4 bytes, so every attribute starts on 4 bytes. Some GPUs
+	* fetch attributes in 4 byte units
+	* \return true if the attributes are aligned
+	*/
+	static constexpr bool is_aligned()
+	{
+		const uint32_t sizes[] = {static_cast<uint32_t>(sizeof(typename Attributes::storage))..., 0};
+		for (uint32_t i = 0; i < sizeof...(Attributes); i++)
+		{
+			if (sizes[i] % 4 != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template <size_t... Indices>
+	static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> get_attribute_descriptions(
+		const uint32_t binding, const uint32_t first_location, std::index_sequence<Indices...>)
+	{
+		return {{{first_location + static_cast<uint32_t>(Indices), binding, Attributes::format,
+			get_offset(static_cast<uint32_t>(Indices))}...}};
+	}
+};
+
+#endif
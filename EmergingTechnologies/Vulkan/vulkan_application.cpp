@@ -1,19 +1,117 @@
 #include "vulkan_application.h"
 #include <iostream>
-#include <fstream>
 #include <cstring>
+#include <cstddef>
 #include <cstdlib>
 #include <set>
-#include <SDL_Vulkan.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <functional>
+#include <SDL_vulkan.h>
+
+/**
+* \brief The type of each binding of the descriptor set: the uniform buffer, then the instance transforms, the visible
+* instances, the instance bounds and the draw commands. Every buffer but the bounds has a slot per command buffer, the
+* offset of the slot to read is given when the set is bound
+*/
+static const VkDescriptorType descriptor_types[] = {
+	VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+	VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC
+};
+
+vulkan_application::vulkan_application(const application_settings& settings) : settings_(settings)
+{
+	//the features are changed from the keyboard as the application runs
+	shader_features_ = settings_.shader_features;
+
+	//at least one frame has to be in flight for anything to be drawn
+	if (settings_.max_frames_in_flight == 0)
+	{
+		settings_.max_frames_in_flight = 1;
+	}
+
+	//without a window there is nothing to close, so a headless run always stops after a fixed number of frames
+	if (settings_.headless && settings_.frame_count == 0)
+	{
+		settings_.frame_count = 1000;
+	}
+
+	//the quad's shaders do not read the instance transforms, so only scenes can be instanced
+	if (settings_.instance_count == 0)
+	{
+		settings_.instance_count = 1;
+	}
+	if (settings_.instance_count > 1 && settings_.scene_path.empty())
+	{
+		throw std::runtime_error("instancing needs a scene to draw!");
+	}
+
+	//the instances are culled in one place or the other
+	if (settings_.gpu_culling && settings_.scene_path.empty())
+	{
+		throw std::runtime_error("culling on the GPU needs a scene to draw!");
+	}
+	if (settings_.gpu_culling)
+	{
+		settings_.cpu_culling = false;
+	}
+
+	//only the CPU knows how many instances are visible, and a draw per instance is recorded for each of them
+	if (settings_.draw_data != draw_data_instanced)
+	{
+		if (settings_.gpu_culling)
+		{
+			throw std::runtime_error("a draw per instance needs the instances to be culled on the CPU!");
+		}
+		settings_.dynamic_recording = true;
+	}
+}
 
 void vulkan_application::run()
 {
-	init_window();
+	if (!settings_.headless)
+	{
+		init_window();
+	}
 	init_vulkan();
+	if (settings_.recording_runs > 0)
+	{
+		benchmark_recording();
+	}
+	if (settings_.variant_runs > 0)
+	{
+		benchmark_pipeline_variants();
+	}
 	main_loop();
 	cleanup();
 }
 
+frame_summary vulkan_application::get_frame_summary() const
+{
+	return frame_statistics_.summarise();
+}
+
+gpu_timing_summary vulkan_application::get_render_pass_summary() const
+{
+	return gpu_timer_.get_pass_summary(0);
+}
+
+double vulkan_application::get_recording_ms() const
+{
+	return recording_ms_;
+}
+
+const pipeline_variant_report& vulkan_application::get_variant_report() const
+{
+	return variant_report_;
+}
+
+size_t vulkan_application::get_primitive_count() const
+{
+	return mesh_draws_.size();
+}
+
 void vulkan_application::init_window()
 {
 	SDL_Init(SDL_INIT_VIDEO); //Initialize SDL video component
@@ -25,34 +123,80 @@ void vulkan_application::init_window()
 
 void vulkan_application::init_vulkan()
 {
+	const auto start_time = std::chrono::high_resolution_clock::now();
+
+	//the main thread becomes the first thread of the job system
+	jobs_.init(settings_.worker_threads);
 	create_instance();
-	create_surface();
+	if (!settings_.headless)
+	{
+		create_surface();
+	}
 	pick_physical_device();
 	create_logical_device();
-	create_swap_chain();
+	create_memory_allocator();
+	create_pipeline_cache();
+	create_shader_compiler();
+	if (!settings_.scene_path.empty())
+	{
+		load_scene();
+	}
+	if (settings_.headless)
+	{
+		create_offscreen_images();
+	}
+	else
+	{
+		create_swap_chain();
+	}
 	create_image_views();
 	create_render_pass();
 	create_descriptor_set_layout();
 	create_graphics_pipeline();
+	create_culling_pipeline();
 	create_framebuffers();
 	create_command_pool();
-	create_vertex_buffer();
-	create_index_buffer();
+	create_gpu_timer();
+	create_staging_ring();
+	if (settings_.scene_path.empty())
+	{
+		create_vertex_buffer();
+		create_index_buffer();
+	}
+	else
+	{
+		create_scene_buffers();
+	}
+	//send all the uploads to the GPU in one submission and make sure the graphics queue owns the data
+	//before anything is drawn with it
+	staging_ring_.wait_ready(staging_ring_.flush());
 	create_uniform_buffer();
+	create_instance_buffer();
 	create_descriptor_pool();
 	create_descriptor_set();
 	create_command_buffers();
-	create_semaphores();
+	create_sync_objects();
+
+	//the startup time, compare runs with and without a pipeline cache file and shader cache to see the time saved. A
+	//warm start compiles no shaders
+	std::cout << "startup took " << frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now())
+		<< " ms with a " << (pipeline_cache_.is_warm() ? "warm" : "cold") << " pipeline cache, " <<
+		shader_compiler_.get_compile_count() << " shaders compiled and " << shader_compiler_.get_disk_hit_count() <<
+		" read from the shader cache" << std::endl;
 }
 
 void vulkan_application::main_loop()
 {
+	frame_statistics_.init("vulkan");
+	auto frame_start = std::chrono::high_resolution_clock::now();
+	uint32_t frames_rendered = 0;
+
 	auto running = true;
 	while (running)
 	{
 		SDL_Event event;
-		//while there are events in the sdl queue
-		while (SDL_PollEvent(&event))
+		//while there are events in the sdl queue, there is no event queue when headless
+		while (!settings_.headless && SDL_PollEvent(&event))
 		{
 			if (event.type == SDL_QUIT)
 			{
@@ -65,14 +209,66 @@ void vulkan_application::main_loop()
 				//the new window height and width
 				recreate_swap_chain();
 			}
+			else if (event.type == SDL_KEYDOWN)
+			{
+				//toggle the shader features, a variant is created the first time it is drawn with
+				if (event.key.keysym.sym == SDLK_l)
+				{
+					shader_features_ ^= shader_feature_lighting;
+				}
+				else if (event.key.keysym.sym == SDLK_f)
+				{
+					shader_features_ ^= shader_feature_fill_lights;
+				}
+				else if (event.key.keysym.sym == SDLK_n)
+				{
+					shader_features_ ^= shader_feature_normals;
+				}
+			}
 		}
-		//resend the uniform buffer data to the GPU with the new data
-		update_uniform_buffer();
-		//draw a frame
+		//draw a frame, this also sends the new uniform data to the GPU
 		draw_frame();
+
+		//the frame time runs from the start of one frame to the start of the next, so it includes the events
+		const auto frame_end = std::chrono::high_resolution_clock::now();
+		frame_timings_.cpu_frame_ms = frame_statistics::elapsed_ms(frame_start, frame_end);
+		frame_statistics_.record(frame_timings_);
+		frame_timings_ = frame_record();
+		frame_start = frame_end;
+
+		//stop once the requested number of frames have been drawn
+		frames_rendered++;
+		if (settings_.frame_count != 0 && frames_rendered >= settings_.frame_count)
+		{
+			running = false;
+		}
 	}
 	//wait for the device to be idle before rendering a new frame
 	vkDeviceWaitIdle(logical_device_);
+
+	//read the timings of the frames that have finished since they were last submitted
+	for (uint32_t i = 0; i < swap_chain_images_.size(); i++)
+	{
+		gpu_timer_.collect(i);
+	}
+	gpu_timer_.print_summary(std::cout);
+
+	//report how much the culling saved and what it cost
+	if (culling_frames_ > 0)
+	{
+		const auto instance_count = static_cast<double>(culling_frames_) * instance_culler_.size();
+		std::cout << "cpu culling: " << culling_visible_total_ / culling_frames_ << " of " << instance_culler_.size() <<
+			" instances visible on average, " << culling_total_ms_ * 1000000.0 / instance_count << " ns per instance with "
+			<< frustum_culler::get_lane_count() << " lanes" << std::endl;
+	}
+
+	//report the frame times, and export them for comparison with other runs
+	frame_statistics_.print_summary(std::cout);
+	if (!settings_.statistics_path.empty())
+	{
+		frame_statistics_.write_csv(settings_.statistics_path + ".csv");
+		frame_statistics_.write_json(settings_.statistics_path + ".json");
+	}
 }
 
 void vulkan_application::cleanup_swap_chain()
@@ -83,62 +279,124 @@ void vulkan_application::cleanup_swap_chain()
 		vkDestroyFramebuffer(logical_device_, framebuffer, nullptr);
 	}
 
-	//remove all the command buffers
-	vkFreeCommandBuffers(logical_device_, command_pool_, static_cast<uint32_t>(command_buffers_.size()),
-	                     command_buffers_.data());
-
-	//destroy the graphics pipeline
-	vkDestroyPipeline(logical_device_, graphics_pipeline_, nullptr);
-	vkDestroyPipelineLayout(logical_device_, pipeline_layout_, nullptr);
-	vkDestroyRenderPass(logical_device_, render_pass_, nullptr);
+	//remove all the command buffers, there are none when they are recorded every frame
+	if (!command_buffers_.empty())
+	{
+		vkFreeCommandBuffers(logical_device_, command_pool_, static_cast<uint32_t>(command_buffers_.size()),
+		                     command_buffers_.data());
+	}
 
 	//destroy all image views
 	for (auto image_view : swap_chain_image_views_)
 	{
 		vkDestroyImageView(logical_device_, image_view, nullptr);
 	}
+}
 
-	//destroy the swapchain
-	vkDestroySwapchainKHR(logical_device_, swap_chain_, nullptr);
+void vulkan_application::cleanup_pipeline()
+{
+	//destroy the graphics pipelines and the culling pipeline that shares their layout
+	if (culling_pipeline_ != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(logical_device_, culling_pipeline_, nullptr);
+		culling_pipeline_ = VK_NULL_HANDLE;
+	}
+	pipeline_manager_.clear();
+	graphics_variants_.clear();
+	graphics_pipeline_ = VK_NULL_HANDLE;
+	vkDestroyPipeline(logical_device_, fallback_pipeline_, nullptr);
+	fallback_pipeline_ = VK_NULL_HANDLE;
+	vkDestroyPipelineLayout(logical_device_, pipeline_layout_, nullptr);
+	vkDestroyRenderPass(logical_device_, render_pass_, nullptr);
 }
 
 void vulkan_application::cleanup()
 {
 	cleanup_swap_chain();
+	cleanup_pipeline();
+
+	//destroy the swapchain, or the offscreen images when headless. The offscreen images are sub-allocated,
+	//so they have to be freed before the allocator is destroyed
+	if (settings_.headless)
+	{
+		for (size_t i = 0; i < swap_chain_images_.size(); i++)
+		{
+			vkDestroyImage(logical_device_, swap_chain_images_[i], nullptr);
+			memory_allocator_.free(offscreen_image_allocations_[i]);
+		}
+		swap_chain_images_.clear();
+		offscreen_image_allocations_.clear();
+	}
+	else
+	{
+		destroy_retired_swap_chains(true);
+		vkDestroySwapchainKHR(logical_device_, swap_chain_, nullptr);
+	}
 
 	//destroy the descriptor sets
 	vkDestroyDescriptorPool(logical_device_, descriptor_pool_, nullptr);
 	vkDestroyDescriptorSetLayout(logical_device_, descriptor_set_layout_, nullptr);
 
-	//destroy the uniform buffer and free its memory on the gpu
-	vkDestroyBuffer(logical_device_, uniform_buffer_, nullptr);
-	vkFreeMemory(logical_device_, uniform_buffer_memory_, nullptr);
-
-	//destroy the index buffer and free its memory on the gpu
-	vkDestroyBuffer(logical_device_, index_buffer_, nullptr);
-	vkFreeMemory(logical_device_, index_buffer_memory_, nullptr);
-
-	//destroy the vertex buffer and free its memory on the gpu
-	vkDestroyBuffer(logical_device_, vertex_buffer_, nullptr);
-	vkFreeMemory(logical_device_, vertex_buffer_memory_, nullptr);
-
-	//destroy the synchronisation semaphores
-	vkDestroySemaphore(logical_device_, render_finished_semaphore_, nullptr);
-	vkDestroySemaphore(logical_device_, image_available_semaphore_, nullptr);
+	//wait for any uploads and destroy the staging ring
+	staging_ring_.destroy();
+
+	//destroy the instance bounds, indirect, visible, instance, uniform, index and vertex buffers and free their memory
+	//on the gpu
+	destroy_buffer(bounds_buffer_, bounds_buffer_allocation_);
+	destroy_buffer(indirect_buffer_, indirect_buffer_allocation_);
+	destroy_buffer(visible_buffer_, visible_buffer_allocation_);
+	destroy_buffer(instance_buffer_, instance_buffer_allocation_);
+	destroy_buffer(uniform_buffer_, uniform_buffer_allocation_);
+	destroy_buffer(index_buffer_, index_buffer_allocation_);
+	destroy_buffer(vertex_buffer_, vertex_buffer_allocation_);
+
+	//report how well the memory was packed, then give the memory blocks back to the driver
+	memory_allocator_.print_stats(std::cout);
+	memory_allocator_.destroy();
+
+	//destroy the synchronisation objects of every frame in flight
+	for (size_t i = 0; i < settings_.max_frames_in_flight; i++)
+	{
+		vkDestroySemaphore(logical_device_, render_finished_semaphores_[i], nullptr);
+		vkDestroySemaphore(logical_device_, image_available_semaphores_[i], nullptr);
+		vkDestroyFence(logical_device_, in_flight_fences_[i], nullptr);
+	}
 
-	//destroy the command pool
+	//destroy the command pools and the timestamp queries
 	vkDestroyCommandPool(logical_device_, command_pool_, nullptr);
+	for (auto frame_command_pool : frame_command_pools_)
+	{
+		vkDestroyCommandPool(logical_device_, frame_command_pool, nullptr);
+	}
+	if (settings_.recording_threads > 0)
+	{
+		recorder_.destroy();
+	}
+	jobs_.destroy();
+	gpu_timer_.destroy();
+	shader_compiler_.destroy();
+
+	//keep the compiled pipelines for the next run, including the ones created in the background
+	pipeline_manager_.destroy();
+	pipeline_cache_.save();
+	pipeline_cache_.destroy();
 
 	//destroy the device
 	vkDestroyDevice(logical_device_, nullptr);
 
 	//destroy the surface and vulkan instance
-	vkDestroySurfaceKHR(vulkan_instance_, vulkan_surface_, nullptr);
+	if (!settings_.headless)
+	{
+		vkDestroySurfaceKHR(vulkan_instance_, vulkan_surface_, nullptr);
+	}
 	vkDestroyInstance(vulkan_instance_, nullptr);
 
 	//exit sdl
-	SDL_DestroyWindow(sdl_window_);
-	SDL_Quit();
+	if (!settings_.headless)
+	{
+		SDL_DestroyWindow(sdl_window_);
+		SDL_Quit();
+	}
 }
 
 void vulkan_application::recreate_swap_chain()
@@ -150,17 +408,46 @@ void vulkan_application::recreate_swap_chain()
 	height_ = h;
 	if (width_ == 0 || height_ == 0) return;
 
-	//wait for the gpu to be idle
-	vkDeviceWaitIdle(logical_device_);
+	//wait for the frames in flight to finish with the framebuffers and command buffers. Uploads and the
+	//presentation engine are left running, the old swapchain is handed to the new one and destroyed a few frames
+	//later, once its presents are done
+	vkWaitForFences(logical_device_, static_cast<uint32_t>(in_flight_fences_.size()), in_flight_fences_.data(), VK_TRUE,
+	                std::numeric_limits<uint64_t>::max());
 
 	cleanup_swap_chain();
 
+	const auto old_format = swap_chain_image_format_;
 	create_swap_chain();
 	create_image_views();
-	create_render_pass();
-	create_graphics_pipeline();
+
+	//the viewport and scissor are dynamic, so the render pass and pipeline only depend on the image format
+	if (swap_chain_image_format_ != old_format)
+	{
+		cleanup_pipeline();
+		create_render_pass();
+		create_graphics_pipeline();
+		create_culling_pipeline();
+	}
+
 	create_framebuffers();
+
+	//the new swapchain may have more images than there are uniform and instance slots, no frame is in flight so the
+	//buffers can be replaced
+	if (swap_chain_images_.size() > uniform_slot_count_)
+	{
+		destroy_buffer(indirect_buffer_, indirect_buffer_allocation_);
+		destroy_buffer(visible_buffer_, visible_buffer_allocation_);
+		destroy_buffer(instance_buffer_, instance_buffer_allocation_);
+		destroy_buffer(uniform_buffer_, uniform_buffer_allocation_);
+		create_uniform_buffer();
+		create_instance_buffer();
+		write_descriptor_set();
+	}
+
 	create_command_buffers();
+
+	//the number of swapchain images may have changed, and none of the new images are in use yet
+	images_in_flight_.assign(swap_chain_images_.size(), VK_NULL_HANDLE);
 }
 
 void vulkan_application::create_instance()
@@ -186,9 +473,14 @@ void vulkan_application::create_instance()
 	vk_instance_create_info.ppEnabledExtensionNames = extensions.data();
 	//ptr to the memory location of the extensions vector
 
-	vk_instance_create_info.enabledLayerCount = static_cast<uint32_t>(validation_layers.size());
-	vk_instance_create_info.ppEnabledLayerNames = validation_layers.data();
-	//ptr to the memory location of the validation layers vector
+	//only enable the validation layers when they are installed, build machines usually only have the driver
+	validation_layers_enabled_ = check_validation_layer_support();
+	if (validation_layers_enabled_)
+	{
+		vk_instance_create_info.enabledLayerCount = static_cast<uint32_t>(validation_layers.size());
+		vk_instance_create_info.ppEnabledLayerNames = validation_layers.data();
+		//ptr to the memory location of the validation layers vector
+	}
 
 	//Create the instance
 	if (vkCreateInstance(&vk_instance_create_info, nullptr, &vulkan_instance_) != VK_SUCCESS)
@@ -245,6 +537,10 @@ void vulkan_application::create_logical_device()
 	//use by a gpu.
 	std::vector<VkDeviceQueueCreateInfo> vk_device_queue_create_infos;
 	std::set<int> unique_queue_families = {indices.graphics_family, indices.present_family};
+	if (indices.transfer_family >= 0)
+	{
+		unique_queue_families.insert(indices.transfer_family);
+	}
 
 	//Since multiple sets of queues can be used, it is required to set a priority for each of these
 	//however since only 1 set of queues will be used, the priority is set to 1
@@ -275,13 +571,19 @@ void vulkan_application::create_logical_device()
 	//pass the enabled features
 	vk_device_create_info.pEnabledFeatures = &vk_physical_device_features;
 
-	//pass the enabled device extensions
-	vk_device_create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
-	vk_device_create_info.ppEnabledExtensionNames = device_extensions.data();
+	//pass the enabled device extensions, nothing is presented when headless so the swapchain is not needed
+	if (!settings_.headless)
+	{
+		vk_device_create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+		vk_device_create_info.ppEnabledExtensionNames = device_extensions.data();
+	}
 
 	//pass the enabled validation layers
-	vk_device_create_info.enabledLayerCount = static_cast<uint32_t>(validation_layers.size());
-	vk_device_create_info.ppEnabledLayerNames = validation_layers.data();
+	if (validation_layers_enabled_)
+	{
+		vk_device_create_info.enabledLayerCount = static_cast<uint32_t>(validation_layers.size());
+		vk_device_create_info.ppEnabledLayerNames = validation_layers.data();
+	}
 
 	//create the device
 	if (vkCreateDevice(physical_device_, &vk_device_create_info, nullptr, &logical_device_) != VK_SUCCESS)
@@ -292,6 +594,113 @@ void vulkan_application::create_logical_device()
 	//obtain the queue's from the device for the specified id's
 	vkGetDeviceQueue(logical_device_, indices.graphics_family, 0, &graphics_queue_);
 	vkGetDeviceQueue(logical_device_, indices.present_family, 0, &present_queue_);
+	if (indices.transfer_family >= 0)
+	{
+		vkGetDeviceQueue(logical_device_, indices.transfer_family, 0, &transfer_queue_);
+	}
+}
+
+void vulkan_application::create_memory_allocator()
+{
+	memory_allocator_.init(physical_device_, logical_device_);
+}
+
+void vulkan_application::create_pipeline_cache()
+{
+	pipeline_cache_.init(physical_device_, logical_device_, settings_.pipeline_cache_path);
+	pipeline_manager_.init(logical_device_, pipeline_cache_.get(), settings_.pipeline_threads);
+}
+
+void vulkan_application::create_shader_compiler()
+{
+	shader_compiler_.init(settings_.shader_cache_path);
+}
+
+void vulkan_application::load_scene()
+{
+	const auto start_time = std::chrono::high_resolution_clock::now();
+
+	//a baked file already has the layout of the vertex and index buffers, so its draws are read from its table
+	if (baked_mesh::is_baked_file(settings_.scene_path))
+	{
+		baked_scene_.open(settings_.scene_path);
+		const auto& header = baked_scene_.get_header();
+		if (header.draw_count == 0)
+		{
+			throw std::runtime_error("scene " + settings_.scene_path + " has no meshes to draw!");
+		}
+
+		mesh_draws_.clear();
+		for (uint32_t i = 0; i < header.draw_count; i++)
+		{
+			const auto& baked_draw = baked_scene_.get_draws()[i];
+			mesh_draw draw = {};
+			draw.position_offset = baked_draw.position_offset;
+			draw.normal_offset = baked_draw.normal_offset;
+			draw.index_offset = baked_draw.index_offset;
+			draw.index_type = baked_draw.index_size == 4 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+			draw.index_count = baked_draw.index_count;
+			mesh_draws_.push_back(draw);
+		}
+
+		//baked streams are packed float3s, or interleaved quantized vertices that are relative to the bounds
+		scene_position_stride_ = scene_normal_stride_ = sizeof(glm::vec3);
+		scene_quantized_ = header.vertex_format == baked_vertex_format_quantized;
+		const auto bounds_min = glm::vec3(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]);
+		const auto bounds_max = glm::vec3(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]);
+		if (scene_quantized_)
+		{
+			scene_position_scale_ = (bounds_max - bounds_min) * 0.5F;
+			scene_position_bias_ = (bounds_max + bounds_min) * 0.5F;
+		}
+		scene_center_ = (bounds_min + bounds_max) * 0.5F;
+		scene_radius_ = std::max(glm::length(bounds_max - scene_center_), 0.001F);
+
+		std::cout << "baked scene loaded in " <<
+			frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now()) << " ms" << std::endl;
+		return;
+	}
+
+	scene_.load(settings_.scene_path);
+
+	//every primitive is drawn with the same pipeline, so they must all have float3 positions and normals with
+	//the same strides, and indices vulkan can read directly
+	for (const auto& mesh : scene_.get_meshes())
+	{
+		for (const auto& primitive : mesh.primitives)
+		{
+			if (primitive.position.component_type != gltf_float || primitive.position.component_count != 3 ||
+				primitive.normal.component_type != gltf_float || primitive.normal.component_count != 3)
+			{
+				throw std::runtime_error("scene primitives must have float3 positions and normals!");
+			}
+			if (primitive.indices.component_type != gltf_unsigned_short &&
+				primitive.indices.component_type != gltf_unsigned_int)
+			{
+				throw std::runtime_error("scene primitives must have 16 or 32 bit indices!");
+			}
+			if (scene_position_stride_ == 0)
+			{
+				scene_position_stride_ = primitive.position.stride;
+				scene_normal_stride_ = primitive.normal.stride;
+			}
+			if (primitive.position.stride != scene_position_stride_ || primitive.normal.stride != scene_normal_stride_)
+			{
+				throw std::runtime_error("scene primitives must all use the same vertex strides!");
+			}
+		}
+	}
+	if (scene_position_stride_ == 0)
+	{
+		throw std::runtime_error("scene " + settings_.scene_path + " has no meshes to draw!");
+	}
+
+	//the camera is placed so the whole scene is in view
+	scene_center_ = (scene_.get_bounds_min() + scene_.get_bounds_max()) * 0.5F;
+	scene_radius_ = std::max(glm::length(scene_.get_bounds_max() - scene_center_), 0.001F);
+
+	std::cout << "scene loaded in " << frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now())
+		<< " ms" << std::endl;
 }
 
 void vulkan_application::create_swap_chain()
@@ -345,12 +754,23 @@ void vulkan_application::create_swap_chain()
 	vk_swapchain_create_info_khr.presentMode = vk_present_mode_khr;
 	vk_swapchain_create_info_khr.clipped = VK_TRUE;
 
+	//when resizing, pass the current swapchain so the driver can reuse its resources and finish presenting its images
+	const auto old_swap_chain = swap_chain_;
+	vk_swapchain_create_info_khr.oldSwapchain = old_swap_chain;
+
 	//create the swapchain
 	if (vkCreateSwapchainKHR(logical_device_, &vk_swapchain_create_info_khr, nullptr, &swap_chain_) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create swap chain!");
 	}
 
+	//the old swapchain is retired by the new one, but the presents queued on it may still be pending, and present is
+	//not covered by the frame fences. It is kept until every frame slot has been waited on for a frame drawn since
+	if (old_swap_chain != VK_NULL_HANDLE)
+	{
+		retired_swap_chains_.emplace_back(old_swap_chain, settings_.max_frames_in_flight * 2);
+	}
+
 	//obtain the images from the swapchain, intialize the image vector and fill it with the images
 	vkGetSwapchainImagesKHR(logical_device_, swap_chain_, &image_count, nullptr);
 	swap_chain_images_.resize(image_count);
@@ -361,6 +781,74 @@ void vulkan_application::create_swap_chain()
 	swap_chain_extent_ = vk_extent2_d;
 }
 
+void vulkan_application::destroy_retired_swap_chains(const bool destroy_all)
+{
+	//the presents on a retired swapchain have almost always finished by the time it is destroyed, the wait on the
+	//present queue makes certain of it as vkDestroySwapchainKHR requires
+	auto waited = destroy_all;
+	for (auto it = retired_swap_chains_.begin(); it != retired_swap_chains_.end();)
+	{
+		if (destroy_all || --it->second == 0)
+		{
+			if (!waited)
+			{
+				vkQueueWaitIdle(present_queue_);
+				waited = true;
+			}
+			vkDestroySwapchainKHR(logical_device_, it->first, nullptr);
+			it = retired_swap_chains_.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void vulkan_application::create_offscreen_images()
+{
+	//the window size is used as the size of the images, and the format is the one preferred for the swapchain
+	swap_chain_image_format_ = VK_FORMAT_B8G8R8A8_UNORM;
+	swap_chain_extent_ = {static_cast<uint32_t>(width_), static_cast<uint32_t>(height_)};
+
+	//one image per frame in flight, so a frame never has to wait for an image that is still being rendered to
+	swap_chain_images_.resize(settings_.max_frames_in_flight);
+	offscreen_image_allocations_.resize(settings_.max_frames_in_flight);
+	next_offscreen_image_ = 0;
+
+	for (size_t i = 0; i < swap_chain_images_.size(); i++)
+	{
+		VkImageCreateInfo vk_image_create_info = {};
+		vk_image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		vk_image_create_info.imageType = VK_IMAGE_TYPE_2D;
+		vk_image_create_info.format = swap_chain_image_format_;
+		vk_image_create_info.extent = {swap_chain_extent_.width, swap_chain_extent_.height, 1};
+		vk_image_create_info.mipLevels = 1;
+		vk_image_create_info.arrayLayers = 1;
+		vk_image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		vk_image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		//rendered to, and can be copied out to check the output
+		vk_image_create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		vk_image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		vk_image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(logical_device_, &vk_image_create_info, nullptr, &swap_chain_images_[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create offscreen image!");
+		}
+
+		//images are optimally tiled, so they are kept apart from buffers on devices that need it
+		VkMemoryRequirements vk_memory_requirements;
+		vkGetImageMemoryRequirements(logical_device_, swap_chain_images_[i], &vk_memory_requirements);
+		const auto memory_type = find_memory_type(vk_memory_requirements.memoryTypeBits,
+		                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		offscreen_image_allocations_[i] = memory_allocator_.allocate(vk_memory_requirements, memory_type,
+		                                                             allocation_kind::optimal);
+		vkBindImageMemory(logical_device_, swap_chain_images_[i], offscreen_image_allocations_[i].memory,
+		                  offscreen_image_allocations_[i].offset);
+	}
+}
+
 void vulkan_application::create_image_views()
 {
 	//initalize the image views vector with the number of images
@@ -404,7 +892,10 @@ void vulkan_application::create_render_pass()
 	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	//the image is presented, or when headless left ready to be copied out
+	color_attachment.finalLayout = settings_.headless
+		                               ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+		                               : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	//Define the reference to the color attachment
 	VkAttachmentReference color_attachment_ref = {};
@@ -445,17 +936,26 @@ void vulkan_application::create_render_pass()
 
 void vulkan_application::create_descriptor_set_layout()
 {
-	VkDescriptorSetLayoutBinding vk_descriptor_set_layout_binding = {};
-	vk_descriptor_set_layout_binding.binding = 0;
-	vk_descriptor_set_layout_binding.descriptorCount = 1;
-	vk_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; //this is a uniform buffer
-	vk_descriptor_set_layout_binding.pImmutableSamplers = nullptr;
-	vk_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; //used in the vertex shader
+	//the buffers are used in the vertex shader and the culling compute shader, the storage buffers can be much larger
+	//than a uniform buffer
+	const VkShaderStageFlags stages[] = {
+		VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT,
+		VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT, VK_SHADER_STAGE_COMPUTE_BIT, VK_SHADER_STAGE_COMPUTE_BIT
+	};
+	std::array<VkDescriptorSetLayoutBinding, 5> vk_descriptor_set_layout_bindings = {};
+	for (uint32_t i = 0; i < vk_descriptor_set_layout_bindings.size(); i++)
+	{
+		vk_descriptor_set_layout_bindings[i].binding = i;
+		vk_descriptor_set_layout_bindings[i].descriptorCount = 1;
+		vk_descriptor_set_layout_bindings[i].descriptorType = get_descriptor_types()[i];
+		vk_descriptor_set_layout_bindings[i].pImmutableSamplers = nullptr;
+		vk_descriptor_set_layout_bindings[i].stageFlags = stages[i];
+	}
 
 	VkDescriptorSetLayoutCreateInfo vk_descriptor_set_layout_create_info = {};
 	vk_descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	vk_descriptor_set_layout_create_info.bindingCount = 1;
-	vk_descriptor_set_layout_create_info.pBindings = &vk_descriptor_set_layout_binding;
+	vk_descriptor_set_layout_create_info.bindingCount = static_cast<uint32_t>(vk_descriptor_set_layout_bindings.size());
+	vk_descriptor_set_layout_create_info.pBindings = vk_descriptor_set_layout_bindings.data();
 
 	//create the descriptor set layout
 	if (vkCreateDescriptorSetLayout(logical_device_, &vk_descriptor_set_layout_create_info, nullptr,
@@ -467,9 +967,124 @@ void vulkan_application::create_descriptor_set_layout()
 
 void vulkan_application::create_graphics_pipeline()
 {
-	//read the SPIR-V vertex and fragment shaders
-	const auto vert_shader_code = read_file("shaders/vert.spv");
-	const auto frag_shader_code = read_file("shaders/frag.spv");
+	//the pipeline layout is created from the descriptor sets, and shared with the culling pipeline
+	VkPipelineLayoutCreateInfo vk_pipeline_layout_create_info = {};
+	vk_pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	vk_pipeline_layout_create_info.setLayoutCount = 1;
+	vk_pipeline_layout_create_info.pSetLayouts = &descriptor_set_layout_;
+
+	//a draw's transform is pushed to the vertex shader when the draws are given their transforms that way
+	VkPushConstantRange vk_push_constant_range = {};
+	vk_push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	vk_push_constant_range.offset = 0;
+	vk_push_constant_range.size = sizeof(glm::mat4);
+	if (settings_.draw_data == draw_data_push_constants)
+	{
+		vk_pipeline_layout_create_info.pushConstantRangeCount = 1;
+		vk_pipeline_layout_create_info.pPushConstantRanges = &vk_push_constant_range;
+	}
+
+	if (vkCreatePipelineLayout(logical_device_, &vk_pipeline_layout_create_info, nullptr, &pipeline_layout_) != VK_SUCCESS
+	)
+	{
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	//while the pipeline is created in the background the draws use a fallback with a flat fragment shader, which is
+	//needed before the first frame. Its shaders are compiled together on the job system
+	if (settings_.pipeline_threads > 0)
+	{
+		auto shader_requests = get_graphics_shaders();
+		shader_requests[1].path = "fallback.frag";
+		const auto shader_code = shader_compiler_.compile_all(shader_requests, jobs_);
+
+		//the fallback ignores the colours from the vertex shader, so it is created without any features
+		const auto start_time = std::chrono::high_resolution_clock::now();
+		fallback_pipeline_ = build_graphics_pipeline(pipeline_cache_.get(), shader_code[0], shader_code[1], 0);
+		std::cout << "fallback pipeline created in " <<
+			frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now()) << " ms" << std::endl;
+	}
+
+	//request the variant of the current shader features, a pipeline created on the render thread is ready straight
+	//away
+	const auto variant = request_graphics_variant(shader_features_);
+	pipeline_manager_.collect();
+	graphics_pipeline_ = pipeline_manager_.get(variant, fallback_pipeline_);
+}
+
+std::vector<shader_request> vulkan_application::get_graphics_shaders() const
+{
+	//scenes are lit using their normals
+	const auto drawing_scene = !settings_.scene_path.empty();
+	std::vector<shader_request> shader_requests(2);
+	shader_requests[0].path = scene_quantized_ ? "mesh_quantized.vert" : drawing_scene ? "mesh.vert" : "shader.vert";
+	shader_requests[0].stage = shader_stage_vertex;
+	shader_requests[1].path = drawing_scene ? "mesh.frag" : "shader.frag";
+	shader_requests[1].stage = shader_stage_fragment;
+
+	//the way the draws read their transforms changes the resources the vertex shader declares
+	if (settings_.draw_data == draw_data_push_constants)
+	{
+		shader_requests[0].defines.push_back({"DRAW_DATA_PUSH_CONSTANTS", "1"});
+	}
+	else if (settings_.draw_data == draw_data_dynamic_uniform)
+	{
+		shader_requests[0].defines.push_back({"DRAW_DATA_DYNAMIC_UNIFORM", "1"});
+	}
+	return shader_requests;
+}
+
+uint32_t vulkan_application::request_graphics_variant(const uint32_t features)
+{
+	//features the shaders do not use give the same pipeline, so they are left out of the key. The quad has none
+	const auto drawing_scene = !settings_.scene_path.empty();
+	const auto key = drawing_scene ? features & get_feature_mask(mesh_vertex_constants) : 0;
+	const auto found = graphics_variants_.find(key);
+	if (found != graphics_variants_.end())
+	{
+		return found->second;
+	}
+
+	//the first variant is the parent of the others, which are created as derivatives of it if it is ready by then,
+	//so drivers that support derivatives can share the work
+	graphics_pipeline_options options;
+	if (graphics_variants_.empty())
+	{
+		options.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+	}
+	else
+	{
+		options.base_pipeline = pipeline_manager_.get(base_variant_, VK_NULL_HANDLE);
+		options.flags = options.base_pipeline != VK_NULL_HANDLE ? VK_PIPELINE_CREATE_DERIVATIVE_BIT : 0;
+	}
+
+	//the pipeline is created after this function returns, so the builder keeps copies of the requests. Its shaders
+	//are compiled on the same background thread, and only the first variant compiles them. The parent is destroyed
+	//only once every builder has finished
+	std::ostringstream name;
+	name << (drawing_scene ? "scene" : "quad") << " features 0x" << std::hex << key;
+	const auto shader_requests = get_graphics_shaders();
+	const auto build = [this, shader_requests, key, options](const VkPipelineCache cache)
+	{
+		return build_graphics_pipeline(cache, shader_compiler_.compile(shader_requests[0]),
+		                               shader_compiler_.compile(shader_requests[1]), key, options);
+	};
+	const auto id = pipeline_manager_.request(name.str(), build);
+	if (graphics_variants_.empty())
+	{
+		base_variant_ = id;
+	}
+	graphics_variants_[key] = id;
+	return id;
+}
+
+VkPipeline vulkan_application::build_graphics_pipeline(const VkPipelineCache cache,
+                                                       const std::vector<uint32_t>& vert_shader_code,
+                                                       const std::vector<uint32_t>& frag_shader_code,
+                                                       const uint32_t features,
+                                                       const graphics_pipeline_options& options) const
+{
+	const auto drawing_scene = !settings_.scene_path.empty();
 
 	//create vulkan shader modules for each shader
 	const auto vert_shader_module = create_shader_module(vert_shader_code);
@@ -482,6 +1097,14 @@ void vulkan_application::create_graphics_pipeline()
 	vert_shader_stage_info.module = vert_shader_module; //the shader module for vertex
 	vert_shader_stage_info.pName = "main"; //the name of the main function of the vertex shader
 
+	//the vertex shaders of scenes select their features with specialization constants
+	shader_specialization vert_specialization;
+	if (drawing_scene)
+	{
+		vert_specialization.init(mesh_vertex_constants, features);
+	}
+	vert_shader_stage_info.pSpecializationInfo = vert_specialization.get_info();
+
 	//define the fragment shader stage
 	VkPipelineShaderStageCreateInfo frag_shader_stage_info = {};
 	frag_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -509,6 +1132,43 @@ void vulkan_application::create_graphics_pipeline()
 	vk_pipeline_vertex_input_state_create_info.pVertexAttributeDescriptions = vk_vertex_input_attribute_descriptions.
 		data();
 
+	//a scene reads its positions and normals from two streams, which may be interleaved in the same buffer
+	std::array<VkVertexInputBindingDescription, 2> scene_binding_descriptions = {};
+	std::array<VkVertexInputAttributeDescription, 2> scene_attribute_descriptions = {};
+	if (drawing_scene)
+	{
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			scene_binding_descriptions[i].binding = i;
+			scene_binding_descriptions[i].stride = i == 0 ? scene_position_stride_ : scene_normal_stride_;
+			scene_binding_descriptions[i].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+			//the position at location 0 and the normal at location 1, both 3 floats
+			scene_attribute_descriptions[i].binding = i;
+			scene_attribute_descriptions[i].location = i;
+			scene_attribute_descriptions[i].format = VK_FORMAT_R32G32B32_SFLOAT;
+			scene_attribute_descriptions[i].offset = 0;
+		}
+
+		vk_pipeline_vertex_input_state_create_info.vertexBindingDescriptionCount = 2;
+		vk_pipeline_vertex_input_state_create_info.vertexAttributeDescriptionCount = 2;
+		vk_pipeline_vertex_input_state_create_info.pVertexBindingDescriptions = scene_binding_descriptions.data();
+		vk_pipeline_vertex_input_state_create_info.pVertexAttributeDescriptions = scene_attribute_descriptions.data();
+	}
+
+	//quantized vertices are interleaved in one stream, the layout describes both attributes
+	const auto quantized_binding_description = quantized_mesh_layout::get_binding_description();
+	const auto quantized_attribute_descriptions = quantized_mesh_layout::get_attribute_descriptions();
+	if (scene_quantized_)
+	{
+		vk_pipeline_vertex_input_state_create_info.vertexBindingDescriptionCount = 1;
+		vk_pipeline_vertex_input_state_create_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(
+			quantized_attribute_descriptions.size());
+		vk_pipeline_vertex_input_state_create_info.pVertexBindingDescriptions = &quantized_binding_description;
+		vk_pipeline_vertex_input_state_create_info.pVertexAttributeDescriptions = quantized_attribute_descriptions.
+			data();
+	}
+
 	//input assembly stage
 	//this is where the data from the previous stage is assembled into vertices
 	VkPipelineInputAssemblyStateCreateInfo vk_pipeline_input_assembly_state_create_info = {};
@@ -516,30 +1176,18 @@ void vulkan_application::create_graphics_pipeline()
 	vk_pipeline_input_assembly_state_create_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST; //Triangle List 
 	vk_pipeline_input_assembly_state_create_info.primitiveRestartEnable = VK_FALSE;
 
-	//the viewport or "render area" of the window
-	//x 0, y 0, width = window width, height = window height
-	VkViewport vk_viewport = {};
-	vk_viewport.x = 0.0F;
-	vk_viewport.y = 0.0F;
-	vk_viewport.width = static_cast<float>(swap_chain_extent_.width);
-	vk_viewport.height = static_cast<float>(swap_chain_extent_.height);
-	//enable z buffer
-	vk_viewport.minDepth = 0.0F;
-	vk_viewport.maxDepth = 1.0F;
-
-	//enable scissor mask, which is used so that vulkan doesnt render anything
-	//outside of the viewport area
-	VkRect2D vk_rect2_d = {};
-	vk_rect2_d.offset = {0, 0};
-	vk_rect2_d.extent = swap_chain_extent_;
-
-	//define the viewport and scissor stage of the pipeline
+	//define the viewport and scissor stage of the pipeline, there is one of each but they are set when the
+	//command buffers are recorded so the pipeline does not depend on the size of the window
 	VkPipelineViewportStateCreateInfo vk_pipeline_viewport_state_create_info = {};
 	vk_pipeline_viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	vk_pipeline_viewport_state_create_info.viewportCount = 1;
-	vk_pipeline_viewport_state_create_info.pViewports = &vk_viewport;
 	vk_pipeline_viewport_state_create_info.scissorCount = 1;
-	vk_pipeline_viewport_state_create_info.pScissors = &vk_rect2_d;
+
+	VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo vk_pipeline_dynamic_state_create_info = {};
+	vk_pipeline_dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	vk_pipeline_dynamic_state_create_info.dynamicStateCount = 2;
+	vk_pipeline_dynamic_state_create_info.pDynamicStates = dynamic_states;
 
 	//define the rasterizer stage, which takes the vertices and produces an image
 	VkPipelineRasterizationStateCreateInfo rasterizer = {};
@@ -577,22 +1225,11 @@ void vulkan_application::create_graphics_pipeline()
 	vk_pipeline_color_blend_state_create_info.blendConstants[2] = 0.0F;
 	vk_pipeline_color_blend_state_create_info.blendConstants[3] = 0.0F;
 
-	//Finally the pipeline layout is created from the descriptor sets
-	VkPipelineLayoutCreateInfo vk_pipeline_layout_create_info = {};
-	vk_pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	vk_pipeline_layout_create_info.setLayoutCount = 1;
-	vk_pipeline_layout_create_info.pSetLayouts = &descriptor_set_layout_;
-
-	if (vkCreatePipelineLayout(logical_device_, &vk_pipeline_layout_create_info, nullptr, &pipeline_layout_) != VK_SUCCESS
-	)
-	{
-		throw std::runtime_error("failed to create pipeline layout!");
-	}
-
 	//Define the graphics pipeline and its contents
 	VkGraphicsPipelineCreateInfo vk_graphics_pipeline_create_info = {};
 	vk_graphics_pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	//this is a graphics pipeline
+	vk_graphics_pipeline_create_info.flags = options.flags;
 	vk_graphics_pipeline_create_info.stageCount = 2; //we have a vertex and a fragment shader so there are 2 stages
 	vk_graphics_pipeline_create_info.pStages = shader_stages;
 	//pass the various stages of the pipeline
@@ -602,21 +1239,134 @@ void vulkan_application::create_graphics_pipeline()
 	vk_graphics_pipeline_create_info.pRasterizationState = &rasterizer;
 	vk_graphics_pipeline_create_info.pMultisampleState = &multisampling;
 	vk_graphics_pipeline_create_info.pColorBlendState = &vk_pipeline_color_blend_state_create_info;
+	vk_graphics_pipeline_create_info.pDynamicState = &vk_pipeline_dynamic_state_create_info;
 	vk_graphics_pipeline_create_info.layout = pipeline_layout_;
 	vk_graphics_pipeline_create_info.renderPass = render_pass_; //render pass reference
 	vk_graphics_pipeline_create_info.subpass = 0;
-	vk_graphics_pipeline_create_info.basePipelineHandle = nullptr;
+	vk_graphics_pipeline_create_info.basePipelineHandle = options.base_pipeline;
+	vk_graphics_pipeline_create_info.basePipelineIndex = -1;
 
-	//create the pipeline
-	if (vkCreateGraphicsPipelines(logical_device_, nullptr, 1, &vk_graphics_pipeline_create_info, nullptr,
-	                              &graphics_pipeline_) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create graphics pipeline!");
-	}
+	//create the pipeline, the driver skips compiling the shaders if the pipeline is already in the cache
+	VkPipeline pipeline;
+	const auto result = vkCreateGraphicsPipelines(logical_device_, cache, 1, &vk_graphics_pipeline_create_info, nullptr,
+	                                              &pipeline);
 
 	//Delete the shader modules as they are now no longer needed as they are attached to the pipeline
 	vkDestroyShaderModule(logical_device_, frag_shader_module, nullptr);
 	vkDestroyShaderModule(logical_device_, vert_shader_module, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+	return pipeline;
+}
+
+void vulkan_application::benchmark_pipeline_variants()
+{
+	//every variant the shaders can tell apart, the quad has only one
+	const auto feature_mask = settings_.scene_path.empty() ? 0 : get_feature_mask(mesh_vertex_constants);
+	const auto shader_code = shader_compiler_.compile_all(get_graphics_shaders(), jobs_);
+
+	//no pipeline cache is used, but nothing turns off a driver's own cache of compiled shaders, so once a variant has
+	//been created the driver usually skips its compile. The first creation is kept apart from the median for that
+	//reason, the median is the time with the driver's cache warm
+	const auto time_runs = [this](const std::function<VkPipeline()>& create, double& first_ms)
+	{
+		std::vector<double> timings;
+		for (uint32_t run = 0; run < settings_.variant_runs; run++)
+		{
+			const auto start_time = std::chrono::high_resolution_clock::now();
+			const auto pipeline = create();
+			timings.push_back(frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now()));
+			vkDestroyPipeline(logical_device_, pipeline, nullptr);
+		}
+		first_ms = timings.front();
+		std::sort(timings.begin(), timings.end());
+		return timings[timings.size() / 2];
+	};
+
+	//the parent of the derivatives is created once, as a variant would be at startup
+	variant_report_ = pipeline_variant_report();
+	graphics_pipeline_options base_options;
+	base_options.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+	const auto start_time = std::chrono::high_resolution_clock::now();
+	const auto base_pipeline = build_graphics_pipeline(VK_NULL_HANDLE, shader_code[0], shader_code[1], 0,
+	                                                   base_options);
+	variant_report_.base_ms = frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now());
+
+	for (uint32_t features = 0; features <= feature_mask; features++)
+	{
+		if ((features & ~feature_mask) != 0)
+		{
+			continue;
+		}
+
+		pipeline_variant_timing timing = {features, 0.0, 0.0, 0.0};
+		timing.full_ms = time_runs([&]
+		{
+			return build_graphics_pipeline(VK_NULL_HANDLE, shader_code[0], shader_code[1], features);
+		}, timing.full_first_ms);
+
+		graphics_pipeline_options derivative_options;
+		derivative_options.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+		derivative_options.base_pipeline = base_pipeline;
+		//the derivatives are created after the full pipelines, so even their first creation finds the driver warm
+		double derivative_first_ms;
+		timing.derivative_ms = time_runs([&]
+		{
+			return build_graphics_pipeline(VK_NULL_HANDLE, shader_code[0], shader_code[1], features,
+			                               derivative_options);
+		}, derivative_first_ms);
+
+		variant_report_.variants.push_back(timing);
+		std::cout << "variant 0x" << std::hex << features << std::dec << " first created in " << timing.full_first_ms <<
+			" ms, then in " << timing.full_ms << " ms and as a derivative in " << timing.derivative_ms <<
+			" ms, the warm median of " << settings_.variant_runs << " runs" << std::endl;
+	}
+
+	vkDestroyPipeline(logical_device_, base_pipeline, nullptr);
+}
+
+void vulkan_application::create_culling_pipeline()
+{
+	if (!settings_.gpu_culling)
+	{
+		return;
+	}
+
+	//the culling pass is recorded into the command buffers submitted to the graphics queue
+	const auto indices = find_queue_families(physical_device_);
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &queue_family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device_, &queue_family_count, queue_families.data());
+	if ((queue_families[indices.graphics_family].queueFlags & VK_QUEUE_COMPUTE_BIT) == 0)
+	{
+		throw std::runtime_error("the graphics queue does not support compute, cull on the CPU instead!");
+	}
+
+	shader_request compute_shader_request;
+	compute_shader_request.path = "cull_instances.comp";
+	compute_shader_request.stage = shader_stage_compute;
+	const auto compute_shader_module = create_shader_module(shader_compiler_.compile(compute_shader_request));
+
+	VkComputePipelineCreateInfo vk_compute_pipeline_create_info = {};
+	vk_compute_pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	vk_compute_pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vk_compute_pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	vk_compute_pipeline_create_info.stage.module = compute_shader_module;
+	vk_compute_pipeline_create_info.stage.pName = "main";
+	//the compute shader reads the same descriptor set as the vertex shader
+	vk_compute_pipeline_create_info.layout = pipeline_layout_;
+
+	if (vkCreateComputePipelines(logical_device_, pipeline_cache_.get(), 1, &vk_compute_pipeline_create_info, nullptr,
+	                             &culling_pipeline_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create culling pipeline!");
+	}
+
+	vkDestroyShaderModule(logical_device_, compute_shader_module, nullptr);
 }
 
 void vulkan_application::create_framebuffers()
@@ -657,12 +1407,85 @@ void vulkan_application::create_command_pool()
 	VkCommandPoolCreateInfo vk_command_pool_create_info = {};
 	vk_command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	vk_command_pool_create_info.queueFamilyIndex = indices.graphics_family;
+	//the command buffers can be recorded again without freeing them, to measure how long recording takes
+	vk_command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
 	//create the command pool
 	if (vkCreateCommandPool(logical_device_, &vk_command_pool_create_info, nullptr, &command_pool_) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create graphics command pool!");
 	}
+
+	//when recording every frame, each frame in flight has a pool of its own that is reset as a whole before the frame
+	//is recorded. The command buffer only lives for a frame, which the transient flag tells the driver
+	if (settings_.dynamic_recording)
+	{
+		frame_command_pools_.resize(settings_.max_frames_in_flight);
+		frame_command_buffers_.resize(settings_.max_frames_in_flight);
+		for (uint32_t i = 0; i < settings_.max_frames_in_flight; i++)
+		{
+			VkCommandPoolCreateInfo vk_frame_command_pool_create_info = {};
+			vk_frame_command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			vk_frame_command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			vk_frame_command_pool_create_info.queueFamilyIndex = indices.graphics_family;
+
+			if (vkCreateCommandPool(logical_device_, &vk_frame_command_pool_create_info, nullptr,
+			                        &frame_command_pools_[i]) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create frame command pool!");
+			}
+
+			VkCommandBufferAllocateInfo vk_command_buffer_allocate_info = {};
+			vk_command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			vk_command_buffer_allocate_info.commandPool = frame_command_pools_[i];
+			vk_command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			vk_command_buffer_allocate_info.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(logical_device_, &vk_command_buffer_allocate_info, &frame_command_buffers_[i]) !=
+				VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate frame command buffer!");
+			}
+		}
+	}
+
+	//the recording slices each have command pools of their own
+	if (settings_.recording_threads > 0)
+	{
+		recorder_.init(logical_device_, indices.graphics_family, jobs_, settings_.recording_threads);
+	}
+}
+
+void vulkan_application::create_gpu_timer()
+{
+	const auto indices = find_queue_families(physical_device_);
+
+	//the command buffers are submitted to the graphics queue and record a single render pass, after the culling pass
+	//when culling on the GPU
+	std::vector<std::string> pass_names = {"render pass"};
+	if (settings_.gpu_culling)
+	{
+		pass_names.push_back("culling");
+	}
+	gpu_timer_.init(physical_device_, logical_device_, indices.graphics_family, pass_names);
+}
+
+void vulkan_application::create_staging_ring()
+{
+	const auto indices = find_queue_families(physical_device_);
+
+	//copies on a transfer only queue run on the DMA engines alongside rendering, the data is then handed over
+	//to the graphics queue. Without one the copies are executed on the graphics queue ahead of the frames
+	if (settings_.use_transfer_queue && indices.transfer_family >= 0)
+	{
+		staging_ring_.init(logical_device_, memory_allocator_, indices.transfer_family, transfer_queue_,
+		                   indices.graphics_family, graphics_queue_);
+	}
+	else
+	{
+		staging_ring_.init(logical_device_, memory_allocator_, indices.graphics_family, graphics_queue_,
+		                   indices.graphics_family, graphics_queue_);
+	}
 }
 
 void vulkan_application::create_vertex_buffer()
@@ -670,78 +1493,237 @@ void vulkan_application::create_vertex_buffer()
 	//define the size of the memory block, which is the size of a vertex multiplied by the size of the vertex struct
 	const auto buffer_size = sizeof(vertices[0]) * vertices.size();
 
-	//create a staging buffer in local memory, which will be used to upload data to the GPU
-	VkBuffer staging_buffer;
-	VkDeviceMemory staging_buffer_memory;
-	create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-	              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer,
-	              staging_buffer_memory);
-
-	//now copy the vertex data to the staging buffer
-	void* data;
-	vkMapMemory(logical_device_, staging_buffer_memory, 0, buffer_size, 0, &data);
-	//obtain the memory location for writing
-	memcpy(data, vertices.data(), static_cast<size_t>(buffer_size)); //copy the data to this memory location
-	vkUnmapMemory(logical_device_, staging_buffer_memory); //close the memory location for writing
-
 	//create the vertex buffer
 	create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-	              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer_, vertex_buffer_memory_);
-	//copy the data from the staging buffer to the vertex buffer on the GPU
-	copy_buffer(staging_buffer, vertex_buffer_, buffer_size);
+	              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer_, vertex_buffer_allocation_);
 
-	//now destroy the staging buffer and free its memory
-	vkDestroyBuffer(logical_device_, staging_buffer, nullptr);
-	vkFreeMemory(logical_device_, staging_buffer_memory, nullptr);
+	//copy the vertex data into the staging ring, the copy to the vertex buffer on the GPU is recorded and
+	//submitted together with the other uploads
+	staging_ring_.upload_buffer(vertex_buffer_, 0, vertices.data(), buffer_size);
 }
 
 void vulkan_application::create_index_buffer()
 {
 	const auto buffer_size = sizeof(indices[0]) * indices.size();
 
-	//create a staging buffer in local memory, which will be used to upload data to the GPU
-	VkBuffer staging_buffer;
-	VkDeviceMemory staging_buffer_memory;
-	create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-	              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer,
-	              staging_buffer_memory);
+	//create the index buffer
+	create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+	              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_buffer_, index_buffer_allocation_);
+
+	//copy the index data into the staging ring, it is uploaded in the same submission as the vertex data
+	staging_ring_.upload_buffer(index_buffer_, 0, indices.data(), buffer_size);
+}
+
+void vulkan_application::create_scene_buffers()
+{
+	//the draws of a baked file were read with the file, and the data is uploaded in one piece per buffer
+	if (baked_scene_.get_draws() != nullptr)
+	{
+		const auto& header = baked_scene_.get_header();
+		create_buffer(header.vertex_data_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer_, vertex_buffer_allocation_);
+		create_buffer(header.index_data_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_buffer_, index_buffer_allocation_);
+		staging_ring_.upload_buffer(vertex_buffer_, 0, baked_scene_.get_vertex_data(), header.vertex_data_size);
+		staging_ring_.upload_buffer(index_buffer_, 0, baked_scene_.get_index_data(), header.index_data_size);
+		baked_scene_.close();
+		return;
+	}
+
+	//lay the streams of every primitive out one after another. Vertex streams start on 16 bytes so any attribute
+	//format is aligned, and index streams on 4 bytes as vkCmdBindIndexBuffer requires a multiple of the index size
+	const auto align = [](const VkDeviceSize offset, const VkDeviceSize alignment)
+	{
+		return (offset + alignment - 1) & ~(alignment - 1);
+	};
+
+	VkDeviceSize vertex_buffer_size = 0;
+	VkDeviceSize index_buffer_size = 0;
+	mesh_draws_.clear();
+	for (const auto& mesh : scene_.get_meshes())
+	{
+		for (const auto& primitive : mesh.primitives)
+		{
+			mesh_draw draw = {};
+			draw.position_offset = align(vertex_buffer_size, 16);
+			vertex_buffer_size = draw.position_offset + primitive.position.get_byte_length();
+			draw.normal_offset = align(vertex_buffer_size, 16);
+			vertex_buffer_size = draw.normal_offset + primitive.normal.get_byte_length();
+			draw.index_offset = align(index_buffer_size, 4);
+			index_buffer_size = draw.index_offset + primitive.indices.get_byte_length();
+			draw.index_type = primitive.indices.component_type == gltf_unsigned_int
+				                  ? VK_INDEX_TYPE_UINT32
+				                  : VK_INDEX_TYPE_UINT16;
+			draw.index_count = primitive.indices.count;
+			mesh_draws_.push_back(draw);
+		}
+	}
 
-	//now copy the vertex data to the staging buffer
-	void* data;
-	vkMapMemory(logical_device_, staging_buffer_memory, 0, buffer_size, 0, &data);
-	//obtain the memory location for writing
-	memcpy(data, indices.data(), static_cast<size_t>(buffer_size)); //copy the data to this memory location
-	vkUnmapMemory(logical_device_, staging_buffer_memory); //close the memory location for writing
+	create_buffer(vertex_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+	              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertex_buffer_, vertex_buffer_allocation_);
+	create_buffer(index_buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+	              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_buffer_, index_buffer_allocation_);
 
-	//create the index buffer
-	create_buffer(buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-	              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, index_buffer_, index_buffer_memory_);
-	//copy the data from the staging buffer to the index buffer on the GPU
-	copy_buffer(staging_buffer, index_buffer_, buffer_size);
+	//copy each accessor range from the mapping into the staging ring, the only copy made on the CPU. Strided
+	//streams are copied whole, with whatever they are interleaved with, so the stride in the pipeline still applies
+	auto draw = mesh_draws_.begin();
+	for (const auto& mesh : scene_.get_meshes())
+	{
+		for (const auto& primitive : mesh.primitives)
+		{
+			staging_ring_.upload_buffer(vertex_buffer_, draw->position_offset, primitive.position.data,
+			                            primitive.position.get_byte_length());
+			staging_ring_.upload_buffer(vertex_buffer_, draw->normal_offset, primitive.normal.data,
+			                            primitive.normal.get_byte_length());
+			staging_ring_.upload_buffer(index_buffer_, draw->index_offset, primitive.indices.data,
+			                            primitive.indices.get_byte_length());
+			++draw;
+		}
+	}
 
-	//now destroy the staging buffer and free its memory
-	vkDestroyBuffer(logical_device_, staging_buffer, nullptr);
-	vkFreeMemory(logical_device_, staging_buffer_memory, nullptr);
+	//the data is in the staging ring now, so the files can be unmapped
+	scene_.unload();
 }
 
 void vulkan_application::create_uniform_buffer()
 {
-	const auto buffer_size = sizeof(uniform_buffer_object);
+	//each slot has to start at a multiple of minUniformBufferOffsetAlignment to be used as a dynamic offset
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device_, &properties);
+	const auto alignment = properties.limits.minUniformBufferOffsetAlignment;
+	uniform_slot_size_ = (sizeof(uniform_buffer_object) + alignment - 1) & ~(alignment - 1);
+	uniform_slot_count_ = static_cast<uint32_t>(swap_chain_images_.size());
+
+	//the memory is host visible, so the allocator keeps it mapped for the lifetime of the device
+	const auto buffer_size = uniform_slot_size_ * uniform_slot_count_;
 	create_buffer(buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 	              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniform_buffer_,
-	              uniform_buffer_memory_);
+	              uniform_buffer_allocation_);
+}
+
+void vulkan_application::create_instance_buffer()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device_, &properties);
+	const VkDeviceSize transforms_size = sizeof(glm::mat4) * settings_.instance_count;
+	if (transforms_size > properties.limits.maxStorageBufferRange)
+	{
+		throw std::runtime_error("too many instances for one storage buffer!");
+	}
+
+	//each slot has to start at a multiple of minStorageBufferOffsetAlignment to be used as a dynamic offset. When a
+	//draw reads its transform as a uniform buffer, each transform has to start at a multiple of
+	//minUniformBufferOffsetAlignment as well
+	const auto uniform_transforms = settings_.draw_data == draw_data_dynamic_uniform;
+	const auto alignment = uniform_transforms
+		                       ? std::max(properties.limits.minStorageBufferOffsetAlignment,
+		                                  properties.limits.minUniformBufferOffsetAlignment)
+		                       : properties.limits.minStorageBufferOffsetAlignment;
+	const auto align = [alignment](const VkDeviceSize size)
+	{
+		return (size + alignment - 1) & ~(alignment - 1);
+	};
+	instance_stride_ = uniform_transforms ? align(sizeof(glm::mat4)) : sizeof(glm::mat4);
+	instance_slot_size_ = align(instance_stride_ * settings_.instance_count);
+	create_buffer(instance_slot_size_ * uniform_slot_count_,
+	              uniform_transforms ? VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT : VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instance_buffer_,
+	              instance_buffer_allocation_);
+
+	//the visible count is followed by the draw commands, the quad is drawn directly but the buffer still needs a size.
+	//Only the GPU writes the visible list and the count when culling on the GPU, so they stay in device local memory
+	const auto gpu_writes = settings_.gpu_culling ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		                        : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	visible_slot_size_ = align(sizeof(uint32_t) * settings_.instance_count);
+	create_buffer(visible_slot_size_ * uniform_slot_count_, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, gpu_writes,
+	              visible_buffer_, visible_buffer_allocation_);
+	indirect_slot_size_ = align(sizeof(uint32_t) + sizeof(VkDrawIndexedIndirectCommand) *
+		std::max<size_t>(mesh_draws_.size(), 1));
+	create_buffer(indirect_slot_size_ * uniform_slot_count_,
+	              VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+	              VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, gpu_writes, indirect_buffer_,
+	              indirect_buffer_allocation_);
+
+	//the CPU packs the transforms of the visible instances at the start of the instance buffer, so the visible list
+	//never changes. The compute pass only fills in the instance counts, the rest of each draw command is uploaded once
+	if (!settings_.gpu_culling)
+	{
+		for (uint32_t slot = 0; slot < uniform_slot_count_; slot++)
+		{
+			const auto visible = reinterpret_cast<uint32_t*>(static_cast<char*>(visible_buffer_allocation_.mapped) +
+				visible_slot_size_ * slot);
+			for (uint32_t i = 0; i < settings_.instance_count; i++)
+			{
+				visible[i] = i;
+			}
+		}
+	}
+	else
+	{
+		std::vector<char> draw_commands(static_cast<size_t>(indirect_slot_size_), 0);
+		for (size_t i = 0; i < mesh_draws_.size(); i++)
+		{
+			VkDrawIndexedIndirectCommand command = {};
+			command.indexCount = mesh_draws_[i].index_count;
+			memcpy(draw_commands.data() + sizeof(uint32_t) + sizeof(command) * i, &command, sizeof(command));
+		}
+		for (uint32_t slot = 0; slot < uniform_slot_count_; slot++)
+		{
+			staging_ring_.upload_buffer(indirect_buffer_, indirect_slot_size_ * slot, draw_commands.data(),
+			                            indirect_slot_size_);
+		}
+	}
+
+	//the grid and the bounds only have to be made once, they do not depend on the number of slots
+	if (!instance_placements_.empty())
+	{
+		staging_ring_.wait_ready(staging_ring_.flush());
+		return;
+	}
+
+	//lay the instances out on a cube, spaced so their bounding spheres never touch. Each instance starts at a
+	//different angle so the copies can be told apart
+	const auto grid_size = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(settings_.instance_count))));
+	const auto spacing = scene_radius_ * 2.0F;
+	const auto grid_offset = (static_cast<float>(grid_size) - 1.0F) * 0.5F;
+	instance_placements_.resize(settings_.instance_count);
+	instance_culler_.reserve(settings_.instance_count);
+	for (uint32_t i = 0; i < settings_.instance_count; i++)
+	{
+		const auto cell = glm::vec3(static_cast<float>(i % grid_size), static_cast<float>(i / grid_size % grid_size),
+		                            static_cast<float>(i / (grid_size * grid_size)));
+		instance_placements_[i] = glm::vec4((cell - grid_offset) * spacing, static_cast<float>(i) * 2.39996F);
+
+		//the scene spins around the centre of its box, so the sphere through the corners of the box always holds it
+		instance_culler_.add_sphere(glm::vec3(instance_placements_[i]), scene_radius_);
+	}
+	instance_transforms_.resize(settings_.instance_count);
+	instance_grid_radius_ = grid_offset * spacing * std::sqrt(3.0F);
+
+	//the compute pass moves the sphere around the scene with each instance's transform, so it is the same for all
+	const std::vector<glm::vec4> bounds(settings_.instance_count, glm::vec4(scene_center_, scene_radius_));
+	create_buffer(sizeof(glm::vec4) * bounds.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+	              VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, bounds_buffer_,
+	              bounds_buffer_allocation_);
+	staging_ring_.upload_buffer(bounds_buffer_, 0, bounds.data(), sizeof(glm::vec4) * bounds.size());
+	staging_ring_.wait_ready(staging_ring_.flush());
 }
 
 void vulkan_application::create_descriptor_pool()
 {
-	VkDescriptorPoolSize vk_descriptor_pool_size = {};
-	vk_descriptor_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	vk_descriptor_pool_size.descriptorCount = 1;
+	std::array<VkDescriptorPoolSize, 3> vk_descriptor_pool_sizes = {};
+	//the instance transforms are a uniform buffer or a storage buffer, so there is room for either
+	vk_descriptor_pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	vk_descriptor_pool_sizes[0].descriptorCount = 2;
+	vk_descriptor_pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	vk_descriptor_pool_sizes[1].descriptorCount = 3;
+	vk_descriptor_pool_sizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	vk_descriptor_pool_sizes[2].descriptorCount = 1;
 
 	VkDescriptorPoolCreateInfo vk_descriptor_pool_create_info = {};
 	vk_descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	vk_descriptor_pool_create_info.poolSizeCount = 1;
-	vk_descriptor_pool_create_info.pPoolSizes = &vk_descriptor_pool_size;
+	vk_descriptor_pool_create_info.poolSizeCount = static_cast<uint32_t>(vk_descriptor_pool_sizes.size());
+	vk_descriptor_pool_create_info.pPoolSizes = vk_descriptor_pool_sizes.data();
 	vk_descriptor_pool_create_info.maxSets = 1;
 
 	if (vkCreateDescriptorPool(logical_device_, &vk_descriptor_pool_create_info, nullptr, &descriptor_pool_) != VK_SUCCESS
@@ -765,26 +1747,43 @@ void vulkan_application::create_descriptor_set()
 		throw std::runtime_error("failed to allocate descriptor set!");
 	}
 
-	VkDescriptorBufferInfo vk_descriptor_buffer_info = {};
-	vk_descriptor_buffer_info.buffer = uniform_buffer_;
-	vk_descriptor_buffer_info.offset = 0;
-	vk_descriptor_buffer_info.range = sizeof(uniform_buffer_object); //the size of the uniform data that will be sent
+	write_descriptor_set();
+}
+
+void vulkan_application::write_descriptor_set() const
+{
+	//each descriptor covers one slot, the dynamic offsets move them to the slots of the frame. The buffer sizes give
+	//the shaders the number of instances and draws. A uniform buffer of transforms covers the one of a single draw
+	const VkDeviceSize instance_range = settings_.draw_data == draw_data_dynamic_uniform
+		                                    ? sizeof(glm::mat4)
+		                                    : sizeof(glm::mat4) * settings_.instance_count;
+	const VkDescriptorBufferInfo vk_descriptor_buffer_infos[] = {
+		{uniform_buffer_, 0, sizeof(uniform_buffer_object)},
+		{instance_buffer_, 0, instance_range},
+		{visible_buffer_, 0, sizeof(uint32_t) * settings_.instance_count},
+		{bounds_buffer_, 0, sizeof(glm::vec4) * settings_.instance_count},
+		{indirect_buffer_, 0, sizeof(uint32_t) + sizeof(VkDrawIndexedIndirectCommand) * mesh_draws_.size()}
+	};
 
-	VkWriteDescriptorSet vk_write_descriptor_set = {};
-	vk_write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	vk_write_descriptor_set.dstSet = descriptor_set_;
-	vk_write_descriptor_set.dstBinding = 0;
-	vk_write_descriptor_set.dstArrayElement = 0;
-	vk_write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	vk_write_descriptor_set.descriptorCount = 1;
-	vk_write_descriptor_set.pBufferInfo = &vk_descriptor_buffer_info;
+	std::array<VkWriteDescriptorSet, 5> vk_write_descriptor_sets = {};
+	for (uint32_t i = 0; i < vk_write_descriptor_sets.size(); i++)
+	{
+		vk_write_descriptor_sets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		vk_write_descriptor_sets[i].dstSet = descriptor_set_;
+		vk_write_descriptor_sets[i].dstBinding = i;
+		vk_write_descriptor_sets[i].dstArrayElement = 0;
+		vk_write_descriptor_sets[i].descriptorType = get_descriptor_types()[i];
+		vk_write_descriptor_sets[i].descriptorCount = 1;
+		vk_write_descriptor_sets[i].pBufferInfo = &vk_descriptor_buffer_infos[i];
+	}
 
-	vkUpdateDescriptorSets(logical_device_, 1, &vk_write_descriptor_set, 0, nullptr);
+	vkUpdateDescriptorSets(logical_device_, static_cast<uint32_t>(vk_write_descriptor_sets.size()),
+	                       vk_write_descriptor_sets.data(), 0, nullptr);
 }
 
 void vulkan_application::create_buffer(const VkDeviceSize size, const VkBufferUsageFlags usage,
                                        const VkMemoryPropertyFlags properties, VkBuffer& buffer,
-                                       VkDeviceMemory& buffer_memory) const
+                                       memory_allocation& buffer_allocation)
 {
 	VkBufferCreateInfo vk_buffer_create_info = {};
 	vk_buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -801,86 +1800,53 @@ void vulkan_application::create_buffer(const VkDeviceSize size, const VkBufferUs
 	VkMemoryRequirements vk_memory_requirements;
 	vkGetBufferMemoryRequirements(logical_device_, buffer, &vk_memory_requirements);
 
-	VkMemoryAllocateInfo vk_memory_allocate_info = {};
-	vk_memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	vk_memory_allocate_info.allocationSize = vk_memory_requirements.size; //the size of memory we need
-	vk_memory_allocate_info.memoryTypeIndex = find_memory_type(vk_memory_requirements.memoryTypeBits, properties);
-	//the type of memory
-
-	//allocate the memory for this buffer on the GPU
-	if (vkAllocateMemory(logical_device_, &vk_memory_allocate_info, nullptr, &buffer_memory) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to allocate buffer memory!");
-	}
+	//take a range of a larger memory block of the right type for this buffer, rather than allocating memory
+	//for each buffer, as the number of allocations a device supports is limited
+	const auto memory_type = find_memory_type(vk_memory_requirements.memoryTypeBits, properties);
+	buffer_allocation = memory_allocator_.allocate(vk_memory_requirements, memory_type, allocation_kind::linear);
 
-	//bind the memory on the GPU
-	vkBindBufferMemory(logical_device_, buffer, buffer_memory, 0);
+	//bind the memory on the GPU at the start of the range
+	vkBindBufferMemory(logical_device_, buffer, buffer_allocation.memory, buffer_allocation.offset);
 }
 
-void vulkan_application::copy_buffer(const VkBuffer src_buffer, const VkBuffer dst_buffer,
-                                     const VkDeviceSize size) const
+void vulkan_application::destroy_buffer(VkBuffer& buffer, memory_allocation& buffer_allocation)
 {
-	//In order to copy data from a buffer to another, we need to execute the commands on the GPU
-	//therefore a command buffer is required
-	VkCommandBufferAllocateInfo vk_command_buffer_allocate_info = {};
-	vk_command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	vk_command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	vk_command_buffer_allocate_info.commandPool = command_pool_; //use the previously specified command pool
-	vk_command_buffer_allocate_info.commandBufferCount = 1;
-
-	//obtain a command buffer to use from the GPU
-	VkCommandBuffer vk_command_buffer;
-	vkAllocateCommandBuffers(logical_device_, &vk_command_buffer_allocate_info, &vk_command_buffer);
-
-	//begin recording the commands
-	VkCommandBufferBeginInfo vk_command_buffer_begin_info = {};
-	vk_command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	vk_command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	//this command will be submitted once
-
-	vkBeginCommandBuffer(vk_command_buffer, &vk_command_buffer_begin_info);
-
-	//define the size of data to copy
-	VkBufferCopy vk_buffer_copy = {};
-	vk_buffer_copy.size = size;
-	//perform the copying
-	vkCmdCopyBuffer(vk_command_buffer, src_buffer, dst_buffer, 1, &vk_buffer_copy);
-
-	//end recording
-	vkEndCommandBuffer(vk_command_buffer);
-
-	//submit these commands to the graphics queue and execute
-	VkSubmitInfo vk_submit_info = {};
-	vk_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	vk_submit_info.commandBufferCount = 1;
-	vk_submit_info.pCommandBuffers = &vk_command_buffer;
-
-	vkQueueSubmit(graphics_queue_, 1, &vk_submit_info, nullptr);
-	//wait for the graphics queue to be idle which signifies the command was complete
-	vkQueueWaitIdle(graphics_queue_);
-
-	//destroy the command buffer
-	vkFreeCommandBuffers(logical_device_, command_pool_, 1, &vk_command_buffer);
+	vkDestroyBuffer(logical_device_, buffer, nullptr);
+	memory_allocator_.free(buffer_allocation);
+	buffer = VK_NULL_HANDLE;
 }
 
 uint32_t vulkan_application::find_memory_type(const uint32_t type_filter, const VkMemoryPropertyFlags properties) const
 {
-	VkPhysicalDeviceMemoryProperties memory_properties;
-	vkGetPhysicalDeviceMemoryProperties(physical_device_, &memory_properties);
+	//the allocator already holds the memory properties of the device
+	return memory_allocator_.find_memory_type(type_filter, properties);
+}
+
+void vulkan_application::create_command_buffers()
+{
+	//each command buffer writes its timestamps to its own queries, so they can be read while others execute
+	gpu_timer_.resize(static_cast<uint32_t>(swap_chain_framebuffers_.size()));
 
-	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+	//the threads record into secondary command buffers of their own, in a slot for each primary or, when recording
+	//every frame, for each frame in flight
+	if (settings_.recording_threads > 0)
 	{
-		if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+		if (settings_.dynamic_recording)
 		{
-			return i;
+			recorder_.resize(settings_.max_frames_in_flight, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+		}
+		else
+		{
+			recorder_.resize(static_cast<uint32_t>(swap_chain_framebuffers_.size()), 0);
 		}
 	}
 
-	throw std::runtime_error("failed to find suitable memory type!");
-}
+	//the command buffers are recorded as the frames are drawn
+	if (settings_.dynamic_recording)
+	{
+		return;
+	}
 
-void vulkan_application::create_command_buffers()
-{
 	//we need the same number of command buffers as there are framebuffers
 	command_buffers_.resize(swap_chain_framebuffers_.size());
 
@@ -898,76 +1864,331 @@ void vulkan_application::create_command_buffers()
 	}
 
 	//For each command buffer, record the commands that will be executed by the GPU each frame
-	//This is where the drawing code goes
-	for (size_t i = 0; i < command_buffers_.size(); i++)
-	{
-		//begin recording command
-		VkCommandBufferBeginInfo vk_command_buffer_begin_info = {};
-		vk_command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		vk_command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-		//these commands will be executed once
-		vkBeginCommandBuffer(command_buffers_[i], &vk_command_buffer_begin_info);
-
-		//define the render pass, framebuffer and render area
-		VkRenderPassBeginInfo vk_render_pass_begin_info = {};
-		vk_render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		vk_render_pass_begin_info.renderPass = render_pass_;
-		vk_render_pass_begin_info.framebuffer = swap_chain_framebuffers_[i];
-		vk_render_pass_begin_info.renderArea.offset = {0, 0};
-		vk_render_pass_begin_info.renderArea.extent = swap_chain_extent_;
-
-		//set the clear color 
-		VkClearValue vk_clear_value = {0.0F, 0.0F, 0.0F, 1.0F};
-		vk_render_pass_begin_info.clearValueCount = 1;
-		vk_render_pass_begin_info.pClearValues = &vk_clear_value;
-
-		//begin the render pass
-		vkCmdBeginRenderPass(command_buffers_[i], &vk_render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-		//bind the graphics pipeline
-		vkCmdBindPipeline(command_buffers_[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_);
+	for (uint32_t i = 0; i < command_buffers_.size(); i++)
+	{
+		record_command_buffer(command_buffers_[i], i);
+	}
+	stale_command_buffers_.assign(command_buffers_.size(), false);
+}
+
+void vulkan_application::record_command_buffer(const VkCommandBuffer command_buffer, const uint32_t slot)
+{
+	//a command buffer recorded every frame is submitted once, otherwise it is submitted again every time its image is
+	//drawn to
+	const VkCommandBufferUsageFlags usage = settings_.dynamic_recording
+		                                        ? VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+		                                        : VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+
+	//begin recording command
+	VkCommandBufferBeginInfo vk_command_buffer_begin_info = {};
+	vk_command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	vk_command_buffer_begin_info.flags = usage;
+	vkBeginCommandBuffer(command_buffer, &vk_command_buffer_begin_info);
+
+	//the queries are reset on every submission, the timestamps are written around each pass
+	gpu_timer_.record_reset(command_buffer, slot);
+
+	//cull the instances before the render pass, compute work cannot be recorded inside one
+	if (settings_.gpu_culling)
+	{
+		record_culling(command_buffer, slot, get_dynamic_offsets(slot).data());
+	}
+
+	gpu_timer_.record_begin(command_buffer, slot, 0);
+
+	//define the render pass, framebuffer and render area
+	VkRenderPassBeginInfo vk_render_pass_begin_info = {};
+	vk_render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	vk_render_pass_begin_info.renderPass = render_pass_;
+	vk_render_pass_begin_info.framebuffer = swap_chain_framebuffers_[slot];
+	vk_render_pass_begin_info.renderArea.offset = {0, 0};
+	vk_render_pass_begin_info.renderArea.extent = swap_chain_extent_;
+
+	//set the clear color 
+	VkClearValue vk_clear_value = {0.0F, 0.0F, 0.0F, 1.0F};
+	vk_render_pass_begin_info.clearValueCount = 1;
+	vk_render_pass_begin_info.pClearValues = &vk_clear_value;
+
+	//begin the render pass, its draws are either recorded here or in the secondary command buffers it executes
+	const auto use_secondary = settings_.recording_threads > 0;
+	vkCmdBeginRenderPass(command_buffer, &vk_render_pass_begin_info,
+	                     use_secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+	//the quad is drawn as a single draw
+	const auto draw_count = std::max<size_t>(mesh_draws_.size(), 1);
+	if (use_secondary)
+	{
+		//the secondary command buffers are only used inside this render pass and framebuffer
+		VkCommandBufferInheritanceInfo vk_command_buffer_inheritance_info = {};
+		vk_command_buffer_inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		vk_command_buffer_inheritance_info.renderPass = render_pass_;
+		vk_command_buffer_inheritance_info.subpass = 0;
+		vk_command_buffer_inheritance_info.framebuffer = swap_chain_framebuffers_[slot];
+
+		//each thread records a slice of the draws, then they are executed in order. The secondary command buffers
+		//belong to the frame in flight when they are recorded every frame
+		const auto recorder_slot = settings_.dynamic_recording ? static_cast<uint32_t>(current_frame_) : slot;
+		recorder_.record(recorder_slot, usage, vk_command_buffer_inheritance_info, draw_count,
+		                 [&](const VkCommandBuffer secondary_command_buffer, const size_t first, const size_t last)
+		                 {
+			                 record_draws(secondary_command_buffer, slot, first, last);
+		                 }, secondary_command_buffers_);
+		vkCmdExecuteCommands(command_buffer, static_cast<uint32_t>(secondary_command_buffers_.size()),
+		                     secondary_command_buffers_.data());
+	}
+	else
+	{
+		record_draws(command_buffer, slot, 0, draw_count);
+	}
+
+	//end the rennder pass
+	vkCmdEndRenderPass(command_buffer);
+	gpu_timer_.record_end(command_buffer, slot, 0);
+
+	//end command recording
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record command buffer!");
+	}
+}
+
+VkCommandBuffer vulkan_application::record_frame_command_buffer(const uint32_t image_index)
+{
+	//resetting the pool recycles the memory of everything allocated from it at once
+	if (vkResetCommandPool(logical_device_, frame_command_pools_[current_frame_], 0) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to reset frame command pool!");
+	}
+	record_command_buffer(frame_command_buffers_[current_frame_], image_index);
+	return frame_command_buffers_[current_frame_];
+}
+
+void vulkan_application::record_draws(const VkCommandBuffer command_buffer, const uint32_t slot,
+                                      const size_t first_draw, const size_t last_draw) const
+{
+	//bind the graphics pipeline, or the fallback until it has been created
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_);
+
+	//the viewport or "render area" of the window
+	//x 0, y 0, width = window width, height = window height
+	VkViewport vk_viewport = {};
+	vk_viewport.x = 0.0F;
+	vk_viewport.y = 0.0F;
+	vk_viewport.width = static_cast<float>(swap_chain_extent_.width);
+	vk_viewport.height = static_cast<float>(swap_chain_extent_.height);
+	//enable z buffer
+	vk_viewport.minDepth = 0.0F;
+	vk_viewport.maxDepth = 1.0F;
+	vkCmdSetViewport(command_buffer, 0, 1, &vk_viewport);
+
+	//enable scissor mask, which is used so that vulkan doesnt render anything
+	//outside of the viewport area
+	VkRect2D vk_rect2_d = {};
+	vk_rect2_d.offset = {0, 0};
+	vk_rect2_d.extent = swap_chain_extent_;
+	vkCmdSetScissor(command_buffer, 0, 1, &vk_rect2_d);
+
+	//bind the descriptor sets (uniform and storage buffers), each command buffer reads its own slots
+	const auto dynamic_offsets = get_dynamic_offsets(slot);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1, &descriptor_set_,
+	                        static_cast<uint32_t>(dynamic_offsets.size()), dynamic_offsets.data());
 
+	if (mesh_draws_.empty())
+	{
 		//define the vertex buffers required
 		VkBuffer vertex_buffers[] = {vertex_buffer_};
 		VkDeviceSize offsets[] = {0};
 		//bind the vertex buffers
-		vkCmdBindVertexBuffers(command_buffers_[i], 0, 1, vertex_buffers, offsets);
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
 
 		//bind the index buffer
-		vkCmdBindIndexBuffer(command_buffers_[i], index_buffer_, 0, VK_INDEX_TYPE_UINT16);
-
-		//bind the descriptor sets (uniform buffers)
-		vkCmdBindDescriptorSets(command_buffers_[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1,
-		                        &descriptor_set_, 0, nullptr);
+		vkCmdBindIndexBuffer(command_buffer, index_buffer_, 0, VK_INDEX_TYPE_UINT16);
 
 		//draw the vertices index using the indices
-		vkCmdDrawIndexed(command_buffers_[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+		vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+	}
+
+	//draw each primitive of the scene from its own range of the vertex and index buffers, once for every
+	//visible instance. The number of instances is read from the indirect buffer, which is written every frame,
+	//and the vertex shader picks the instance's transform with the instance index
+	for (auto draw = first_draw; draw < std::min(last_draw, mesh_draws_.size()); draw++)
+	{
+		VkBuffer vertex_buffers[] = {vertex_buffer_, vertex_buffer_};
+		VkDeviceSize offsets[] = {mesh_draws_[draw].position_offset, mesh_draws_[draw].normal_offset};
+		vkCmdBindVertexBuffers(command_buffer, 0, scene_quantized_ ? 1 : 2, vertex_buffers, offsets);
+		vkCmdBindIndexBuffer(command_buffer, index_buffer_, mesh_draws_[draw].index_offset, mesh_draws_[draw].index_type);
+		if (settings_.draw_data != draw_data_instanced)
+		{
+			record_instance_draws(command_buffer, mesh_draws_[draw].index_count, dynamic_offsets);
+			continue;
+		}
+		vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer_, indirect_slot_size_ * slot + sizeof(uint32_t) +
+		                         sizeof(VkDrawIndexedIndirectCommand) * draw, 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
+
+void vulkan_application::record_instance_draws(const VkCommandBuffer command_buffer, const uint32_t index_count,
+                                               const std::array<uint32_t, 4>& dynamic_offsets) const
+{
+	//the transforms of the visible instances are packed at the start of the slot, in the order they are drawn
+	const auto visible_count = static_cast<uint32_t>(visible_instances_.size());
+	auto instance_offsets = dynamic_offsets;
+	for (uint32_t instance = 0; instance < visible_count; instance++)
+	{
+		if (settings_.draw_data == draw_data_push_constants)
+		{
+			//the transform is recorded into the command buffer, nothing is read from memory to find it
+			vkCmdPushConstants(command_buffer, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4),
+			                   &instance_transforms_[instance]);
+			vkCmdDrawIndexed(command_buffer, index_count, 1, 0, 0, 0);
+		}
+		else if (settings_.draw_data == draw_data_dynamic_uniform)
+		{
+			//the descriptor set is bound again with the instance buffer's offset moved to the instance's transform
+			instance_offsets[1] = dynamic_offsets[1] + static_cast<uint32_t>(instance_stride_ * instance);
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1,
+			                        &descriptor_set_, static_cast<uint32_t>(instance_offsets.size()),
+			                        instance_offsets.data());
+			vkCmdDrawIndexed(command_buffer, index_count, 1, 0, 0, 0);
+		}
+		else
+		{
+			//the instance index starts at the first instance, so the shader indexes the storage buffer as before
+			vkCmdDrawIndexed(command_buffer, index_count, 1, 0, 0, instance);
+		}
+	}
+}
+
+void vulkan_application::benchmark_recording()
+{
+	//nothing may be executing while the command buffers are recorded again
+	vkDeviceWaitIdle(logical_device_);
+
+	std::vector<double> timings;
+	for (uint32_t run = 0; run < settings_.recording_runs; run++)
+	{
+		const auto start_time = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < swap_chain_framebuffers_.size(); i++)
+		{
+			if (settings_.dynamic_recording)
+			{
+				record_frame_command_buffer(i);
+			}
+			else
+			{
+				record_command_buffer(command_buffers_[i], i);
+			}
+		}
+		timings.push_back(frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now()));
+	}
 
-		//end the rennder pass
-		vkCmdEndRenderPass(command_buffers_[i]);
+	std::sort(timings.begin(), timings.end());
+	recording_ms_ = timings[timings.size() / 2];
+	std::cout << "recorded " << swap_chain_framebuffers_.size() << " command buffers in " << recording_ms_ << " ms as " <<
+		std::max<uint32_t>(settings_.recording_threads, 1) << " slices on " << jobs_.get_thread_count() <<
+		" threads, the median of " << settings_.recording_runs << " runs" << std::endl;
+}
 
-		//end command recording
-		if (vkEndCommandBuffer(command_buffers_[i]) != VK_SUCCESS)
+std::array<uint32_t, 4> vulkan_application::get_dynamic_offsets(const uint32_t slot) const
+{
+	return {
 		{
-			throw std::runtime_error("failed to record command buffer!");
+			static_cast<uint32_t>(uniform_slot_size_ * slot), static_cast<uint32_t>(instance_slot_size_ * slot),
+			static_cast<uint32_t>(visible_slot_size_ * slot), static_cast<uint32_t>(indirect_slot_size_ * slot)
 		}
+	};
+}
+
+std::array<VkDescriptorType, 5> vulkan_application::get_descriptor_types() const
+{
+	std::array<VkDescriptorType, 5> types = {};
+	std::copy(std::begin(descriptor_types), std::end(descriptor_types), types.begin());
+	if (settings_.draw_data == draw_data_dynamic_uniform)
+	{
+		types[1] = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	}
+	return types;
+}
+
+void vulkan_application::record_culling(const VkCommandBuffer command_buffer, const uint32_t slot,
+                                        const uint32_t* dynamic_offsets) const
+{
+	gpu_timer_.record_begin(command_buffer, slot, 1);
+	const auto indirect_offset = indirect_slot_size_ * slot;
+
+	//start the visible count at 0, the last frame to use this slot has finished reading it
+	vkCmdFillBuffer(command_buffer, indirect_buffer_, indirect_offset, sizeof(uint32_t), 0);
+	VkMemoryBarrier vk_memory_barrier = {};
+	vk_memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	vk_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vk_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+	                     &vk_memory_barrier, 0, nullptr, 0, nullptr);
+
+	//each invocation tests one instance and appends it to the visible list if any of it is inside the frustum
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, culling_pipeline_);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &descriptor_set_, 4,
+	                        dynamic_offsets);
+	const uint32_t workgroup_size = 64; //matches local_size_x in cull_instances.comp
+	vkCmdDispatch(command_buffer, (settings_.instance_count + workgroup_size - 1) / workgroup_size, 1, 1);
+
+	//every primitive draws the visible instances, so copy the count into the instance count of each draw command
+	vk_memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	vk_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1,
+	                     &vk_memory_barrier, 0, nullptr, 0, nullptr);
+	std::vector<VkBufferCopy> copies(mesh_draws_.size());
+	for (size_t i = 0; i < copies.size(); i++)
+	{
+		copies[i].srcOffset = indirect_offset;
+		copies[i].dstOffset = indirect_offset + sizeof(uint32_t) + sizeof(VkDrawIndexedIndirectCommand) * i +
+			offsetof(VkDrawIndexedIndirectCommand, instanceCount);
+		copies[i].size = sizeof(uint32_t);
 	}
+	vkCmdCopyBuffer(command_buffer, indirect_buffer_, indirect_buffer_, static_cast<uint32_t>(copies.size()),
+	                copies.data());
+
+	//the draws read the commands and the vertex shader reads the visible list
+	vk_memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	vk_memory_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1,
+	                     &vk_memory_barrier, 0, nullptr, 0, nullptr);
+
+	gpu_timer_.record_end(command_buffer, slot, 1);
 }
 
-void vulkan_application::create_semaphores()
+void vulkan_application::create_sync_objects()
 {
+	image_available_semaphores_.resize(settings_.max_frames_in_flight);
+	render_finished_semaphores_.resize(settings_.max_frames_in_flight);
+	in_flight_fences_.resize(settings_.max_frames_in_flight);
+	//no swapchain image is being rendered to yet
+	images_in_flight_.assign(swap_chain_images_.size(), VK_NULL_HANDLE);
+
 	VkSemaphoreCreateInfo vk_semaphore_create_info = {};
 	vk_semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	//create the semaphores
-	if (vkCreateSemaphore(logical_device_, &vk_semaphore_create_info, nullptr, &image_available_semaphore_) != VK_SUCCESS
-		||
-		vkCreateSemaphore(logical_device_, &vk_semaphore_create_info, nullptr, &render_finished_semaphore_) != VK_SUCCESS)
+	//create the fences in the signalled state, so the first wait on each frame slot returns immediately
+	VkFenceCreateInfo vk_fence_create_info = {};
+	vk_fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	vk_fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	//create the semaphores and fence for each frame in flight
+	for (size_t i = 0; i < settings_.max_frames_in_flight; i++)
 	{
-		throw std::runtime_error("failed to create semaphores!");
+		if (vkCreateSemaphore(logical_device_, &vk_semaphore_create_info, nullptr, &image_available_semaphores_[i]) !=
+			VK_SUCCESS ||
+			vkCreateSemaphore(logical_device_, &vk_semaphore_create_info, nullptr, &render_finished_semaphores_[i]) !=
+			VK_SUCCESS ||
+			vkCreateFence(logical_device_, &vk_fence_create_info, nullptr, &in_flight_fences_[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create synchronization objects for a frame!");
+		}
 	}
 }
 
-void vulkan_application::update_uniform_buffer() const
+glm::mat4 vulkan_application::update_uniform_buffer(const uint32_t slot) const
 {
 	//obtain a delta time value
 	static auto time_point = std::chrono::high_resolution_clock::now();
@@ -976,25 +2197,139 @@ void vulkan_application::update_uniform_buffer() const
 
 	//define the data to be sent to the GPU
 	uniform_buffer_object ubo = {};
-	ubo.model = rotate(glm::mat4(1.0F), time1 * glm::radians(90.0F), glm::vec3(0.0F, 0.0F, 1.0F));
-	ubo.view = lookAt(glm::vec3(2.0F, 2.0F, 2.0F), glm::vec3(0.0F, 0.0F, 0.0F), glm::vec3(0.0F, 0.0F, 1.0F));
-	ubo.proj = glm::perspective(glm::radians(45.0F),
-	                            swap_chain_extent_.width / static_cast<float>(swap_chain_extent_.height), 0.1F, 10.0F);
+	if (settings_.scene_path.empty())
+	{
+		ubo.model = rotate(glm::mat4(1.0F), time1 * glm::radians(90.0F), glm::vec3(0.0F, 0.0F, 1.0F));
+		ubo.view = lookAt(glm::vec3(2.0F, 2.0F, 2.0F), glm::vec3(0.0F, 0.0F, 0.0F), glm::vec3(0.0F, 0.0F, 1.0F));
+		ubo.proj = glm::perspective(glm::radians(45.0F),
+		                            swap_chain_extent_.width / static_cast<float>(swap_chain_extent_.height), 0.1F,
+		                            10.0F);
+	}
+	else
+	{
+		//glTF scenes are Y up, spin the grid of instances around its centre and keep the camera far enough away to see
+		//all of it. Each instance has already been moved to its place on the grid
+		const auto radius = scene_radius_ + instance_grid_radius_;
+		ubo.model = rotate(glm::mat4(1.0F), time1 * glm::radians(45.0F), glm::vec3(0.0F, 1.0F, 0.0F));
+		ubo.view = lookAt(glm::vec3(0.0F, radius, radius * 2.5F), glm::vec3(0.0F, 0.0F, 0.0F),
+		                  glm::vec3(0.0F, 1.0F, 0.0F));
+		ubo.proj = glm::perspective(glm::radians(45.0F),
+		                            swap_chain_extent_.width / static_cast<float>(swap_chain_extent_.height),
+		                            radius * 0.1F, radius * 10.0F);
+	}
 	ubo.proj[1][1] *= -1; //vulkan is Y up, so the projection needs to be flipped
+	ubo.position_scale = glm::vec4(scene_position_scale_, 0.0F);
+	ubo.position_bias = glm::vec4(scene_position_bias_, 0.0F);
+
+	//the compute pass culls the instances in the space of the grid, before the model matrix spins it
+	const auto clip_from_grid = ubo.proj * ubo.view * ubo.model;
+	const auto planes = frustum_culler::extract_planes(clip_from_grid);
+	std::copy(planes.begin(), planes.end(), ubo.frustum_planes);
+
+	//directly copy this new data to the slot in the uniform buffer on the GPU's memory, the allocator keeps
+	//host visible memory mapped so no map or unmap calls are needed
+	memcpy(static_cast<char*>(uniform_buffer_allocation_.mapped) + uniform_slot_size_ * slot, &ubo, sizeof(ubo));
+	return clip_from_grid;
+}
+
+void vulkan_application::update_instance_buffer(const uint32_t slot, const glm::mat4& clip_from_grid)
+{
+	static auto time_point = std::chrono::high_resolution_clock::now();
+	const auto current_time = std::chrono::high_resolution_clock::now();
+	const auto time1 = std::chrono::duration<float, std::chrono::seconds::period>(current_time - time_point).count();
+
+	//find the instances to draw, the list holds every instance when culling is off
+	if (settings_.cpu_culling && !mesh_draws_.empty())
+	{
+		const auto cull_start = std::chrono::high_resolution_clock::now();
+		instance_culler_.cull(clip_from_grid, culling_volume_sphere, visible_instances_, jobs_);
+		culling_total_ms_ += frame_statistics::elapsed_ms(cull_start, std::chrono::high_resolution_clock::now());
+		culling_visible_total_ += visible_instances_.size();
+		culling_frames_++;
+	}
+	else if (visible_instances_.size() != instance_placements_.size())
+	{
+		visible_instances_.resize(instance_placements_.size());
+		for (uint32_t i = 0; i < visible_instances_.size(); i++)
+		{
+			visible_instances_[i] = i;
+		}
+	}
+
+	//a single instance stays still, the whole scene already spins with the model matrix. The visible instances are
+	//packed at the start of the array, so the instance index of the draw picks them in turn. When culling on the GPU
+	//every instance is visible here, and the compute pass chooses the ones to draw
+	const auto spin = settings_.instance_count > 1 ? time1 * glm::radians(90.0F) : 0.0F;
+	const auto to_center = translate(glm::mat4(1.0F), -scene_center_);
+	const auto mapped_transforms = static_cast<char*>(instance_buffer_allocation_.mapped) + instance_slot_size_ * slot;
+	jobs_.parallel_for(0, visible_instances_.size(), 4096, [&](const size_t first, const size_t last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto& placement = instance_placements_[visible_instances_[i]];
+			instance_transforms_[i] = rotate(translate(glm::mat4(1.0F), glm::vec3(placement)), placement.w + spin,
+			                                 glm::vec3(0.0F, 1.0F, 0.0F)) * to_center;
+		}
 
-	//directly copy this new data to the location of the uniform buffer on the GPU's memory
-	void* data;
-	vkMapMemory(logical_device_, uniform_buffer_memory_, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(logical_device_, uniform_buffer_memory_);
+		//each range of transforms is written in one go, reading back from write combined memory would be slow. Spaced
+		//out transforms are still written in order
+		if (instance_stride_ == sizeof(glm::mat4))
+		{
+			memcpy(mapped_transforms + sizeof(glm::mat4) * first, &instance_transforms_[first],
+			       sizeof(glm::mat4) * (last - first));
+		}
+		else
+		{
+			for (auto i = first; i < last; i++)
+			{
+				memcpy(mapped_transforms + instance_stride_ * i, &instance_transforms_[i], sizeof(glm::mat4));
+			}
+		}
+	});
+
+	//every primitive draws the visible instances, the compute pass writes the instance counts when culling on the GPU
+	if (settings_.gpu_culling)
+	{
+		return;
+	}
+	std::vector<VkDrawIndexedIndirectCommand> commands(mesh_draws_.size());
+	for (size_t i = 0; i < mesh_draws_.size(); i++)
+	{
+		commands[i].indexCount = mesh_draws_[i].index_count;
+		commands[i].instanceCount = static_cast<uint32_t>(visible_instances_.size());
+		commands[i].firstIndex = 0;
+		commands[i].vertexOffset = 0;
+		commands[i].firstInstance = 0;
+	}
+	memcpy(static_cast<char*>(indirect_buffer_allocation_.mapped) + indirect_slot_size_ * slot + sizeof(uint32_t),
+	       commands.data(), sizeof(VkDrawIndexedIndirectCommand) * commands.size());
 }
 
 void vulkan_application::draw_frame()
 {
-	//Obtain the ID of the image to render to next
+	const auto acquire_start = std::chrono::high_resolution_clock::now();
+
+	//wait for the GPU to finish the frame that last used this frame slot, so its semaphores can be reused
+	vkWaitForFences(logical_device_, 1, &in_flight_fences_[current_frame_], VK_TRUE,
+	                std::numeric_limits<uint64_t>::max());
+
+	//the frames in flight when a swapchain was replaced have finished after every slot has been waited on once,
+	//and the frames drawn on the new swapchain after it has been waited on twice
+	destroy_retired_swap_chains(false);
+
+	//Obtain the ID of the image to render to next, offscreen images are simply used in turn
 	uint32_t image_index;
-	auto result = vkAcquireNextImageKHR(logical_device_, swap_chain_, std::numeric_limits<uint64_t>::max(),
-	                                    image_available_semaphore_, nullptr, &image_index);
+	auto result = VK_SUCCESS;
+	if (settings_.headless)
+	{
+		image_index = next_offscreen_image_;
+		next_offscreen_image_ = (next_offscreen_image_ + 1) % static_cast<uint32_t>(swap_chain_images_.size());
+	}
+	else
+	{
+		result = vkAcquireNextImageKHR(logical_device_, swap_chain_, std::numeric_limits<uint64_t>::max(),
+		                               image_available_semaphores_[current_frame_], nullptr, &image_index);
+	}
 
 	//if vulkan instead says that the swapchain is out of data (e.g. the window has been resized), then recreate the swap chain
 	if (result == VK_ERROR_OUT_OF_DATE_KHR)
@@ -1007,31 +2342,101 @@ void vulkan_application::draw_frame()
 		throw std::runtime_error("failed to acquire swap chain image!");
 	}
 
+	//the swapchain may return images out of order, so if an older frame is still rendering to this image wait for it
+	if (images_in_flight_[image_index] != VK_NULL_HANDLE)
+	{
+		vkWaitForFences(logical_device_, 1, &images_in_flight_[image_index], VK_TRUE,
+		                std::numeric_limits<uint64_t>::max());
+	}
+	//this image is now owned by the current frame slot
+	images_in_flight_[image_index] = in_flight_fences_[current_frame_];
+
+	//everything up to here has been waiting for the GPU or the presentation engine
+	const auto acquire_end = std::chrono::high_resolution_clock::now();
+	frame_timings_.acquire_wait_ms = frame_statistics::elapsed_ms(acquire_start, acquire_end);
+
+	//the GPU has finished the last frame that used this command buffer, so its timings are ready to read and its
+	//uniform slot can be written
+	gpu_timer_.collect(image_index);
+	update_instance_buffer(image_index, update_uniform_buffer(image_index));
+	frame_timings_.update_ms = frame_statistics::elapsed_ms(acquire_end, std::chrono::high_resolution_clock::now());
+
+	//hand any finished uploads over to the graphics queue ahead of this frame and reuse their staging space
+	staging_ring_.update();
+
+	//swap in the pipelines created in the background since the last frame. The pipeline being drawn with is kept
+	//until the variant of the current shader features is ready, which is requested the first time it is needed
+	const auto variant = request_graphics_variant(shader_features_);
+	pipeline_manager_.collect();
+	const auto pipeline = pipeline_manager_.get(variant, graphics_pipeline_);
+	if (pipeline != graphics_pipeline_)
+	{
+		//the command buffers recorded once still bind the old pipeline. Each is recorded again when its image comes
+		//up next, rather than waiting for the device here, as the GPU is done with it by then
+		graphics_pipeline_ = pipeline;
+		stale_command_buffers_.assign(stale_command_buffers_.size(), true);
+	}
+
+	//record the frame's command buffer now that its frame slot is free, or submit the one recorded for the image
+	VkCommandBuffer command_buffer;
+	if (settings_.dynamic_recording)
+	{
+		const auto record_start = std::chrono::high_resolution_clock::now();
+		command_buffer = record_frame_command_buffer(image_index);
+		frame_timings_.record_ms = frame_statistics::elapsed_ms(record_start, std::chrono::high_resolution_clock::now());
+	}
+	else
+	{
+		//the frame that last used this image has been waited on, so its command buffer can be recorded again
+		if (stale_command_buffers_[image_index])
+		{
+			const auto record_start = std::chrono::high_resolution_clock::now();
+			record_command_buffer(command_buffers_[image_index], image_index);
+			stale_command_buffers_[image_index] = false;
+			frame_timings_.record_ms = frame_statistics::elapsed_ms(record_start,
+			                                                        std::chrono::high_resolution_clock::now());
+		}
+		command_buffer = command_buffers_[image_index];
+	}
+
 	//define what will be submitted to the GPU graphics queue
 	VkSubmitInfo vk_submit_info = {};
 	vk_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	//wait for an image to be available
-	VkSemaphore wait_semaphores[] = {image_available_semaphore_};
+	//wait for an image to be available, offscreen images are available as soon as their last frame has finished
+	VkSemaphore wait_semaphores[] = {image_available_semaphores_[current_frame_]};
 	VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-	vk_submit_info.waitSemaphoreCount = 1;
+	vk_submit_info.waitSemaphoreCount = settings_.headless ? 0 : 1;
 	vk_submit_info.pWaitSemaphores = wait_semaphores;
 	vk_submit_info.pWaitDstStageMask = wait_stages;
 
 	//we will be submitting one command buffer to the GPU, this is the command buffer for each framebuffer (or image view)
 	vk_submit_info.commandBufferCount = 1;
-	vk_submit_info.pCommandBuffers = &command_buffers_[image_index];
+	vk_submit_info.pCommandBuffers = &command_buffer;
 
-	//wait for the render to be finished
-	VkSemaphore signal_semaphores[] = {render_finished_semaphore_};
-	vk_submit_info.signalSemaphoreCount = 1;
+	//wait for the render to be finished, nothing waits on it when headless
+	VkSemaphore signal_semaphores[] = {render_finished_semaphores_[current_frame_]};
+	vk_submit_info.signalSemaphoreCount = settings_.headless ? 0 : 1;
 	vk_submit_info.pSignalSemaphores = signal_semaphores;
 
-	//submit this to the graphics queue
-	if (vkQueueSubmit(graphics_queue_, 1, &vk_submit_info, nullptr) != VK_SUCCESS)
+	//only reset the fence once work is certain to be submitted, otherwise the next wait on this slot would deadlock
+	vkResetFences(logical_device_, 1, &in_flight_fences_[current_frame_]);
+
+	//submit this to the graphics queue, the fence is signalled once the GPU has executed the command buffer
+	const auto submit_start = std::chrono::high_resolution_clock::now();
+	if (vkQueueSubmit(graphics_queue_, 1, &vk_submit_info, in_flight_fences_[current_frame_]) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
+	frame_timings_.submit_ms = frame_statistics::elapsed_ms(submit_start, std::chrono::high_resolution_clock::now());
+	gpu_timer_.submitted(image_index);
+
+	//there is nothing to present to when headless, so the frame is finished once it has been submitted
+	if (settings_.headless)
+	{
+		current_frame_ = (current_frame_ + 1) % settings_.max_frames_in_flight;
+		return;
+	}
 
 	//define what will be submitted to the GPU present queue
 	VkPresentInfoKHR vk_present_info_khr = {};
@@ -1048,7 +2453,9 @@ void vulkan_application::draw_frame()
 	//the id of the image
 	vk_present_info_khr.pImageIndices = &image_index;
 	//submit this to the present queue (display the image)
+	const auto present_start = std::chrono::high_resolution_clock::now();
 	result = vkQueuePresentKHR(present_queue_, &vk_present_info_khr);
+	frame_timings_.present_ms = frame_statistics::elapsed_ms(present_start, std::chrono::high_resolution_clock::now());
 
 	//if vulkan instead says that the swapchain is out of data (e.g. the window has been resized), then recreate the swap chain
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
@@ -1061,17 +2468,16 @@ void vulkan_application::draw_frame()
 		throw std::runtime_error("failed to present swap chain image!");
 	}
 
-	//wait for the present queue to be idle (presentation is finished), before rendering another frame
-	vkQueueWaitIdle(present_queue_);
+	//move on to the next frame slot, the CPU only blocks once all slots are waiting on the GPU
+	current_frame_ = (current_frame_ + 1) % settings_.max_frames_in_flight;
 }
 
-VkShaderModule vulkan_application::create_shader_module(const std::vector<char>& code) const
+VkShaderModule vulkan_application::create_shader_module(const std::vector<uint32_t>& code) const
 {
 	VkShaderModuleCreateInfo vk_shader_module_create_info = {};
 	vk_shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	vk_shader_module_create_info.codeSize = code.size();
-	vk_shader_module_create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
-	//convert from char to integer data
+	vk_shader_module_create_info.codeSize = code.size() * sizeof(uint32_t); //the size is in bytes
+	vk_shader_module_create_info.pCode = code.data();
 
 	VkShaderModule vk_shader_module;
 	if (vkCreateShaderModule(logical_device_, &vk_shader_module_create_info, nullptr, &vk_shader_module) != VK_SUCCESS)
@@ -1190,6 +2596,12 @@ bool vulkan_application::is_device_suitable(const VkPhysicalDevice device) const
 {
 	auto indices = find_queue_families(device);
 
+	//when headless only a graphics queue is needed, software rasterizers such as lavapipe are fine
+	if (settings_.headless)
+	{
+		return indices.is_complete();
+	}
+
 	//are the device extensions we want supported?
 	const auto extensions_supported = check_device_extension_support(device);
 
@@ -1253,9 +2665,13 @@ queue_family_indices vulkan_application::find_queue_families(const VkPhysicalDev
 		}
 
 		//check that the device supports presentation, some vulkan devices might not support present
-		//for example a CPU or compute hardware
-		VkBool32 present_support = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, vulkan_surface_, &present_support);
+		//for example a CPU or compute hardware. When headless there is no surface and nothing is presented,
+		//so any family will do
+		VkBool32 present_support = settings_.headless;
+		if (!settings_.headless)
+		{
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, vulkan_surface_, &present_support);
+		}
 
 		//if the number of queues in the queue family is greater than 0 and the device supports presentation
 		//then we have also found our presentation queue 
@@ -1273,11 +2689,36 @@ queue_family_indices vulkan_application::find_queue_families(const VkPhysicalDev
 		i++;
 	}
 
+	//look for a family dedicated to transfers, which is usually backed by the DMA engines. Prefer one without
+	//compute, then one without graphics. Every graphics family can transfer, so otherwise uploads stay on it
+	auto best_score = 0;
+	for (uint32_t family = 0; family < queue_family_count; family++)
+	{
+		const auto flags = queue_families[family].queueFlags;
+		if (queue_families[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || flags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			continue;
+		}
+
+		const auto score = flags & VK_QUEUE_COMPUTE_BIT ? 1 : 2;
+		if (score > best_score)
+		{
+			indices.transfer_family = static_cast<int>(family);
+			best_score = score;
+		}
+	}
+
 	return indices;
 }
 
 std::vector<const char*> vulkan_application::get_required_extensions() const
 {
+	//without a window no surface extensions are needed
+	if (settings_.headless)
+	{
+		return std::vector<const char*>();
+	}
+
 	//obtain the number of extensions required
 	uint32_t sdl_extension_count = 0;
 	SDL_Vulkan_GetInstanceExtensions(sdl_window_, &sdl_extension_count, nullptr);
@@ -1322,23 +2763,3 @@ bool vulkan_application::check_validation_layer_support()
 
 	return true;
 }
-
-std::vector<char> vulkan_application::read_file(const std::string& filename)
-{
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open())
-	{
-		throw std::runtime_error("failed to open file!");
-	}
-
-	const auto file_size = static_cast<size_t>(file.tellg());
-	std::vector<char> buffer(file_size);
-
-	file.seekg(0);
-	file.read(buffer.data(), file_size);
-
-	file.close();
-
-	return buffer;
-}
@@ -26,9 +26,25 @@
 #ifndef TRIANGLE_H
 #define TRIANGLE_H
 
-//Include Vulkan, tell vulkan this is the Win32 platform
+//Include Vulkan, tell vulkan this is the Win32 platform when building for windows
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #include <vulkan/vulkan.h>
+#include "vulkan_memory_allocator.h"
+#include "vulkan_staging_ring.h"
+#include "vulkan_gpu_timer.h"
+#include "frame_statistics.h"
+#include "vulkan_pipeline_cache.h"
+#include "gltf_model.h"
+#include "baked_mesh.h"
+#include "vertex_layout.h"
+#include "frustum_culler.h"
+#include "vulkan_parallel_recorder.h"
+#include "job_system.h"
+#include "shader_compiler.h"
+#include "vulkan_pipeline_manager.h"
+#include "shader_variants.h"
 
 //Include SDL2 and the SDL Vulkan library
 #include <SDL.h>
@@ -42,6 +58,8 @@
 #include <chrono>
 #include <vector>
 #include <array>
+#include <utility>
+#include <unordered_map>
 
 /**
 * \brief Define which validation layers to load
@@ -58,7 +76,8 @@ const std::vector<const char*> device_extensions = {
 };
 
 /**
-* \brief A structure that holds the graphics family index and present family index
+* \brief A structure that holds the graphics family index, present family index and the
+* family used for uploads
 */
 struct queue_family_indices
 {
@@ -66,6 +85,8 @@ public:
 	//set to -1 because there can be a queue family with an index of 0
 	int graphics_family = -1;
 	int present_family = -1;
+	//a family that only supports transfers, -1 if the device does not have one
+	int transfer_family = -1;
 
 	bool is_complete() const
 	{
@@ -84,6 +105,52 @@ struct swap_chain_support_details
 	std::vector<VkPresentModeKHR> present_modes;
 };
 
+/**
+* \brief How the draws of a scene are given the transforms of their instances
+*/
+enum draw_data_path
+{
+	draw_data_instanced, //an indirect draw per primitive for every visible instance, indexing the storage buffer
+	draw_data_push_constants, //a draw per visible instance with its transform in push constants
+	draw_data_dynamic_uniform, //a draw per visible instance with its transform at a dynamic offset in a uniform buffer
+	draw_data_storage_index //a draw per visible instance whose first instance indexes the storage buffer
+};
+
+/**
+* \brief How a graphics pipeline is created, beyond its shaders and features
+*/
+struct graphics_pipeline_options
+{
+	VkPipelineCreateFlags flags = 0; //allow derivatives or create a derivative
+	VkPipeline base_pipeline = VK_NULL_HANDLE; //the parent of a derivative
+};
+
+/**
+* \brief The time taken to create one variant of the graphics pipeline in each way, without a pipeline cache. The
+* driver's own cache of compiled shaders is not turned off, so only the first creation can include the compile
+*/
+struct pipeline_variant_timing
+{
+	uint32_t features; //the shader_feature mask of the variant
+	double full_first_ms; //the first creation on its own, the only one the driver's cache can have missed
+	double full_ms; //created on its own, the median with the driver's cache warm
+	double derivative_ms; //created as a derivative of the first variant, the median with the driver's cache warm
+};
+
+/**
+* \brief The times taken to create every variant of the graphics pipeline
+*/
+struct pipeline_variant_report
+{
+	double base_ms = 0.0; //creating the first variant, the parent of the derivatives
+	std::vector<pipeline_variant_timing> variants;
+};
+
+/**
+* \brief The layout of the quad's vertices, a float2 position then a float3 colour
+*/
+typedef vertex_layout<vertex_attribute_float2, vertex_attribute_float3> quad_vertex_layout;
+
 /**
 * \brief A structure that defines the layout of a Vertex and it's associated data
 */
@@ -98,41 +165,37 @@ struct vertex
 	*/
 	static VkVertexInputBindingDescription getBindingDescription()
 	{
-		VkVertexInputBindingDescription binding_description = {};
-		binding_description.binding = 0;
-		binding_description.stride = sizeof(vertex); //the memory size of this struct
-		binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; //tell vulkan this is a vertex input
-
-		return binding_description;
+		return quad_vertex_layout::get_binding_description();
 	}
 
 	/**
-	* \brief Obtain a description of the attributes for a vertex
+	* \brief Obtain a description of the attributes for a vertex, the position at location 0 and the colour at
+	* location 1
 	* \return std array containing 2 attribute descriptions
 	*/
 	static std::array<VkVertexInputAttributeDescription, 2> get_attribute_descriptions()
 	{
-		//initialise the array
-		std::array<VkVertexInputAttributeDescription, 2> attribute_descriptions = {};
-
-		//2 float array at location 0 with an offset of the first element in the struct
-		//glm::vec2
-		attribute_descriptions[0].binding = 0;
-		attribute_descriptions[0].location = 0;
-		attribute_descriptions[0].format = VK_FORMAT_R32G32_SFLOAT; //2 floats
-		attribute_descriptions[0].offset = offsetof(vertex, pos);
-
-		//3 float array at location 1 with an offset of the second element in the struct
-		//glm::vec3
-		attribute_descriptions[1].binding = 0;
-		attribute_descriptions[1].location = 1;
-		attribute_descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT; //3 floats
-		attribute_descriptions[1].offset = offsetof(vertex, color);
-
-		return attribute_descriptions;
+		return quad_vertex_layout::get_attribute_descriptions();
 	}
 };
 
+//the struct is filled in by hand, so make sure it matches the layout the pipeline is given
+static_assert(sizeof(vertex) == quad_vertex_layout::get_stride() &&
+              offsetof(vertex, color) == quad_vertex_layout::get_offset(1), "vertex does not match its layout");
+
+/**
+* \brief The ranges of the vertex and index buffers drawn by one primitive of a scene. The positions and normals
+* are kept in separate streams, as they are laid out in the scene file
+*/
+struct mesh_draw
+{
+	VkDeviceSize position_offset; //the offset of the first position in the vertex buffer
+	VkDeviceSize normal_offset; //the offset of the first normal in the vertex buffer
+	VkDeviceSize index_offset; //the offset of the first index in the index buffer
+	VkIndexType index_type;
+	uint32_t index_count;
+};
+
 /**
 * \brief A structure to hold the data to be sent to the shader
 */
@@ -141,6 +204,9 @@ struct uniform_buffer_object
 	glm::mat4 model; //Model matrix (Model Transform)
 	glm::mat4 view; //View Matrix (Camera)
 	glm::mat4 proj; //Proj Matrix (Perspective)
+	glm::vec4 position_scale; //Quantized positions are multiplied by this
+	glm::vec4 position_bias; //then offset by this
+	glm::vec4 frustum_planes[6]; //the planes the instances are culled against on the GPU, in the space of the grid
 };
 
 /**
@@ -161,16 +227,103 @@ const std::vector<uint16_t> indices = {
 	0, 1, 2, 2, 3, 0
 };
 
+/**
+* \brief Runtime options for the application, filled in from the command line
+*/
+struct application_settings
+{
+	//the number of frames the CPU may record and submit before waiting on the GPU
+	uint32_t max_frames_in_flight = 2;
+	//upload on a dedicated transfer queue when the device has one
+	bool use_transfer_queue = true;
+	//render into offscreen images without a window, surface or swapchain
+	bool headless = false;
+	//the number of frames to render before exiting, 0 runs until the window is closed
+	uint32_t frame_count = 0;
+	//the frame timings are written to this path with .csv and .json appended, nothing is written if empty
+	std::string statistics_path;
+	//the file the pipeline cache is loaded from and saved to, the cache is kept in memory only if empty
+	std::string pipeline_cache_path = "pipeline_cache.bin";
+	//the directory the SPIR-V of the compiled shaders is kept in between runs, shaders are compiled every run if empty
+	std::string shader_cache_path = "shader_cache";
+	//the number of background threads that create pipelines, the fallback is drawn until they are ready. 0 creates
+	//them on the render thread, which stalls until they are done
+	uint32_t pipeline_threads = 1;
+	//the shader_feature mask of the variant drawn at startup, toggled with the L, F and N keys
+	uint32_t shader_features = default_shader_features;
+	//the glTF or baked scene to draw, the quad is drawn if empty
+	std::string scene_path;
+	//the number of copies of the scene to draw with one instanced draw per primitive, laid out on a grid
+	uint32_t instance_count = 1;
+	//skip the instances outside the view frustum on the CPU, only the visible instances are drawn
+	bool cpu_culling = true;
+	//cull the instances in a compute pass instead, which also writes the draw commands
+	bool gpu_culling = false;
+	//the number of threads of the job system that culls, updates the transforms and records, including the main
+	//thread. 0 uses every hardware thread
+	uint32_t worker_threads = 0;
+	//the number of slices the draws are split into, each recorded into a secondary command buffer by the job system,
+	//0 records them into the primary command buffers on the main thread
+	uint32_t recording_threads = 0;
+	//record the command buffers this many more times after startup and keep the median time, for benchmarking
+	uint32_t recording_runs = 0;
+	//record the command buffer of each frame as it is drawn, from a pool per frame in flight that is reset each time,
+	//instead of recording a command buffer per swapchain image once and submitting it again every frame
+	bool dynamic_recording = false;
+	//create every variant of the graphics pipeline this many times after startup without a pipeline cache, on its
+	//own and as a derivative, keeping the first and the median times, for benchmarking
+	uint32_t variant_runs = 0;
+	//how the draws are given their instance transforms, the view and projection stay in the uniform buffer of the
+	//frame. Every path but instanced draws each visible instance on its own, so it records every frame
+	draw_data_path draw_data = draw_data_instanced;
+};
+
 /**
 * \brief The main application class
 */
 class vulkan_application
 {
 public:
+	/**
+	* \brief Create the application
+	* \param settings the runtime options to use
+	*/
+	explicit vulkan_application(const application_settings& settings = application_settings());
+
 	/**
 	* \brief The method to be called to run the application
 	*/
 	void run();
+
+	/**
+	* \brief Obtain a summary of the CPU frame times, valid once run has returned
+	* \return the summary
+	*/
+	frame_summary get_frame_summary() const;
+
+	/**
+	* \brief Obtain a summary of the GPU render pass times, valid once run has returned
+	* \return the summary, with no samples if the device does not support timestamps
+	*/
+	gpu_timing_summary get_render_pass_summary() const;
+
+	/**
+	* \brief Obtain the median time taken to record every command buffer, valid once run has returned
+	* \return the time in milliseconds, 0 if the recording runs setting was 0
+	*/
+	double get_recording_ms() const;
+
+	/**
+	* \brief Obtain the times taken to create the variants of the graphics pipeline, valid once run has returned
+	* \return the report, with no variants if the variant runs setting was 0
+	*/
+	const pipeline_variant_report& get_variant_report() const;
+
+	/**
+	* \brief Obtain the number of primitives of the scene, each drawn once per visible instance
+	* \return the number of primitives, 0 when drawing the quad
+	*/
+	size_t get_primitive_count() const;
 protected:
 	/**
 	* \brief Define the height and width of the window
@@ -178,6 +331,8 @@ protected:
 	int width_ = 800;
 	int height_ = 600;
 private:
+	application_settings settings_; //the runtime options
+
 	SDL_Window* sdl_window_; // A pointer to the SDL window
 
 	VkInstance vulkan_instance_; //Vulkan Instance
@@ -188,43 +343,118 @@ private:
 	VkPhysicalDevice physical_device_ = nullptr;
 	VkDevice logical_device_;
 
+	//Sub-allocates the memory of every buffer
+	vulkan_memory_allocator memory_allocator_;
+
 	//Device Queues
 	VkQueue graphics_queue_;
 	VkQueue present_queue_;
+	VkQueue transfer_queue_ = VK_NULL_HANDLE;
 
 	//Swap Chain
-	VkSwapchainKHR swap_chain_;
+	VkSwapchainKHR swap_chain_ = VK_NULL_HANDLE;
 	std::vector<VkImage> swap_chain_images_;
 	VkFormat swap_chain_image_format_;
 	VkExtent2D swap_chain_extent_;
 	std::vector<VkImageView> swap_chain_image_views_;
 	std::vector<VkFramebuffer> swap_chain_framebuffers_;
+	std::vector<std::pair<VkSwapchainKHR, uint32_t>> retired_swap_chains_; //replaced swapchains and the frames left
+	std::vector<memory_allocation> offscreen_image_allocations_; //the memory of the images rendered to when headless
+	uint32_t next_offscreen_image_ = 0; //the offscreen image the next frame renders to
+	bool validation_layers_enabled_ = false; //false if the validation layers are not installed
 
 	//Graphics Pipeline
+	vulkan_pipeline_cache pipeline_cache_; //shared by every pipeline, and kept on disk between runs
+	shader_compiler shader_compiler_; //compiles the GLSL shaders, and keeps the SPIR-V on disk between runs
 	VkRenderPass render_pass_;
 	VkDescriptorSetLayout descriptor_set_layout_;
 	VkPipelineLayout pipeline_layout_;
-	VkPipeline graphics_pipeline_;
+	vulkan_pipeline_manager pipeline_manager_; //creates the graphics pipelines in the background
+	std::unordered_map<uint32_t, uint32_t> graphics_variants_; //the pipeline manager id of each variant, by features
+	uint32_t base_variant_ = 0; //the id of the first variant, the parent the others are derived from
+	uint32_t shader_features_; //the shader_feature mask of the variant to draw with
+	VkPipeline graphics_pipeline_ = VK_NULL_HANDLE; //the pipeline the draws bind, owned by the manager or the fallback
+	VkPipeline fallback_pipeline_ = VK_NULL_HANDLE; //drawn with until the first graphics pipeline is ready
+	VkPipeline culling_pipeline_ = VK_NULL_HANDLE; //the compute pipeline that culls the instances on the GPU
+	pipeline_variant_report variant_report_; //the times taken to create the variants, when benchmarking
+
+	//Runs the culling, the transform updates and the recording on several threads
+	job_system jobs_;
 
 	//Commands
 	VkCommandPool command_pool_;
-	std::vector<VkCommandBuffer> command_buffers_;
+	std::vector<VkCommandBuffer> command_buffers_; //recorded once, empty when recording every frame
+	std::vector<bool> stale_command_buffers_; //the command buffers to record again before their image is drawn
+	std::vector<VkCommandPool> frame_command_pools_; //a transient pool per frame in flight, when recording every frame
+	std::vector<VkCommandBuffer> frame_command_buffers_; //the command buffer of each frame in flight
+	vulkan_parallel_recorder recorder_; //records slices of the draws on the job system, when there are slices
+	std::vector<VkCommandBuffer> secondary_command_buffers_; //the secondary command buffers a primary executes
+	double recording_ms_ = 0.0; //the median time to record every command buffer
+
+	//Times the passes recorded in the command buffers, one query slot per command buffer
+	vulkan_gpu_timer gpu_timer_;
+
+	//Records the CPU timings of every frame
+	frame_statistics frame_statistics_;
+	frame_record frame_timings_; //the timings of the frame being drawn
+
+	//Batches the uploads of vertex, index and texture data
+	vulkan_staging_ring staging_ring_;
+
+	//The scene, its buffers stay mapped only until they have been copied into the staging ring
+	gltf_model scene_;
+	baked_mesh baked_scene_; //used instead of scene_ when the scene is a baked file
+	uint32_t scene_position_stride_ = 0;
+	uint32_t scene_normal_stride_ = 0;
+	bool scene_quantized_ = false; //the scene is a baked file with quantized_mesh_layout vertices
+	glm::vec3 scene_position_scale_ = glm::vec3(1.0F); //how quantized positions are scaled back to the scene
+	glm::vec3 scene_position_bias_ = glm::vec3(0.0F);
+	glm::vec3 scene_center_ = glm::vec3(0.0F); //the centre of the box around the scene
+	float scene_radius_ = 1.0F; //the distance from the centre to the corners of the box
 
 	//Buffers
 	VkBuffer vertex_buffer_;
-	VkDeviceMemory vertex_buffer_memory_;
+	memory_allocation vertex_buffer_allocation_;
 	VkBuffer index_buffer_;
-	VkDeviceMemory index_buffer_memory_;
+	memory_allocation index_buffer_allocation_;
 	VkBuffer uniform_buffer_;
-	VkDeviceMemory uniform_buffer_memory_;
+	memory_allocation uniform_buffer_allocation_;
+	std::vector<mesh_draw> mesh_draws_; //one per primitive of the scene, empty when the quad is drawn
+	VkDeviceSize uniform_slot_size_ = 0; //the size of each command buffer's uniform data, aligned for dynamic offsets
+	uint32_t uniform_slot_count_ = 0; //the number of slots in the uniform buffer
+	VkBuffer instance_buffer_;
+	memory_allocation instance_buffer_allocation_;
+	VkDeviceSize instance_slot_size_ = 0; //the size of each command buffer's instance transforms, aligned for dynamic offsets
+	VkDeviceSize instance_stride_ = sizeof(glm::mat4); //the distance between transforms, aligned for uniform offsets
+	std::vector<glm::vec4> instance_placements_; //the centre of each instance on the grid, and the angle it starts at
+	std::vector<glm::mat4> instance_transforms_; //the transform of each instance, updated every frame
+	float instance_grid_radius_ = 0.0F; //the distance from the centre of the grid to the centre of the furthest instance
+	VkBuffer visible_buffer_;
+	memory_allocation visible_buffer_allocation_;
+	VkDeviceSize visible_slot_size_ = 0; //the size of each command buffer's list of visible instances
+	VkBuffer indirect_buffer_;
+	memory_allocation indirect_buffer_allocation_;
+	VkDeviceSize indirect_slot_size_ = 0; //the size of each command buffer's visible count and draw commands
+	VkBuffer bounds_buffer_; //the sphere around each instance, read by the compute pass
+	memory_allocation bounds_buffer_allocation_;
+
+	//Culling, the instances are spheres around their centres on the grid so they can spin
+	frustum_culler instance_culler_;
+	std::vector<uint32_t> visible_instances_; //the instances drawn this frame
+	uint64_t culling_frames_ = 0; //the frames that were culled, and the totals over those frames
+	uint64_t culling_visible_total_ = 0;
+	double culling_total_ms_ = 0.0;
 
 	//Descriptor Sets
 	VkDescriptorPool descriptor_pool_;
 	VkDescriptorSet descriptor_set_;
 
-	//Synchronization
-	VkSemaphore image_available_semaphore_;
-	VkSemaphore render_finished_semaphore_;
+	//Synchronization, one semaphore pair and fence per frame in flight
+	std::vector<VkSemaphore> image_available_semaphores_;
+	std::vector<VkSemaphore> render_finished_semaphores_;
+	std::vector<VkFence> in_flight_fences_;
+	std::vector<VkFence> images_in_flight_; //the fence of the frame currently using each swapchain image
+	size_t current_frame_ = 0; //the frame in flight slot that is being recorded
 
 
 	/**
@@ -244,10 +474,17 @@ private:
 	void main_loop();
 
 	/**
-	* \brief Destroy the various vulkan elements associated with the swap chain
+	* \brief Destroy the various vulkan elements associated with the swap chain images, the swap chain itself
+	* is kept so it can be passed to its replacement
 	*/
 	void cleanup_swap_chain();
 
+	/**
+	* \brief Destroy the graphics pipelines and the render pass, which only need to be recreated if the
+	* swap chain format changes
+	*/
+	void cleanup_pipeline();
+
 
 	/**
 	* \brief Called when the program is quitting, destroys all vulkan elements and
@@ -257,10 +494,16 @@ private:
 
 
 	/**
-	* \brief Called on window resizing,
+	* \brief Called on window resizing, recreates the swap chain and the framebuffers and command buffers that use it
 	*/
 	void recreate_swap_chain();
 
+	/**
+	* \brief Count down the frames each replaced swapchain is kept for, destroying it once its presents are done
+	* \param destroy_all destroy every replaced swapchain now, the device must be idle
+	*/
+	void destroy_retired_swap_chains(bool destroy_all);
+
 
 	/**
 	* \brief Create a Vulkan Instance
@@ -283,12 +526,39 @@ private:
 	void create_logical_device();
 
 
+	/**
+	* \brief Prepare the memory allocator, which all buffer memory is sub-allocated from
+	*/
+	void create_memory_allocator();
+
+	/**
+	* \brief Create the pipeline cache, filled with the pipelines compiled by previous runs
+	*/
+	void create_pipeline_cache();
+
+	/**
+	* \brief Create the shader compiler, which reads the shaders compiled by previous runs from the shader cache
+	*/
+	void create_shader_compiler();
+
+	/**
+	* \brief Parse the scene and map its buffers, or map the baked file. The vertex layout of the pipeline
+	* depends on the scene
+	*/
+	void load_scene();
+
 	/**
 	* \brief Create the swap chain
 	*/
 	void create_swap_chain();
 
 
+	/**
+	* \brief Create the images to render to when headless. They stand in for the swapchain images,
+	* so the image views, framebuffers and command buffers are created in the same way
+	*/
+	void create_offscreen_images();
+
 	/**
 	* \brief Create views for the associated images
 	*/
@@ -300,26 +570,76 @@ private:
 	void create_render_pass();
 
 	/**
-	* \brief Define the descriptor set layout, which is used to send the uniform buffer to the GPU
+	* \brief Define the descriptor set layout, which is used to send the uniform and instance buffers to the GPU
 	*/
 	void create_descriptor_set_layout();
 
 	/**
-	* \brief Create a graphics pipeline which will be used to render.
+	* \brief Create the pipeline layout and request the graphics pipeline of the current shader features, creating the
+	* fallback first if the pipeline is created in the background.
 	* The graphics pipeline we will create will be similar to the pipeline in OpenGL
 	*/
 	void create_graphics_pipeline();
 
+	/**
+	* \brief Choose the vertex and fragment shaders the graphics pipelines are created from
+	* \return the vertex shader then the fragment shader
+	*/
+	std::vector<shader_request> get_graphics_shaders() const;
+
+	/**
+	* \brief Request the graphics pipeline of a set of shader features, if it has not been requested already
+	* \param features the mask of shader_feature
+	* \return the id of the pipeline in the pipeline manager
+	*/
+	uint32_t request_graphics_variant(uint32_t features);
+
+	/**
+	* \brief Create a graphics pipeline with the application's layout and render pass, safe to call from any thread
+	* \param cache the pipeline cache to create it with
+	* \param vert_shader_code the SPIR-V of the vertex shader
+	* \param frag_shader_code the SPIR-V of the fragment shader
+	* \param features the mask of shader_feature the vertex shader is specialized with
+	* \param options the flags and parent of the pipeline
+	* \return the pipeline
+	*/
+	VkPipeline build_graphics_pipeline(VkPipelineCache cache, const std::vector<uint32_t>& vert_shader_code,
+	                                   const std::vector<uint32_t>& frag_shader_code, uint32_t features,
+	                                   const graphics_pipeline_options& options = graphics_pipeline_options()) const;
+
+	/**
+	* \brief Create every variant of the graphics pipeline several times in each way, keeping the first and the median
+	* times. The GPU is idle while this runs
+	*/
+	void benchmark_pipeline_variants();
+
+	/**
+	* \brief Create the compute pipeline that culls the instances, when culling on the GPU. It shares the graphics
+	* pipeline's layout, so it is created and destroyed with the graphics pipeline
+	*/
+	void create_culling_pipeline();
+
 	/**
 	* \brief Obtain the framebuffers from the device, used for drawing
 	*/
 	void create_framebuffers();
 
 	/**
-	* \brief Obtain the command pool, which will be used to contain commands
+	* \brief Obtain the command pool, which will be used to contain commands. When recording every frame a transient
+	* pool and a command buffer are created for each frame in flight instead
 	*/
 	void create_command_pool();
 
+	/**
+	* \brief Prepare the GPU timer, which measures the passes recorded in the command buffers
+	*/
+	void create_gpu_timer();
+
+	/**
+	* \brief Create the staging ring, which is used to upload data to device local buffers and images
+	*/
+	void create_staging_ring();
+
 	/**
 	* \brief Create the vertex buffer, this is where the data of the vertices to draw will be held in the GPU memory
 	*/
@@ -331,13 +651,29 @@ private:
 	void create_index_buffer();
 
 	/**
-	* \brief Create the uniform buffer, this is where the data will be held in GPU memory to be used by the vertex shader
+	* \brief Create the vertex and index buffers of the scene. The data is copied into the staging ring straight
+	* from the mapped scene buffers, which are unmapped afterwards. A baked file is copied with one upload per buffer
+	*/
+	void create_scene_buffers();
+
+	/**
+	* \brief Create the uniform buffer, this is where the data will be held in GPU memory to be used by the vertex shader.
+	* The buffer holds a slot for each swapchain image, so a frame never writes to data the GPU may still be reading
 	* NOTE: a staging buffer is not used here because this will be constantly updated by the CPU
 	*/
 	void create_uniform_buffer();
 
 	/**
-	* \brief Create a descriptor pool, which will be used by the uniform buffer.
+	* \brief Create the instance buffer, a storage buffer the vertex shader reads the transform of each instance from,
+	* the visible buffer that lists the instances to draw and the indirect buffer that holds the draw command of each
+	* primitive. Like the uniform buffer they hold a slot for each swapchain image, so the number of instances drawn
+	* can change without recording the command buffers again. The CPU writes every buffer each frame, unless the
+	* instances are culled on the GPU, in which case the compute pass writes the visible and indirect buffers
+	*/
+	void create_instance_buffer();
+
+	/**
+	* \brief Create a descriptor pool, which will be used by the uniform and instance buffers.
 	*/
 	void create_descriptor_pool();
 
@@ -346,24 +682,28 @@ private:
 	*/
 	void create_descriptor_set();
 
+	/**
+	* \brief Point the descriptor set at the uniform and instance buffers, the slots are chosen by the dynamic offsets
+	*/
+	void write_descriptor_set() const;
+
 	/**
 	* \brief Create a buffer on the GPU
 	* \param size the size of the buffer data
 	* \param usage the usage of the buffer
 	* \param properties the memroy properties
 	* \param buffer the buffer
-	* \param buffer_memory the buffer's memory
+	* \param buffer_allocation the range of device memory bound to the buffer
 	*/
 	void create_buffer(const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties,
-	                   VkBuffer& buffer, VkDeviceMemory& buffer_memory) const;
+	                   VkBuffer& buffer, memory_allocation& buffer_allocation);
 
 	/**
-	* \brief Copy from one GPU buffer to another
-	* \param src_buffer the buffer to copy from
-	* \param dst_buffer the buffer to copy to
-	* \param size the size of the buffer data
+	* \brief Destroy a buffer and return its memory to the allocator
+	* \param buffer the buffer
+	* \param buffer_allocation the range of device memory bound to the buffer
 	*/
-	void copy_buffer(const VkBuffer src_buffer, const VkBuffer dst_buffer, const VkDeviceSize size) const;
+	void destroy_buffer(VkBuffer& buffer, memory_allocation& buffer_allocation);
 
 
 	/**
@@ -380,15 +720,92 @@ private:
 	void create_command_buffers();
 
 	/**
-	* \brief Create synchronization semaphores, one will be used to signal when an image is available for rendering to
-	* the other will be used to signal when that rendering is finished
+	* \brief Record a command buffer, which culls the instances on the GPU if requested and draws the scene. The draws
+	* are recorded into secondary command buffers when there are recording threads
+	* \param command_buffer the primary command buffer to record, which has been reset
+	* \param slot the index of the swapchain image, which chooses the framebuffer and the slots of the buffers
+	*/
+	void record_command_buffer(const VkCommandBuffer command_buffer, const uint32_t slot);
+
+	/**
+	* \brief Reset the pool of the current frame in flight and record its command buffer, when recording every frame.
+	* The GPU must have finished the frame that last used the frame slot
+	* \param image_index the index of the swapchain image the frame renders to
+	* \return the command buffer to submit
+	*/
+	VkCommandBuffer record_frame_command_buffer(const uint32_t image_index);
+
+	/**
+	* \brief Record some of the draws of the scene, or the quad, inside the render pass. The pipeline, dynamic state
+	* and descriptor set are set first, as a secondary command buffer does not inherit them
+	* \param command_buffer the command buffer to record into
+	* \param slot the index of the primary command buffer, which chooses the slots of the buffers
+	* \param first_draw the first primitive of the scene to draw
+	* \param last_draw one past the last primitive to draw, the quad is drawn if the scene has no primitives
+	*/
+	void record_draws(const VkCommandBuffer command_buffer, const uint32_t slot, const size_t first_draw,
+	                  const size_t last_draw) const;
+
+	/**
+	* \brief Record the command buffers again several times, keeping the median time. The GPU is idle while this runs
+	*/
+	void benchmark_recording();
+
+	/**
+	* \brief Obtain the offsets of a command buffer's slots, which are given when the descriptor set is bound
+	* \param slot the index of the command buffer
+	* \return the offsets of the slots of the uniform, instance, visible and indirect buffers
+	*/
+	std::array<uint32_t, 4> get_dynamic_offsets(const uint32_t slot) const;
+
+	/**
+	* \brief Obtain the type of each binding of the descriptor set, which depends on how the draws read their transforms
+	* \return the types of the uniform, instance, visible, bounds and indirect buffers
+	*/
+	std::array<VkDescriptorType, 5> get_descriptor_types() const;
+
+	/**
+	* \brief Record a draw of a primitive for each visible instance, giving each its transform the way the settings
+	* choose
+	* \param command_buffer the command buffer to record into
+	* \param index_count the number of indices of the primitive
+	* \param dynamic_offsets the offsets of the command buffer's slots, the descriptor set is bound again with these
+	* moved to each instance when the transforms are read as uniform buffers
 	*/
-	void create_semaphores();
+	void record_instance_draws(const VkCommandBuffer command_buffer, const uint32_t index_count,
+	                           const std::array<uint32_t, 4>& dynamic_offsets) const;
+
+	/**
+	* \brief Record the compute pass that culls the instances, writes the visible list and the instance count of each
+	* draw command, and makes them visible to the draws
+	* \param command_buffer the command buffer to record into
+	* \param slot the index of the command buffer, which chooses the slots of the buffers
+	* \param dynamic_offsets the offsets of the slots of the uniform, instance, visible and indirect buffers
+	*/
+	void record_culling(const VkCommandBuffer command_buffer, const uint32_t slot, const uint32_t* dynamic_offsets) const;
+
+	/**
+	* \brief Create synchronization objects for each frame in flight. One semaphore will be used to signal when an image
+	* is available for rendering to, the other will be used to signal when that rendering is finished. The fence is
+	* signalled when the GPU has finished executing the frame, so the CPU knows when the frame slot can be reused
+	*/
+	void create_sync_objects();
 
 	/**
 	* \brief This is where the data is sent to the uniform buffer for use in the vertex shader
+	* \param slot the slot to write, the index of the swapchain image the frame renders to
+	* \return the matrix that takes the instance grid to clip space, which the instances are culled with
+	*/
+	glm::mat4 update_uniform_buffer(const uint32_t slot) const;
+
+	/**
+	* \brief Cull the instances, spin each visible instance around its own centre and copy the transforms to the
+	* instance buffer. The visible list and draw commands are updated to draw the visible instances. When culling on
+	* the GPU every transform is written, and the compute pass does the rest
+	* \param slot the slot to write, the index of the swapchain image the frame renders to
+	* \param clip_from_grid the matrix that takes the instance grid to clip space
 	*/
-	void update_uniform_buffer() const;
+	void update_instance_buffer(const uint32_t slot, const glm::mat4& clip_from_grid);
 
 	/**
 	* \brief Called on each update, to draw to the surface
@@ -397,10 +814,10 @@ private:
 
 	/**
 	* \brief Create a shader module from SPIR-V shader code
-	* \param code the data of the shader
+	* \param code the SPIR-V words of the shader
 	* \return a shader module
 	*/
-	VkShaderModule create_shader_module(const std::vector<char>& code) const;
+	VkShaderModule create_shader_module(const std::vector<uint32_t>& code) const;
 
 	/**
 	* \brief Obtain the best surface format for the swapchain
@@ -463,13 +880,6 @@ private:
 	* \return true/false
 	*/
 	static bool check_validation_layer_support();
-
-	/**
-	* \brief Helper function to read a file from disk
-	* \param filename the name of the file to read
-	* \return a char vector containing the read data
-	*/
-	static std::vector<char> read_file(const std::string& filename);
 };
 
 #endif TRIANGLE_H
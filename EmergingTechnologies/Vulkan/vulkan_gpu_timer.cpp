@@ -0,0 +1,218 @@
+#include "vulkan_gpu_timer.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+void vulkan_gpu_timer::init(const VkPhysicalDevice physical_device, const VkDevice device, const uint32_t queue_family,
+                            const std::vector<std::string>& pass_names, const uint32_t history_size)
+{
+	device_ = device;
+	pass_names_ = pass_names;
+
+	//a timestamp tick is timestampPeriod nanoseconds long
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device, &properties);
+	timestamp_period_ns_ = properties.limits.timestampPeriod;
+
+	//a queue family without any valid timestamp bits cannot write timestamps at all, the rest of the bits
+	//are undefined and have to be masked off before subtracting timestamps
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, queue_families.data());
+
+	const auto valid_bits = queue_family < queue_family_count ? queue_families[queue_family].timestampValidBits : 0;
+	supported_ = valid_bits > 0 && properties.limits.timestampPeriod > 0.0F;
+	timestamp_mask_ = valid_bits >= 64 ? ~0ULL : (1ULL << valid_bits) - 1;
+
+	pass_history_.assign(pass_names_.size(), timing_history());
+	for (auto& history : pass_history_)
+	{
+		history.samples_ms.resize(history_size);
+	}
+	frame_history_ = timing_history();
+	frame_history_.samples_ms.resize(history_size);
+}
+
+void vulkan_gpu_timer::destroy()
+{
+	if (query_pool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device_, query_pool_, nullptr);
+		query_pool_ = VK_NULL_HANDLE;
+	}
+	pending_.clear();
+}
+
+void vulkan_gpu_timer::resize(const uint32_t slot_count)
+{
+	destroy();
+
+	if (!supported_ || slot_count == 0 || pass_names_.empty())
+	{
+		return;
+	}
+
+	//one pool holds the queries of every slot, each slot uses its own range of it
+	VkQueryPoolCreateInfo vk_query_pool_create_info = {};
+	vk_query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	vk_query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	vk_query_pool_create_info.queryCount = slot_count * queries_per_slot();
+
+	if (vkCreateQueryPool(device_, &vk_query_pool_create_info, nullptr, &query_pool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+
+	pending_.assign(slot_count, false);
+	results_.resize(queries_per_slot());
+}
+
+void vulkan_gpu_timer::record_reset(const VkCommandBuffer command_buffer, const uint32_t slot) const
+{
+	if (query_pool_ != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(command_buffer, query_pool_, slot * queries_per_slot(), queries_per_slot());
+	}
+}
+
+void vulkan_gpu_timer::record_begin(const VkCommandBuffer command_buffer, const uint32_t slot,
+                                    const uint32_t pass) const
+{
+	if (query_pool_ != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool_,
+		                    slot * queries_per_slot() + pass * 2);
+	}
+}
+
+void vulkan_gpu_timer::record_end(const VkCommandBuffer command_buffer, const uint32_t slot,
+                                  const uint32_t pass) const
+{
+	if (query_pool_ != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool_,
+		                    slot * queries_per_slot() + pass * 2 + 1);
+	}
+}
+
+void vulkan_gpu_timer::submitted(const uint32_t slot)
+{
+	if (slot < pending_.size())
+	{
+		pending_[slot] = true;
+	}
+}
+
+bool vulkan_gpu_timer::collect(const uint32_t slot)
+{
+	if (slot >= pending_.size() || !pending_[slot])
+	{
+		return false;
+	}
+
+	//without the wait flag this returns VK_NOT_READY rather than stalling if the GPU has not finished, in which
+	//case the frame is skipped
+	const auto result = vkGetQueryPoolResults(device_, query_pool_, slot * queries_per_slot(), queries_per_slot(),
+	                                          results_.size() * sizeof(uint64_t), results_.data(), sizeof(uint64_t),
+	                                          VK_QUERY_RESULT_64_BIT);
+	pending_[slot] = false;
+	if (result != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	const auto to_ms = timestamp_period_ns_ / 1000000.0;
+	auto frame_begin = std::numeric_limits<uint64_t>::max();
+	uint64_t frame_end = 0;
+	for (size_t pass = 0; pass < pass_names_.size(); pass++)
+	{
+		const auto begin = results_[pass * 2] & timestamp_mask_;
+		const auto end = results_[pass * 2 + 1] & timestamp_mask_;
+		pass_history_[pass].add(static_cast<double>((end - begin) & timestamp_mask_) * to_ms);
+
+		frame_begin = std::min(frame_begin, begin);
+		frame_end = std::max(frame_end, end);
+	}
+	frame_history_.add(static_cast<double>((frame_end - frame_begin) & timestamp_mask_) * to_ms);
+	return true;
+}
+
+gpu_timing_summary vulkan_gpu_timer::get_pass_summary(const uint32_t pass) const
+{
+	return pass < pass_history_.size() ? pass_history_[pass].summarise() : gpu_timing_summary();
+}
+
+gpu_timing_summary vulkan_gpu_timer::get_frame_summary() const
+{
+	return frame_history_.summarise();
+}
+
+void vulkan_gpu_timer::print_summary(std::ostream& stream) const
+{
+	if (!supported_)
+	{
+		stream << "gpu timestamps are not supported on this queue" << std::endl;
+		return;
+	}
+
+	//print one line per pass followed by the frame, formatted in a local stream so the caller's stream keeps its
+	//own formatting
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(3);
+	const auto print = [&text](const std::string& name, const gpu_timing_summary& summary)
+	{
+		text << "gpu " << name << ": min " << summary.min_ms <<
+			" ms, avg " << summary.avg_ms << " ms, p99 " << summary.p99_ms << " ms over " << summary.sample_count <<
+			" frames" << std::endl;
+	};
+	for (uint32_t pass = 0; pass < pass_names_.size(); pass++)
+	{
+		print(pass_names_[pass], get_pass_summary(pass));
+	}
+	print("frame", get_frame_summary());
+	stream << text.str();
+}
+
+void vulkan_gpu_timer::timing_history::add(const double ms)
+{
+	if (samples_ms.empty())
+	{
+		return;
+	}
+
+	samples_ms[next] = ms;
+	next = (next + 1) % static_cast<uint32_t>(samples_ms.size());
+	count = std::min(count + 1, static_cast<uint32_t>(samples_ms.size()));
+}
+
+gpu_timing_summary vulkan_gpu_timer::timing_history::summarise() const
+{
+	gpu_timing_summary summary;
+	if (count == 0)
+	{
+		return summary;
+	}
+
+	//the oldest samples are only overwritten once the ring is full, so the first count samples are valid
+	std::vector<double> sorted(samples_ms.begin(), samples_ms.begin() + count);
+	std::sort(sorted.begin(), sorted.end());
+
+	auto total = 0.0;
+	for (const auto ms : sorted)
+	{
+		total += ms;
+	}
+
+	const auto last = next == 0 ? samples_ms.size() - 1 : next - 1;
+	summary.last_ms = samples_ms[last];
+	summary.min_ms = sorted.front();
+	summary.avg_ms = total / count;
+	//nearest rank, so with fewer than 100 samples this is the slowest one
+	summary.p99_ms = sorted[static_cast<size_t>(std::ceil(count * 0.99)) - 1];
+	summary.sample_count = count;
+	return summary;
+}
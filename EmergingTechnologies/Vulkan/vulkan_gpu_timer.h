@@ -0,0 +1,170 @@
+/**
+* \class vulkan_gpu_timer
+*
+* \brief Measure how long the GPU spends on each pass of a frame using timestamp queries
+*
+* Each command buffer that is reused across frames gets its own slot of queries, and a
+* timestamp is written before and after every pass it records. The results of a slot are
+* read once the GPU has finished with it, which the application already waits for before
+* resubmitting the command buffer, so reading them never stalls. Durations are kept in a
+* rolling window per pass from which the min, average and 99th percentile are reported.
+*/
+
+#ifndef VULKAN_GPU_TIMER_H
+#define VULKAN_GPU_TIMER_H
+
+#include <vulkan/vulkan.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+* \brief A summary of the recent durations of a pass, in milliseconds
+*/
+struct gpu_timing_summary
+{
+	double last_ms = 0.0; //the most recent duration
+	double min_ms = 0.0;
+	double avg_ms = 0.0;
+	double p99_ms = 0.0; //99% of the recent durations were no longer than this
+	uint32_t sample_count = 0; //the number of durations the summary was made from
+};
+
+class vulkan_gpu_timer
+{
+public:
+	/**
+	* \brief Check that timestamps are supported and name the passes that will be timed
+	* \param physical_device the physical device, used to obtain the timestamp period
+	* \param device the logical device
+	* \param queue_family the queue family the timed command buffers are submitted to
+	* \param pass_names the name of each pass, the index of a name is used to identify the pass
+	* \param history_size the number of frames the summaries are made from
+	*/
+	void init(const VkPhysicalDevice physical_device, const VkDevice device, const uint32_t queue_family,
+	          const std::vector<std::string>& pass_names, const uint32_t history_size = 256);
+
+	/**
+	* \brief Destroy the query pool
+	*/
+	void destroy();
+
+	/**
+	* \brief Create queries for a number of slots, any results that have not been read are discarded. The
+	* device must be idle
+	* \param slot_count the number of command buffers that will be timed
+	*/
+	void resize(const uint32_t slot_count);
+
+	/**
+	* \brief Reset the queries of a slot, this must be recorded outside of a render pass before the passes
+	* \param command_buffer the command buffer to record into
+	* \param slot the slot of the command buffer
+	*/
+	void record_reset(const VkCommandBuffer command_buffer, const uint32_t slot) const;
+
+	/**
+	* \brief Write a timestamp once all previous commands have started, marking the start of a pass
+	* \param command_buffer the command buffer to record into
+	* \param slot the slot of the command buffer
+	* \param pass the index of the pass
+	*/
+	void record_begin(const VkCommandBuffer command_buffer, const uint32_t slot, const uint32_t pass) const;
+
+	/**
+	* \brief Write a timestamp once all previous commands have finished, marking the end of a pass
+	* \param command_buffer the command buffer to record into
+	* \param slot the slot of the command buffer
+	* \param pass the index of the pass
+	*/
+	void record_end(const VkCommandBuffer command_buffer, const uint32_t slot, const uint32_t pass) const;
+
+	/**
+	* \brief Note that the command buffer of a slot has been submitted
+	* \param slot the slot of the command buffer
+	*/
+	void submitted(const uint32_t slot);
+
+	/**
+	* \brief Read the results of the last submission of a slot, without waiting for them. Call this once the
+	* GPU has finished with the command buffer, before submitting it again
+	* \param slot the slot of the command buffer
+	* \return true if new results were read
+	*/
+	bool collect(const uint32_t slot);
+
+	/**
+	* \brief Check if the device can write timestamps on the queue family, nothing is recorded if not
+	* \return true if timestamps are supported
+	*/
+	bool is_supported() const
+	{
+		return supported_;
+	}
+
+	/**
+	* \brief Obtain a summary of the recent durations of a pass
+	* \param pass the index of the pass
+	* \return the summary
+	*/
+	gpu_timing_summary get_pass_summary(const uint32_t pass) const;
+
+	/**
+	* \brief Obtain a summary of the recent frame durations, from the start of the first pass to the end of the last
+	* \return the summary
+	*/
+	gpu_timing_summary get_frame_summary() const;
+
+	/**
+	* \brief Write the summary of every pass and the frame in a human readable form
+	* \param stream the stream to write to
+	*/
+	void print_summary(std::ostream& stream) const;
+
+private:
+	/**
+	* \brief The most recent durations of a pass, stored as a ring
+	*/
+	struct timing_history
+	{
+		std::vector<double> samples_ms;
+		uint32_t next = 0; //the sample to overwrite next
+		uint32_t count = 0; //the number of samples written, up to the size of the ring
+
+		/**
+		* \brief Add a duration, replacing the oldest once the ring is full
+		* \param ms the duration in milliseconds
+		*/
+		void add(const double ms);
+
+		/**
+		* \brief Summarise the durations in the ring
+		* \return the summary
+		*/
+		gpu_timing_summary summarise() const;
+	};
+
+	VkDevice device_ = VK_NULL_HANDLE;
+	VkQueryPool query_pool_ = VK_NULL_HANDLE;
+	bool supported_ = false;
+	double timestamp_period_ns_ = 1.0; //the nanoseconds per timestamp tick
+	uint64_t timestamp_mask_ = ~0ULL; //the bits of a timestamp that are valid
+
+	std::vector<std::string> pass_names_;
+	std::vector<bool> pending_; //true for the slots whose results have not been read yet
+	std::vector<uint64_t> results_; //scratch space for the results of a slot
+	std::vector<timing_history> pass_history_;
+	timing_history frame_history_;
+
+	/**
+	* \brief Obtain the number of queries in a slot, a begin and end timestamp for each pass
+	* \return the number of queries
+	*/
+	uint32_t queries_per_slot() const
+	{
+		return static_cast<uint32_t>(pass_names_.size()) * 2;
+	}
+};
+
+#endif
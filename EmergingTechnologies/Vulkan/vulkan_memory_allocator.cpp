@@ -0,0 +1,276 @@
+#include "vulkan_memory_allocator.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+/**
+* \brief Round a value up to the next multiple of alignment
+* \param value the value to round
+* \param alignment the alignment, vulkan guarantees this is a power of two
+* \return the aligned value
+*/
+static VkDeviceSize align_up(const VkDeviceSize value, const VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void vulkan_memory_allocator::init(const VkPhysicalDevice physical_device, const VkDevice device,
+                                   const VkDeviceSize block_size)
+{
+	device_ = device;
+	block_size_ = block_size;
+
+	//the memory types and heaps are needed to know which blocks can be mapped and how large a block can be
+	vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+
+	//buffers and optimal images that share a block must be placed this many bytes apart
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physical_device, &properties);
+	buffer_image_granularity_ = properties.limits.bufferImageGranularity;
+
+	//one pool for each memory type and allocation kind
+	pools_.resize(memory_properties_.memoryTypeCount * 2);
+	for (size_t i = 0; i < pools_.size(); i++)
+	{
+		pools_[i].memory_type = static_cast<uint32_t>(i / 2);
+	}
+}
+
+void vulkan_memory_allocator::destroy()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	for (auto& pool : pools_)
+	{
+		for (auto& block : pool.blocks)
+		{
+			//freeing memory also unmaps it
+			vkFreeMemory(device_, block->memory, nullptr);
+		}
+		pool.blocks.clear();
+	}
+}
+
+memory_allocation vulkan_memory_allocator::allocate(const VkMemoryRequirements& requirements,
+                                                    const uint32_t memory_type, const allocation_kind kind)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	//optimal images only need their own blocks when the device cannot place them directly next to buffers
+	const auto separate_kinds = buffer_image_granularity_ > 1 && kind == allocation_kind::optimal;
+	const auto pool_index = memory_type * 2 + (separate_kinds ? 1 : 0);
+	auto& pool = pools_[pool_index];
+
+	memory_allocation allocation;
+	allocation.pool_index = pool_index;
+
+	//large resources get a block of their own, so they do not leave most of a shared block unused
+	const auto heap_size = memory_properties_.memoryHeaps[memory_properties_.memoryTypes[memory_type].heapIndex].size;
+	const auto block_size = std::min(block_size_, heap_size / 8);
+	if (requirements.size > block_size / 2)
+	{
+		const auto block = create_block(pool_index, requirements.size, true);
+		allocate_from_block(*block, requirements.size, requirements.alignment, allocation);
+		return allocation;
+	}
+
+	//first fit through the existing blocks
+	for (auto& block : pool.blocks)
+	{
+		if (!block->dedicated && allocate_from_block(*block, requirements.size, requirements.alignment, allocation))
+		{
+			return allocation;
+		}
+	}
+
+	//no block had room, so reserve a new one
+	const auto block = create_block(pool_index, block_size, false);
+	if (!allocate_from_block(*block, requirements.size, requirements.alignment, allocation))
+	{
+		throw std::runtime_error("failed to sub-allocate memory from a new block!");
+	}
+	return allocation;
+}
+
+void vulkan_memory_allocator::free(memory_allocation& allocation)
+{
+	if (allocation.block == nullptr)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	auto& block = *allocation.block;
+	auto& ranges = block.free_ranges;
+
+	//the padding in front of the allocation is returned along with it
+	memory_block::free_range range = {allocation.offset - allocation.padding, allocation.padding + allocation.size};
+
+	//insert the range in offset order, then merge it with the neighbouring free ranges
+	auto next = std::lower_bound(ranges.begin(), ranges.end(), range,
+	                             [](const memory_block::free_range& a, const memory_block::free_range& b)
+	                             {
+		                             return a.offset < b.offset;
+	                             });
+	auto it = ranges.insert(next, range);
+	if (it + 1 != ranges.end() && it->offset + it->size == (it + 1)->offset)
+	{
+		it->size += (it + 1)->size;
+		ranges.erase(it + 1);
+	}
+	if (it != ranges.begin() && (it - 1)->offset + (it - 1)->size == it->offset)
+	{
+		(it - 1)->size += it->size;
+		ranges.erase(it);
+	}
+
+	block.allocation_count--;
+	block.bytes_used -= allocation.size;
+	block.bytes_padding -= allocation.padding;
+
+	//give empty blocks back to the driver, but keep the last shared block of a pool so that short lived
+	//allocations such as staging buffers do not allocate and free a block every time
+	auto& blocks = pools_[allocation.pool_index].blocks;
+	if (block.allocation_count == 0 && (block.dedicated || blocks.size() > 1))
+	{
+		vkFreeMemory(device_, block.memory, nullptr);
+		blocks.erase(std::find_if(blocks.begin(), blocks.end(), [&block](const std::unique_ptr<memory_block>& b)
+		{
+			return b.get() == &block;
+		}));
+	}
+
+	allocation = memory_allocation();
+}
+
+uint32_t vulkan_memory_allocator::find_memory_type(const uint32_t type_filter,
+                                                   const VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++)
+	{
+		if ((type_filter & (1 << i)) && (memory_properties_.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+memory_allocator_stats vulkan_memory_allocator::get_stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	memory_allocator_stats stats;
+	for (const auto& pool : pools_)
+	{
+		for (const auto& block : pool.blocks)
+		{
+			stats.block_count++;
+			stats.allocation_count += block->allocation_count;
+			stats.bytes_reserved += block->size;
+			stats.bytes_used += block->bytes_used;
+			stats.bytes_wasted += block->bytes_padding;
+
+			auto block_largest_free_range = VkDeviceSize(0);
+			for (const auto& range : block->free_ranges)
+			{
+				stats.bytes_free += range.size;
+				block_largest_free_range = std::max(block_largest_free_range, range.size);
+				stats.free_range_count++;
+			}
+			stats.largest_free_range = std::max(stats.largest_free_range, block_largest_free_range);
+			stats.bytes_free_contiguous += block_largest_free_range;
+		}
+	}
+
+	return stats;
+}
+
+void vulkan_memory_allocator::print_stats(std::ostream& stream) const
+{
+	const auto stats = get_stats();
+	const auto mib = 1024.0 * 1024.0;
+
+	//format into a local stream so the caller's stream keeps its own formatting
+	std::ostringstream text;
+	text << "device memory: " << stats.block_count << " blocks, " << stats.allocation_count << " allocations, "
+		<< std::fixed << std::setprecision(2) << stats.bytes_reserved / mib << " MiB reserved, "
+		<< stats.bytes_used / mib << " MiB used, " << stats.bytes_wasted << " bytes wasted on alignment, "
+		<< stats.free_range_count << " free ranges, " << stats.fragmentation() * 100.0F << "% fragmented"
+		<< std::endl;
+	stream << text.str();
+}
+
+memory_block* vulkan_memory_allocator::create_block(const uint32_t pool_index, const VkDeviceSize size,
+                                                    const bool dedicated)
+{
+	auto& pool = pools_[pool_index];
+
+	VkMemoryAllocateInfo vk_memory_allocate_info = {};
+	vk_memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	vk_memory_allocate_info.allocationSize = size;
+	vk_memory_allocate_info.memoryTypeIndex = pool.memory_type;
+
+	std::unique_ptr<memory_block> block(new memory_block());
+	if (vkAllocateMemory(device_, &vk_memory_allocate_info, nullptr, &block->memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate memory block!");
+	}
+
+	block->size = size;
+	block->dedicated = dedicated;
+	block->free_ranges.push_back({0, size}); //the whole block starts out free
+
+	//host visible blocks stay mapped until they are freed
+	if (memory_properties_.memoryTypes[pool.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(device_, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS)
+		{
+			vkFreeMemory(device_, block->memory, nullptr);
+			throw std::runtime_error("failed to map memory block!");
+		}
+	}
+
+	pool.blocks.push_back(std::move(block));
+	return pool.blocks.back().get();
+}
+
+bool vulkan_memory_allocator::allocate_from_block(memory_block& block, const VkDeviceSize size,
+                                                  const VkDeviceSize alignment, memory_allocation& allocation)
+{
+	for (auto it = block.free_ranges.begin(); it != block.free_ranges.end(); ++it)
+	{
+		//the allocation starts at the first aligned offset in the range
+		const auto offset = align_up(it->offset, alignment);
+		const auto padding = offset - it->offset;
+		if (padding + size > it->size)
+		{
+			continue;
+		}
+
+		//shrink the free range from the front, removing it once it is used up
+		it->offset += padding + size;
+		it->size -= padding + size;
+		if (it->size == 0)
+		{
+			block.free_ranges.erase(it);
+		}
+
+		block.allocation_count++;
+		block.bytes_used += size;
+		block.bytes_padding += padding;
+
+		allocation.memory = block.memory;
+		allocation.offset = offset;
+		allocation.size = size;
+		allocation.padding = padding;
+		allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + offset : nullptr;
+		allocation.block = &block;
+		return true;
+	}
+
+	return false;
+}
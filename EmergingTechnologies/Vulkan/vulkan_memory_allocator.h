@@ -0,0 +1,195 @@
+/**
+* \class vulkan_memory_allocator
+*
+* \brief Sub-allocate buffer and image memory from large device memory blocks
+*
+* Vulkan limits the number of live vkAllocateMemory calls (maxMemoryAllocationCount,
+* which can be as low as 4096) and each call is expensive. This allocator reserves
+* large blocks of device memory per memory type and hands out aligned ranges of
+* them using a first fit free list. Freed ranges are merged back into their
+* neighbours. Host visible blocks are mapped once for their whole lifetime, since
+* a VkDeviceMemory object can only be mapped once at a time.
+*/
+
+#ifndef VULKAN_MEMORY_ALLOCATOR_H
+#define VULKAN_MEMORY_ALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+* \brief The kind of resource that will be bound to an allocation. Linear (buffers) and optimal
+* (tiled images) resources must be bufferImageGranularity apart when they share a block, so
+* they are kept in separate blocks when the device has a granularity greater than 1
+*/
+enum class allocation_kind
+{
+	linear,
+	optimal
+};
+
+/**
+* \brief A block of device memory that allocations are sub-allocated from
+*/
+struct memory_block
+{
+	/**
+	* \brief A range of the block that is not in use
+	*/
+	struct free_range
+	{
+		VkDeviceSize offset;
+		VkDeviceSize size;
+	};
+
+	VkDeviceMemory memory = VK_NULL_HANDLE; //the device memory of the block
+	VkDeviceSize size = 0; //the size of the block in bytes
+	void* mapped = nullptr; //the host address of the block, null if it is not host visible
+	bool dedicated = false; //true if the block was created for a single large allocation
+	uint32_t allocation_count = 0; //the number of live allocations in the block
+	VkDeviceSize bytes_used = 0; //the bytes requested by the live allocations
+	VkDeviceSize bytes_padding = 0; //the bytes skipped by the live allocations to meet their alignment
+	std::vector<free_range> free_ranges; //the unused ranges, sorted by offset
+};
+
+/**
+* \brief A range of device memory returned by the allocator. Bind resources to memory at offset
+*/
+struct memory_allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE; //the device memory the range lives in
+	VkDeviceSize offset = 0; //the aligned offset of the range in memory
+	VkDeviceSize size = 0; //the size that was requested
+	VkDeviceSize padding = 0; //the bytes skipped before offset to satisfy the alignment
+	void* mapped = nullptr; //the host address of offset, null if the memory is not host visible
+	uint32_t pool_index = 0; //the pool the block belongs to
+	memory_block* block = nullptr; //the block the range was taken from
+};
+
+/**
+* \brief Statistics about the memory held by the allocator
+*/
+struct memory_allocator_stats
+{
+	uint32_t block_count = 0; //the number of vkAllocateMemory calls alive
+	uint32_t allocation_count = 0; //the number of live sub-allocations
+	VkDeviceSize bytes_reserved = 0; //the total size of all blocks
+	VkDeviceSize bytes_used = 0; //the bytes requested by live allocations
+	VkDeviceSize bytes_wasted = 0; //the bytes lost to alignment padding
+	VkDeviceSize bytes_free = 0; //the bytes not used by any allocation
+	VkDeviceSize largest_free_range = 0; //the largest single range that can still be allocated
+	uint32_t free_range_count = 0; //the number of separate free ranges
+	VkDeviceSize bytes_free_contiguous = 0; //the sum of the largest free range of every block
+
+	/**
+	* \brief How fragmented the free memory is, 0 when the free memory of each block is one range and
+	* approaching 1 as it is split into many small ranges
+	*/
+	float fragmentation() const
+	{
+		return bytes_free == 0
+			       ? 0.0F
+			       : 1.0F - static_cast<float>(bytes_free_contiguous) / static_cast<float>(bytes_free);
+	}
+};
+
+/**
+* \brief The allocator
+*/
+class vulkan_memory_allocator
+{
+public:
+	/**
+	* \brief Prepare the allocator for use with a device
+	* \param physical_device the physical device, used to query the memory heaps and limits
+	* \param device the logical device to allocate from
+	* \param block_size the preferred size of each block, smaller heaps use smaller blocks
+	*/
+	void init(const VkPhysicalDevice physical_device, const VkDevice device,
+	          const VkDeviceSize block_size = 64 * 1024 * 1024);
+
+	/**
+	* \brief Free every block. All allocations must have been freed or their resources destroyed
+	*/
+	void destroy();
+
+	/**
+	* \brief Allocate a range of memory
+	* \param requirements the memory requirements of the resource
+	* \param memory_type the memory type index to allocate from, as returned by find_memory_type
+	* \param kind whether a buffer or an optimally tiled image will be bound to the range
+	* \return the allocation
+	*/
+	memory_allocation allocate(const VkMemoryRequirements& requirements, const uint32_t memory_type,
+	                           const allocation_kind kind);
+
+	/**
+	* \brief Return a range of memory to its block
+	* \param allocation the allocation to free, reset to an empty allocation afterwards
+	*/
+	void free(memory_allocation& allocation);
+
+	/**
+	* \brief Obtain a memory type that the GPU supports
+	* \param type_filter the memory types the resource can use
+	* \param properties the memory property flags the type must have
+	* \return the index of the memory type
+	*/
+	uint32_t find_memory_type(const uint32_t type_filter, const VkMemoryPropertyFlags properties) const;
+
+	/**
+	* \brief Obtain statistics about all blocks
+	* \return the statistics
+	*/
+	memory_allocator_stats get_stats() const;
+
+	/**
+	* \brief Write the statistics in a human readable form
+	* \param stream the stream to write to
+	*/
+	void print_stats(std::ostream& stream) const;
+
+private:
+	/**
+	* \brief All the blocks of one memory type and allocation kind
+	*/
+	struct memory_pool
+	{
+		uint32_t memory_type = 0;
+		std::vector<std::unique_ptr<memory_block>> blocks;
+	};
+
+	VkDevice device_ = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memory_properties_ = {};
+	VkDeviceSize buffer_image_granularity_ = 1;
+	VkDeviceSize block_size_ = 0;
+
+	std::vector<memory_pool> pools_; //indexed by memory type * 2 + allocation kind
+	mutable std::mutex mutex_; //allocations may be made from worker threads
+
+	/**
+	* \brief Create a new block and add it to a pool
+	* \param pool_index the pool to add the block to
+	* \param size the size of the block
+	* \param dedicated true if the block is for a single allocation
+	* \return the block
+	*/
+	memory_block* create_block(const uint32_t pool_index, const VkDeviceSize size, const bool dedicated);
+
+	/**
+	* \brief Try to take a range out of a block
+	* \param block the block to allocate from
+	* \param size the size of the range
+	* \param alignment the alignment of the range
+	* \param allocation filled in with the range on success
+	* \return true if the block had room for the range
+	*/
+	static bool allocate_from_block(memory_block& block, const VkDeviceSize size, const VkDeviceSize alignment,
+	                                memory_allocation& allocation);
+};
+
+#endif
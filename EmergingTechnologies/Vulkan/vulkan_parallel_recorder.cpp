@@ -0,0 +1,125 @@
+#include "vulkan_parallel_recorder.h"
+#include <algorithm>
+#include <stdexcept>
+
+void vulkan_parallel_recorder::init(const VkDevice device, const uint32_t queue_family, job_system& jobs,
+                                    const uint32_t slice_count)
+{
+	device_ = device;
+	queue_family_ = queue_family;
+	jobs_ = &jobs;
+	slices_.resize(std::max<uint32_t>(slice_count, 1));
+}
+
+void vulkan_parallel_recorder::destroy()
+{
+	resize(0, 0);
+	slices_.clear();
+	jobs_ = nullptr;
+}
+
+void vulkan_parallel_recorder::resize(const uint32_t slot_count, const VkCommandPoolCreateFlags pool_flags)
+{
+	for (auto& current : slices_)
+	{
+		//destroying a pool frees its command buffers
+		for (auto command_pool : current.command_pools)
+		{
+			vkDestroyCommandPool(device_, command_pool, nullptr);
+		}
+		current.command_pools.assign(slot_count, VK_NULL_HANDLE);
+		current.command_buffers.assign(slot_count, VK_NULL_HANDLE);
+
+		for (uint32_t slot = 0; slot < slot_count; slot++)
+		{
+			VkCommandPoolCreateInfo vk_command_pool_create_info = {};
+			vk_command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			vk_command_pool_create_info.flags = pool_flags;
+			vk_command_pool_create_info.queueFamilyIndex = queue_family_;
+
+			if (vkCreateCommandPool(device_, &vk_command_pool_create_info, nullptr, &current.command_pools[slot]) !=
+				VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create recording command pool!");
+			}
+
+			VkCommandBufferAllocateInfo vk_command_buffer_allocate_info = {};
+			vk_command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			vk_command_buffer_allocate_info.commandPool = current.command_pools[slot];
+			vk_command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			vk_command_buffer_allocate_info.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device_, &vk_command_buffer_allocate_info, &current.command_buffers[slot]) !=
+				VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate secondary command buffers!");
+			}
+		}
+	}
+}
+
+void vulkan_parallel_recorder::record(const uint32_t slot, const VkCommandBufferUsageFlags usage,
+                                      const VkCommandBufferInheritanceInfo& inheritance, const size_t item_count,
+                                      const record_function& record_items, std::vector<VkCommandBuffer>& recorded)
+{
+	//one slice per task, parallel_for only returns once every slice has finished, so an error is thrown without
+	//leaving a command buffer being recorded
+	jobs_->parallel_for(0, slices_.size(), 1, [&](const size_t first, const size_t last)
+	{
+		for (auto index = first; index < last; index++)
+		{
+			record_slice(static_cast<uint32_t>(index), slot, usage, inheritance, item_count, record_items);
+		}
+	});
+
+	recorded.clear();
+	for (uint32_t i = 0; i < slices_.size(); i++)
+	{
+		if (get_slice_start(i, item_count) < get_slice_start(i + 1, item_count))
+		{
+			recorded.push_back(slices_[i].command_buffers[slot]);
+		}
+	}
+}
+
+void vulkan_parallel_recorder::record_slice(const uint32_t index, const uint32_t slot,
+                                            const VkCommandBufferUsageFlags usage,
+                                            const VkCommandBufferInheritanceInfo& inheritance, const size_t item_count,
+                                            const record_function& record_items)
+{
+	const auto first = get_slice_start(index, item_count);
+	const auto last = get_slice_start(index + 1, item_count);
+	if (first == last)
+	{
+		return;
+	}
+
+	//the pool only holds this slot's command buffer, so resetting it returns all of its memory at once
+	if (vkResetCommandPool(device_, slices_[index].command_pools[slot], 0) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to reset recording command pool!");
+	}
+
+	//the secondary command buffer continues the primary's render pass, and is submitted like the primary
+	VkCommandBufferBeginInfo vk_command_buffer_begin_info = {};
+	vk_command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	vk_command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | usage;
+	vk_command_buffer_begin_info.pInheritanceInfo = &inheritance;
+
+	const auto command_buffer = slices_[index].command_buffers[slot];
+	if (vkBeginCommandBuffer(command_buffer, &vk_command_buffer_begin_info) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin secondary command buffer!");
+	}
+	record_items(command_buffer, first, last);
+	if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record secondary command buffer!");
+	}
+}
+
+size_t vulkan_parallel_recorder::get_slice_start(const uint32_t index, const size_t item_count) const
+{
+	//the slices differ in size by one item at most
+	return item_count * index / slices_.size();
+}
@@ -0,0 +1,117 @@
+/**
+* \class vulkan_parallel_recorder
+*
+* \brief Record the draws of a render pass into secondary command buffers on the threads of a job system
+*
+* A command pool and the command buffers allocated from it can only be used by one thread at a
+* time. The items to record, the draws of a scene, are split into a fixed number of contiguous
+* slices, and each slice owns its pools, so whichever thread records a slice is the only one
+* using them. Each slice has a pool with a single command buffer for every slot, a slot being a
+* primary command buffer or a frame in flight, and resets the slot's pool before recording it
+* again, which is cheaper than resetting command buffers one at a time. The secondary command
+* buffers are returned in the order of their slices so the primary command buffer executes the
+* draws in their original order.
+*/
+
+#ifndef VULKAN_PARALLEL_RECORDER_H
+#define VULKAN_PARALLEL_RECORDER_H
+
+#include <vulkan/vulkan.h>
+
+#include "job_system.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class vulkan_parallel_recorder
+{
+public:
+	/**
+	* \brief Records the commands of the items first to last - 1 into a secondary command buffer, which has been begun
+	*/
+	typedef std::function<void(VkCommandBuffer command_buffer, size_t first, size_t last)> record_function;
+
+	/**
+	* \brief Set up the slices, the command pools are created by resize
+	* \param device the device the command buffers are recorded for
+	* \param queue_family the family of the queue the primary command buffers are submitted to
+	* \param jobs the job system the slices are recorded on, it has to outlive the recorder
+	* \param slice_count the number of slices the items are split into
+	*/
+	void init(VkDevice device, uint32_t queue_family, job_system& jobs, uint32_t slice_count);
+
+	/**
+	* \brief Destroy the command pools, and with them the command buffers
+	*/
+	void destroy();
+
+	/**
+	* \brief Create the command pools and their secondary command buffers, replacing the previous ones. None of them
+	* may be in use
+	* \param slot_count the number of slots, each slice has a pool and a secondary command buffer for each
+	* \param pool_flags the flags the pools are created with, transient if they are recorded every frame
+	*/
+	void resize(uint32_t slot_count, VkCommandPoolCreateFlags pool_flags);
+
+	/**
+	* \brief Obtain the number of slices the items are split into
+	* \return the number of slices
+	*/
+	uint32_t get_slice_count() const
+	{
+		return static_cast<uint32_t>(slices_.size());
+	}
+
+	/**
+	* \brief Record a number of items, split into slices that are recorded by the job system, and wait for every slice.
+	* The slot's pools are reset first, so the GPU must have finished with the slot's secondary command buffers
+	* \param slot the slot of each slice to record into
+	* \param usage how the secondary command buffers will be submitted, they always continue a render pass
+	* \param inheritance the render pass, subpass and framebuffer the secondary command buffers are executed in
+	* \param item_count the number of items to record
+	* \param record_items records a slice of the items, called from several threads at once
+	* \param recorded the secondary command buffers that were recorded in order, replaced. A slice with no items
+	* records nothing
+	*/
+	void record(uint32_t slot, VkCommandBufferUsageFlags usage, const VkCommandBufferInheritanceInfo& inheritance,
+	            size_t item_count, const record_function& record_items, std::vector<VkCommandBuffer>& recorded);
+
+private:
+	/**
+	* \brief The command pools and secondary command buffers of a slice, one of each per slot
+	*/
+	struct slice
+	{
+		std::vector<VkCommandPool> command_pools;
+		std::vector<VkCommandBuffer> command_buffers;
+	};
+
+	VkDevice device_ = VK_NULL_HANDLE;
+	uint32_t queue_family_ = 0;
+	job_system* jobs_ = nullptr;
+	std::vector<slice> slices_;
+
+	/**
+	* \brief Record a slice of the items
+	* \param index the index of the slice
+	* \param slot the slot to record into
+	* \param usage how the secondary command buffer will be submitted
+	* \param inheritance the render pass, subpass and framebuffer the secondary command buffer is executed in
+	* \param item_count the number of items, which the slice is a part of
+	* \param record_items records the slice's items
+	*/
+	void record_slice(uint32_t index, uint32_t slot, VkCommandBufferUsageFlags usage,
+	                  const VkCommandBufferInheritanceInfo& inheritance, size_t item_count,
+	                  const record_function& record_items);
+
+	/**
+	* \brief Obtain the first item of a slice
+	* \param index the index of the slice, the number of slices gives the end of the last slice
+	* \param item_count the number of items
+	* \return the first item
+	*/
+	size_t get_slice_start(uint32_t index, size_t item_count) const;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "vulkan_pipeline_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/**
+* \brief The header vulkan writes at the start of VK_PIPELINE_CACHE_HEADER_VERSION_ONE cache data
+*/
+struct pipeline_cache_header
+{
+	uint32_t header_size;
+	uint32_t header_version;
+	uint32_t vendor_id;
+	uint32_t device_id;
+	uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+};
+
+void vulkan_pipeline_cache::init(const VkPhysicalDevice physical_device, const VkDevice device,
+                                 const std::string& path)
+{
+	device_ = device;
+	path_ = path;
+	warm_ = false;
+	vkGetPhysicalDeviceProperties(physical_device, &properties_);
+
+	//read the previous run's cache, a missing file just means the cache starts empty
+	std::vector<char> data;
+	if (!path_.empty())
+	{
+		std::ifstream file(path_, std::ios::ate | std::ios::binary);
+		if (file.is_open())
+		{
+			data.resize(static_cast<size_t>(file.tellg()));
+			file.seekg(0);
+			file.read(data.data(), data.size());
+		}
+	}
+
+	//data from another driver or GPU is ignored, drivers should reject it themselves but not all of them do
+	warm_ = is_compatible(data);
+
+	VkPipelineCacheCreateInfo vk_pipeline_cache_create_info = {};
+	vk_pipeline_cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	vk_pipeline_cache_create_info.initialDataSize = warm_ ? data.size() : 0;
+	vk_pipeline_cache_create_info.pInitialData = warm_ ? data.data() : nullptr;
+
+	if (vkCreatePipelineCache(device_, &vk_pipeline_cache_create_info, nullptr, &cache_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+void vulkan_pipeline_cache::destroy()
+{
+	vkDestroyPipelineCache(device_, cache_, nullptr);
+	cache_ = VK_NULL_HANDLE;
+}
+
+void vulkan_pipeline_cache::save() const
+{
+	if (path_.empty() || cache_ == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//obtain the size of the cache data, then the data
+	size_t size = 0;
+	vkGetPipelineCacheData(device_, cache_, &size, nullptr);
+	std::vector<char> data(size);
+	if (size == 0 || vkGetPipelineCacheData(device_, cache_, &size, data.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	//write the data next to the cache file first, so the old file is left alone if writing fails
+	const auto temp_path = path_ + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open() || !file.write(data.data(), size) || !file.flush())
+		{
+			file.close();
+			std::remove(temp_path.c_str());
+			std::cout << "failed to write pipeline cache " << path_ << ", it is not saved" << std::endl;
+			return;
+		}
+	}
+
+	//then replace the old file in one step, std::rename does not replace existing files on windows
+#ifdef _WIN32
+	const auto replaced = MoveFileExA(temp_path.c_str(), path_.c_str(),
+	                                  MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	const auto replaced = std::rename(temp_path.c_str(), path_.c_str()) == 0;
+#endif
+	if (!replaced)
+	{
+		std::remove(temp_path.c_str());
+		std::cout << "failed to replace pipeline cache " << path_ << ", it is not saved" << std::endl;
+	}
+}
+
+bool vulkan_pipeline_cache::is_compatible(const std::vector<char>& data) const
+{
+	if (data.size() < sizeof(pipeline_cache_header))
+	{
+		return false;
+	}
+
+	pipeline_cache_header header;
+	memcpy(&header, data.data(), sizeof(header));
+
+	return header.header_size >= sizeof(pipeline_cache_header) &&
+		header.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		header.vendor_id == properties_.vendorID &&
+		header.device_id == properties_.deviceID &&
+		memcmp(header.pipeline_cache_uuid, properties_.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,78 @@
+/**
+* \class vulkan_pipeline_cache
+*
+* \brief A VkPipelineCache that is loaded from disk at startup and saved back at shutdown
+*
+* Creating a pipeline compiles its shaders for the GPU, which is the slowest part of
+* startup and of recreating the pipeline when the window is resized. The driver can skip
+* this work for any pipeline that is already in the cache. A cache file is only used if its
+* header matches the vendor, device and pipelineCacheUUID of the current driver, since a
+* driver update or a different GPU makes the data useless. The file is written to a
+* temporary file and then renamed over the old one, so a crash while saving never leaves
+* a truncated cache behind.
+*/
+
+#ifndef VULKAN_PIPELINE_CACHE_H
+#define VULKAN_PIPELINE_CACHE_H
+
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <vector>
+
+class vulkan_pipeline_cache
+{
+public:
+	/**
+	* \brief Create the cache, filled with the contents of the file if it is valid for the device
+	* \param physical_device the physical device, used to validate the file header
+	* \param device the logical device
+	* \param path the file to load from and save to, the cache is not loaded or saved if empty
+	*/
+	void init(const VkPhysicalDevice physical_device, const VkDevice device, const std::string& path);
+
+	/**
+	* \brief Destroy the cache without saving it
+	*/
+	void destroy();
+
+	/**
+	* \brief Write the contents of the cache to the file, replacing it atomically. A cache that cannot be written is
+	* reported and left unsaved, so shutdown carries on
+	*/
+	void save() const;
+
+	/**
+	* \brief Obtain the cache to pass to pipeline creation
+	* \return the cache
+	*/
+	VkPipelineCache get() const
+	{
+		return cache_;
+	}
+
+	/**
+	* \brief Check if the cache was filled from the file
+	* \return true if a valid file was loaded, false if the cache started empty
+	*/
+	bool is_warm() const
+	{
+		return warm_;
+	}
+
+private:
+	VkDevice device_ = VK_NULL_HANDLE;
+	VkPipelineCache cache_ = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties properties_ = {};
+	std::string path_;
+	bool warm_ = false;
+
+	/**
+	* \brief Check that cache data was created by the same driver and device
+	* \param data the cache data
+	* \return true if the header matches the device
+	*/
+	bool is_compatible(const std::vector<char>& data) const;
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include "vulkan_pipeline_manager.h"
+#include "frame_statistics.h"
+#include <iostream>
+#include <stdexcept>
+
+vulkan_pipeline_manager::~vulkan_pipeline_manager()
+{
+	destroy();
+}
+
+void vulkan_pipeline_manager::init(const VkDevice device, const VkPipelineCache cache, const uint32_t thread_count)
+{
+	device_ = device;
+	cache_ = cache;
+	stopping_ = false;
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		threads_.emplace_back(&vulkan_pipeline_manager::worker_loop, this);
+	}
+}
+
+void vulkan_pipeline_manager::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+		queued_.clear();
+	}
+	work_ready_.notify_all();
+	for (auto& thread : threads_)
+	{
+		thread.join();
+	}
+	threads_.clear();
+
+	destroy_pipelines();
+	compile_log_.clear();
+	device_ = VK_NULL_HANDLE;
+}
+
+void vulkan_pipeline_manager::clear()
+{
+	//the builders refer to the render pass the pipelines are being replaced for, so none can be left running
+	wait();
+	destroy_pipelines();
+}
+
+uint32_t vulkan_pipeline_manager::request(const std::string& name, const pipeline_builder& build)
+{
+	const auto id = static_cast<uint32_t>(pipelines_.size());
+	pipelines_.push_back(VK_NULL_HANDLE);
+
+	pipeline_request pending = {id, name, build, std::chrono::high_resolution_clock::now(), VK_NULL_HANDLE, 0.0, nullptr};
+	if (threads_.empty())
+	{
+		//there is nowhere else to create it, so it is ready straight away
+		create(pending);
+		std::lock_guard<std::mutex> lock(mutex_);
+		finished_.push_back(std::move(pending));
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			queued_.push_back(std::move(pending));
+		}
+		work_ready_.notify_one();
+	}
+	return id;
+}
+
+uint32_t vulkan_pipeline_manager::collect()
+{
+	std::vector<pipeline_request> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::swap(finished, finished_);
+	}
+
+	//every finished pipeline is made ready before an error is thrown, so none of them leak
+	std::exception_ptr error;
+	uint32_t ready_count = 0;
+	const auto now = std::chrono::high_resolution_clock::now();
+	for (auto& pending : finished)
+	{
+		if (pending.error)
+		{
+			if (!error)
+			{
+				error = pending.error;
+			}
+			continue;
+		}
+
+		pipelines_[pending.id] = pending.pipeline;
+		ready_count++;
+
+		const pipeline_compile_record record = {
+			pending.name, pending.create_ms, frame_statistics::elapsed_ms(pending.request_time, now), !threads_.empty()
+		};
+		compile_log_.push_back(record);
+		std::cout << "pipeline " << record.name << " created in " << record.create_ms << " ms on " <<
+			(record.background ? "a background thread" : "the render thread") << ", ready " << record.ready_ms <<
+			" ms after it was requested" << std::endl;
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+	return ready_count;
+}
+
+void vulkan_pipeline_manager::wait()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		work_done_.wait(lock, [this]
+		{
+			return queued_.empty() && busy_threads_ == 0;
+		});
+	}
+	collect();
+}
+
+void vulkan_pipeline_manager::worker_loop()
+{
+	for (;;)
+	{
+		pipeline_request pending;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			work_ready_.wait(lock, [this]
+			{
+				return stopping_ || !queued_.empty();
+			});
+			if (stopping_)
+			{
+				return;
+			}
+			pending = std::move(queued_.front());
+			queued_.pop_front();
+			busy_threads_++;
+		}
+
+		create(pending);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			finished_.push_back(std::move(pending));
+			busy_threads_--;
+		}
+		work_done_.notify_all();
+	}
+}
+
+void vulkan_pipeline_manager::create(pipeline_request& pending) const
+{
+	const auto start_time = std::chrono::high_resolution_clock::now();
+	try
+	{
+		pending.pipeline = pending.build(cache_);
+	}
+	catch (...)
+	{
+		pending.error = std::current_exception();
+	}
+	pending.create_ms = frame_statistics::elapsed_ms(start_time, std::chrono::high_resolution_clock::now());
+
+	//the builder may refer to things that are about to be destroyed, so it is not kept any longer than needed
+	pending.build = nullptr;
+}
+
+void vulkan_pipeline_manager::destroy_pipelines()
+{
+	//pipelines that finished but were never collected are destroyed too
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (const auto& pending : finished_)
+		{
+			vkDestroyPipeline(device_, pending.pipeline, nullptr);
+		}
+		finished_.clear();
+	}
+	for (auto pipeline : pipelines_)
+	{
+		vkDestroyPipeline(device_, pipeline, nullptr);
+	}
+	pipelines_.clear();
+}
@@ -0,0 +1,166 @@
+/**
+* \class vulkan_pipeline_manager
+*
+* \brief Create pipelines on background threads, so the render thread never waits for a compile
+*
+* Creating a pipeline that is not in the pipeline cache compiles its shaders for the GPU, which
+* can take long enough to drop frames if it happens on the render thread. Pipelines are
+* requested with a function that creates them, and the requests are queued to a few threads
+* that run them in order, all passing the same VkPipelineCache, which vulkan synchronizes
+* internally. Until a pipeline is ready the renderer draws with a fallback of its choosing, a
+* simple pipeline created up front. Finished pipelines are handed to the render thread by
+* collect, which logs how long each took to create and how long it was waited for, so the
+* hitches moved off the render thread can be measured. With no threads the pipelines are
+* created as they are requested, on the render thread, as they were before.
+*/
+
+#ifndef VULKAN_PIPELINE_MANAGER_H
+#define VULKAN_PIPELINE_MANAGER_H
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+* \brief How long a pipeline took to create, and how long it was waited for
+*/
+struct pipeline_compile_record
+{
+	std::string name;
+	double create_ms; //the time spent in the function that created it
+	double ready_ms; //the time from the request until it was collected by the render thread
+	bool background; //created on a background thread rather than the render thread
+};
+
+class vulkan_pipeline_manager
+{
+public:
+	/**
+	* \brief Creates a pipeline with the cache it is passed, called on a background thread
+	*/
+	typedef std::function<VkPipeline(VkPipelineCache cache)> pipeline_builder;
+
+	/**
+	* \brief Stop the threads if destroy has not been called, so an application that is unwinding from an error does not
+	* leave them joinable
+	*/
+	~vulkan_pipeline_manager();
+
+	/**
+	* \brief Start the threads
+	* \param device the device the pipelines are created on
+	* \param cache the pipeline cache every pipeline is created with
+	* \param thread_count the number of background threads, 0 creates pipelines on the render thread
+	*/
+	void init(VkDevice device, VkPipelineCache cache, uint32_t thread_count);
+
+	/**
+	* \brief Wait for the pipelines being created, stop the threads and destroy every pipeline. Requests that have not
+	* started are dropped. Calling it again does nothing
+	*/
+	void destroy();
+
+	/**
+	* \brief Wait for every request, then destroy every pipeline and forget the requests, so they can be made again for
+	* a new render pass
+	*/
+	void clear();
+
+	/**
+	* \brief Request a pipeline
+	* \param name the name the pipeline is logged with
+	* \param build creates the pipeline, it must stay valid to call until the pipeline is ready or the manager is cleared
+	* \return the id to obtain the pipeline with
+	*/
+	uint32_t request(const std::string& name, const pipeline_builder& build);
+
+	/**
+	* \brief Obtain a pipeline if it is ready. Called from the render thread, or tasks it waits for
+	* \param id the id the pipeline was requested with
+	* \param fallback the pipeline to use until it is ready
+	* \return the pipeline, or the fallback
+	*/
+	VkPipeline get(uint32_t id, VkPipeline fallback) const
+	{
+		return pipelines_[id] != VK_NULL_HANDLE ? pipelines_[id] : fallback;
+	}
+
+	/**
+	* \brief Make the pipelines finished since the last call ready, and log them. Called from the render thread
+	* \return the number of pipelines that became ready, an error thrown by a builder is rethrown
+	*/
+	uint32_t collect();
+
+	/**
+	* \brief Wait until every requested pipeline is ready
+	*/
+	void wait();
+
+	/**
+	* \brief Obtain the log of every pipeline that has become ready
+	* \return the records in the order the pipelines became ready
+	*/
+	const std::vector<pipeline_compile_record>& get_compile_log() const
+	{
+		return compile_log_;
+	}
+
+private:
+	/**
+	* \brief A request waiting for a thread, or a pipeline waiting to be collected
+	*/
+	struct pipeline_request
+	{
+		uint32_t id;
+		std::string name;
+		pipeline_builder build;
+		std::chrono::high_resolution_clock::time_point request_time;
+		VkPipeline pipeline;
+		double create_ms;
+		std::exception_ptr error;
+	};
+
+	VkDevice device_ = VK_NULL_HANDLE;
+	VkPipelineCache cache_ = VK_NULL_HANDLE;
+	std::vector<std::thread> threads_;
+
+	//only touched by the render thread
+	std::vector<VkPipeline> pipelines_; //by id, null until ready
+	std::vector<pipeline_compile_record> compile_log_;
+
+	//the queue and the finished pipelines, shared with the threads
+	std::mutex mutex_;
+	std::condition_variable work_ready_;
+	std::condition_variable work_done_;
+	std::deque<pipeline_request> queued_;
+	std::vector<pipeline_request> finished_;
+	uint32_t busy_threads_ = 0;
+	bool stopping_ = false;
+
+	/**
+	* \brief Create the queued pipelines until the manager is destroyed
+	*/
+	void worker_loop();
+
+	/**
+	* \brief Create a pipeline, keeping any error to be thrown on the render thread
+	* \param pending the request, its pipeline, time and error are written
+	*/
+	void create(pipeline_request& pending) const;
+
+	/**
+	* \brief Destroy every pipeline that is ready or finished
+	*/
+	void destroy_pipelines();
+};
+
+#endif
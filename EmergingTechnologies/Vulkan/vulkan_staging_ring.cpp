@@ -0,0 +1,502 @@
+#include "vulkan_staging_ring.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+//every copy starts on a 16 byte boundary, which satisfies the offset rules of buffer and image copies
+static const VkDeviceSize copy_alignment = 16;
+
+/**
+* \brief Create a command pool for short lived command buffers that are reset individually
+* \param device the logical device
+* \param queue_family the queue family the command buffers will be submitted to
+* \return the command pool
+*/
+static VkCommandPool create_transient_command_pool(const VkDevice device, const uint32_t queue_family)
+{
+	VkCommandPoolCreateInfo vk_command_pool_create_info = {};
+	vk_command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	vk_command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	vk_command_pool_create_info.queueFamilyIndex = queue_family;
+
+	VkCommandPool command_pool;
+	if (vkCreateCommandPool(device, &vk_command_pool_create_info, nullptr, &command_pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create staging command pool!");
+	}
+	return command_pool;
+}
+
+/**
+* \brief Allocate a primary command buffer and an unsignalled fence to track its execution
+* \param device the logical device
+* \param command_pool the pool to allocate the command buffer from
+* \param command_buffer the command buffer
+* \param fence the fence
+*/
+static void create_tracked_command_buffer(const VkDevice device, const VkCommandPool command_pool,
+                                          VkCommandBuffer& command_buffer, VkFence& fence)
+{
+	VkCommandBufferAllocateInfo vk_command_buffer_allocate_info = {};
+	vk_command_buffer_allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	vk_command_buffer_allocate_info.commandPool = command_pool;
+	vk_command_buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	vk_command_buffer_allocate_info.commandBufferCount = 1;
+
+	VkFenceCreateInfo vk_fence_create_info = {};
+	vk_fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	if (vkAllocateCommandBuffers(device, &vk_command_buffer_allocate_info, &command_buffer) != VK_SUCCESS ||
+		vkCreateFence(device, &vk_fence_create_info, nullptr, &fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create staging batch!");
+	}
+}
+
+void vulkan_staging_ring::init(const VkDevice device, vulkan_memory_allocator& allocator, const uint32_t queue_family,
+                               const VkQueue queue, const uint32_t dst_queue_family, const VkQueue dst_queue,
+                               const VkDeviceSize size)
+{
+	device_ = device;
+	allocator_ = &allocator;
+	queue_family_ = queue_family;
+	queue_ = queue;
+	dst_queue_family_ = dst_queue_family;
+	dst_queue_ = dst_queue;
+	size_ = size;
+
+	//the copies are recorded for the upload queue, the acquires for the queue that uses the resources
+	command_pool_ = create_transient_command_pool(device_, queue_family_);
+	if (transfers_ownership())
+	{
+		dst_command_pool_ = create_transient_command_pool(device_, dst_queue_family_);
+	}
+
+	//create the staging buffer, its memory stays mapped for the lifetime of the ring
+	VkBufferCreateInfo vk_buffer_create_info = {};
+	vk_buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	vk_buffer_create_info.size = size_;
+	vk_buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	vk_buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device_, &vk_buffer_create_info, nullptr, &buffer_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create staging buffer!");
+	}
+
+	//the CPU writes straight into the ring, so it has to be host visible and coherent
+	VkMemoryRequirements vk_memory_requirements;
+	vkGetBufferMemoryRequirements(device_, buffer_, &vk_memory_requirements);
+	const auto memory_type = allocator_->find_memory_type(vk_memory_requirements.memoryTypeBits,
+	                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+	                                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	allocation_ = allocator_->allocate(vk_memory_requirements, memory_type, allocation_kind::linear);
+	vkBindBufferMemory(device_, buffer_, allocation_.memory, allocation_.offset);
+}
+
+void vulkan_staging_ring::destroy()
+{
+	wait_idle();
+
+	//freeing the command pools frees all of their command buffers
+	for (const auto& batch : free_batches_)
+	{
+		vkDestroyFence(device_, batch.fence, nullptr);
+		if (batch.transferred != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(device_, batch.transferred, nullptr);
+			vkDestroyFence(device_, batch.acquire_fence, nullptr);
+		}
+	}
+	free_batches_.clear();
+	vkDestroyCommandPool(device_, command_pool_, nullptr);
+	if (dst_command_pool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(device_, dst_command_pool_, nullptr);
+	}
+
+	vkDestroyBuffer(device_, buffer_, nullptr);
+	allocator_->free(allocation_);
+}
+
+void vulkan_staging_ring::upload_buffer(const VkBuffer dst_buffer, VkDeviceSize dst_offset, const void* data,
+                                        VkDeviceSize size)
+{
+	auto bytes = static_cast<const char*>(data);
+
+	//data larger than the ring is uploaded in pieces of at most half the ring, so a piece always fits
+	//while the previous one is still being copied
+	while (size > 0)
+	{
+		const auto chunk_size = std::min(size, size_ / 2);
+		const auto ring_offset = reserve(chunk_size);
+		memcpy(static_cast<char*>(allocation_.mapped) + ring_offset, bytes, static_cast<size_t>(chunk_size));
+
+		VkBufferCopy vk_buffer_copy = {};
+		vk_buffer_copy.srcOffset = ring_offset;
+		vk_buffer_copy.dstOffset = dst_offset;
+		vk_buffer_copy.size = chunk_size;
+		vkCmdCopyBuffer(recording_.command_buffer, buffer_, dst_buffer, 1, &vk_buffer_copy);
+
+		//the copied range has to be handed over to the queue family that reads it
+		if (transfers_ownership())
+		{
+			VkBufferMemoryBarrier vk_buffer_memory_barrier = {};
+			vk_buffer_memory_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			vk_buffer_memory_barrier.srcQueueFamilyIndex = queue_family_;
+			vk_buffer_memory_barrier.dstQueueFamilyIndex = dst_queue_family_;
+			vk_buffer_memory_barrier.buffer = dst_buffer;
+			vk_buffer_memory_barrier.offset = dst_offset;
+			vk_buffer_memory_barrier.size = chunk_size;
+			recording_.buffer_barriers.push_back(vk_buffer_memory_barrier);
+		}
+
+		bytes += chunk_size;
+		dst_offset += chunk_size;
+		size -= chunk_size;
+	}
+}
+
+void vulkan_staging_ring::upload_image(const VkImage dst_image, const VkExtent3D extent, const void* data,
+                                       const VkDeviceSize size, const VkImageLayout final_layout)
+{
+	if (size > size_)
+	{
+		throw std::runtime_error("image is too large for the staging ring!");
+	}
+
+	const auto ring_offset = reserve(size);
+	memcpy(static_cast<char*>(allocation_.mapped) + ring_offset, data, static_cast<size_t>(size));
+
+	//move the image into a layout that can be copied to, its previous contents are discarded
+	VkImageMemoryBarrier vk_image_memory_barrier = {};
+	vk_image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	vk_image_memory_barrier.srcAccessMask = 0;
+	vk_image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vk_image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	vk_image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	vk_image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	vk_image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	vk_image_memory_barrier.image = dst_image;
+	vk_image_memory_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	vk_image_memory_barrier.subresourceRange.levelCount = 1;
+	vk_image_memory_barrier.subresourceRange.layerCount = 1;
+	vkCmdPipelineBarrier(recording_.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     0, 0, nullptr, 0, nullptr, 1, &vk_image_memory_barrier);
+
+	//copy the tightly packed texels into the image
+	VkBufferImageCopy vk_buffer_image_copy = {};
+	vk_buffer_image_copy.bufferOffset = ring_offset;
+	vk_buffer_image_copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	vk_buffer_image_copy.imageSubresource.layerCount = 1;
+	vk_buffer_image_copy.imageExtent = extent;
+	vkCmdCopyBufferToImage(recording_.command_buffer, buffer_, dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+	                       &vk_buffer_image_copy);
+
+	//and move it into the layout it will be used in
+	vk_image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	vk_image_memory_barrier.newLayout = final_layout;
+	if (transfers_ownership())
+	{
+		//the layout change happens as part of the hand over, which is released when the batch is flushed
+		vk_image_memory_barrier.srcQueueFamilyIndex = queue_family_;
+		vk_image_memory_barrier.dstQueueFamilyIndex = dst_queue_family_;
+		recording_.image_barriers.push_back(vk_image_memory_barrier);
+	}
+	else
+	{
+		vk_image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vk_image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(recording_.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &vk_image_memory_barrier);
+	}
+}
+
+uint64_t vulkan_staging_ring::flush()
+{
+	//nothing has been recorded since the last flush
+	if (recording_.command_buffer == VK_NULL_HANDLE)
+	{
+		return next_batch_id_ - 1;
+	}
+
+	VkSubmitInfo vk_submit_info = {};
+	vk_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	vk_submit_info.commandBufferCount = 1;
+	vk_submit_info.pCommandBuffers = &recording_.command_buffer;
+
+	if (transfers_ownership())
+	{
+		//release the resources to the destination queue family, the matching acquire is recorded once the copies
+		//have finished. Release barriers only need to make the copies available, not visible
+		for (auto& barrier : recording_.buffer_barriers)
+		{
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+		}
+		for (auto& barrier : recording_.image_barriers)
+		{
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+		}
+		vkCmdPipelineBarrier(recording_.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+		                     static_cast<uint32_t>(recording_.buffer_barriers.size()), recording_.buffer_barriers.data(),
+		                     static_cast<uint32_t>(recording_.image_barriers.size()), recording_.image_barriers.data());
+
+		//the acquire on the destination queue waits on this semaphore
+		vk_submit_info.signalSemaphoreCount = 1;
+		vk_submit_info.pSignalSemaphores = &recording_.transferred;
+	}
+	else
+	{
+		//make the copied data visible to everything submitted to the queue afterwards
+		VkMemoryBarrier vk_memory_barrier = {};
+		vk_memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		vk_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vk_memory_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(recording_.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &vk_memory_barrier, 0, nullptr, 0, nullptr);
+	}
+
+	if (vkEndCommandBuffer(recording_.command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record staging command buffer!");
+	}
+
+	//submit every copy at once, the fence tells us when the ring space can be reused
+	if (vkQueueSubmit(queue_, 1, &vk_submit_info, recording_.fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit staging command buffer!");
+	}
+
+	//on a single queue family, anything submitted to the queue from now on sees the data
+	recording_.id = next_batch_id_++;
+	if (!transfers_ownership())
+	{
+		ready_batch_id_ = recording_.id;
+	}
+
+	in_flight_.push_back(recording_);
+	recording_ = upload_batch();
+	return in_flight_.back().id;
+}
+
+void vulkan_staging_ring::update()
+{
+	reclaim(false);
+}
+
+bool vulkan_staging_ring::is_ready(const uint64_t batch_id) const
+{
+	return batch_id <= ready_batch_id_;
+}
+
+void vulkan_staging_ring::wait_ready(const uint64_t batch_id)
+{
+	while (!is_ready(batch_id) && !in_flight_.empty())
+	{
+		acquire_transferred(true);
+	}
+}
+
+void vulkan_staging_ring::wait_idle()
+{
+	flush();
+	while (!in_flight_.empty())
+	{
+		reclaim(true);
+	}
+}
+
+VkDeviceSize vulkan_staging_ring::reserve(const VkDeviceSize size)
+{
+	reclaim(false);
+
+	for (;;)
+	{
+		//once nothing is in use start again from the beginning, so no space is skipped at the end
+		if (used_ == 0)
+		{
+			head_ = 0;
+		}
+
+		//the free space runs from the head around to the oldest data still in use, if the data does not fit
+		//before the end of the ring the end is skipped and the data goes at the start
+		const auto aligned_head = (head_ + copy_alignment - 1) & ~(copy_alignment - 1);
+		const auto wraps = aligned_head + size > size_;
+		const auto offset = wraps ? 0 : aligned_head;
+		const auto skipped = wraps ? size_ - head_ : aligned_head - head_;
+
+		if (used_ + skipped + size <= size_)
+		{
+			begin_recording();
+
+			head_ = offset + size;
+			used_ += skipped + size;
+			recording_.bytes += skipped + size;
+			return offset;
+		}
+
+		//the ring is full, so send what has been recorded and wait for the oldest upload to finish
+		flush();
+		if (in_flight_.empty())
+		{
+			throw std::runtime_error("staging ring is too small for the upload!");
+		}
+		reclaim(true);
+	}
+}
+
+void vulkan_staging_ring::begin_recording()
+{
+	if (recording_.command_buffer != VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//reuse a finished batch if there is one, otherwise create new command buffers and sync objects
+	if (!free_batches_.empty())
+	{
+		recording_ = free_batches_.back();
+		free_batches_.pop_back();
+		vkResetCommandBuffer(recording_.command_buffer, 0);
+		vkResetFences(device_, 1, &recording_.fence);
+	}
+	else
+	{
+		create_tracked_command_buffer(device_, command_pool_, recording_.command_buffer, recording_.fence);
+
+		if (transfers_ownership())
+		{
+			create_tracked_command_buffer(device_, dst_command_pool_, recording_.acquire_command_buffer,
+			                              recording_.acquire_fence);
+
+			VkSemaphoreCreateInfo vk_semaphore_create_info = {};
+			vk_semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			if (vkCreateSemaphore(device_, &vk_semaphore_create_info, nullptr, &recording_.transferred) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create staging batch!");
+			}
+		}
+	}
+	recording_.bytes = 0;
+	recording_.acquire_submitted = false;
+	recording_.buffer_barriers.clear();
+	recording_.image_barriers.clear();
+
+	VkCommandBufferBeginInfo vk_command_buffer_begin_info = {};
+	vk_command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	vk_command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(recording_.command_buffer, &vk_command_buffer_begin_info);
+}
+
+void vulkan_staging_ring::submit_acquire(upload_batch& batch)
+{
+	vkResetCommandBuffer(batch.acquire_command_buffer, 0);
+	vkResetFences(device_, 1, &batch.acquire_fence);
+
+	VkCommandBufferBeginInfo vk_command_buffer_begin_info = {};
+	vk_command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	vk_command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(batch.acquire_command_buffer, &vk_command_buffer_begin_info);
+
+	//the acquire barriers must match the release barriers, apart from the access masks which now make the
+	//data visible to whatever reads it on this queue
+	for (auto& barrier : batch.buffer_barriers)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	}
+	for (auto& barrier : batch.image_barriers)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	}
+	vkCmdPipelineBarrier(batch.acquire_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+	                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+	                     static_cast<uint32_t>(batch.buffer_barriers.size()), batch.buffer_barriers.data(),
+	                     static_cast<uint32_t>(batch.image_barriers.size()), batch.image_barriers.data());
+
+	if (vkEndCommandBuffer(batch.acquire_command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to record acquire command buffer!");
+	}
+
+	//wait for the release on the upload queue before acquiring
+	const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	VkSubmitInfo vk_submit_info = {};
+	vk_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	vk_submit_info.waitSemaphoreCount = 1;
+	vk_submit_info.pWaitSemaphores = &batch.transferred;
+	vk_submit_info.pWaitDstStageMask = &wait_stage;
+	vk_submit_info.commandBufferCount = 1;
+	vk_submit_info.pCommandBuffers = &batch.acquire_command_buffer;
+
+	if (vkQueueSubmit(dst_queue_, 1, &vk_submit_info, batch.acquire_fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit acquire command buffer!");
+	}
+
+	batch.acquire_submitted = true;
+	ready_batch_id_ = batch.id;
+}
+
+void vulkan_staging_ring::acquire_transferred(const bool wait_for_next)
+{
+	if (!transfers_ownership())
+	{
+		return;
+	}
+
+	//the acquire is only submitted once the copies have finished, so the destination queue never stalls
+	//waiting on the upload queue. Batches are acquired in the order they were submitted
+	auto waited = !wait_for_next;
+	for (auto& batch : in_flight_)
+	{
+		if (batch.acquire_submitted)
+		{
+			continue;
+		}
+
+		if (!waited)
+		{
+			vkWaitForFences(device_, 1, &batch.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			waited = true;
+		}
+		else if (vkGetFenceStatus(device_, batch.fence) != VK_SUCCESS)
+		{
+			break;
+		}
+
+		submit_acquire(batch);
+	}
+}
+
+void vulkan_staging_ring::reclaim(const bool wait_for_oldest)
+{
+	acquire_transferred(wait_for_oldest);
+
+	//a batch is finished once its acquire has executed, or its copies when there is no acquire
+	const auto finished_fence = [this](const upload_batch& batch)
+	{
+		return transfers_ownership() ? batch.acquire_fence : batch.fence;
+	};
+
+	if (wait_for_oldest && !in_flight_.empty())
+	{
+		const auto fence = finished_fence(in_flight_.front());
+		vkWaitForFences(device_, 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+
+	//batches finish in submission order, so stop at the first one that is still executing
+	while (!in_flight_.empty() && in_flight_.front().acquire_submitted == transfers_ownership() &&
+		vkGetFenceStatus(device_, finished_fence(in_flight_.front())) == VK_SUCCESS)
+	{
+		used_ -= in_flight_.front().bytes;
+		free_batches_.push_back(in_flight_.front());
+		in_flight_.pop_front();
+	}
+}
@@ -0,0 +1,186 @@
+/**
+* \class vulkan_staging_ring
+*
+* \brief Upload buffer and image data to device local memory through one persistently mapped staging buffer
+*
+* Data is copied into a ring of host visible memory and the copy commands are recorded
+* into a shared command buffer. Nothing is sent to the GPU until flush() is called, so any
+* number of uploads are executed by a single submission. Each submission is tracked by a
+* fence and its part of the ring is reused once the fence has signalled, so the CPU only
+* waits on the GPU when the ring is full.
+*
+* The copies can run on a dedicated transfer queue. The uploaded resources are then released
+* by the transfer queue family and acquired by the queue family that uses them. The acquire
+* is only submitted once the transfer has finished, so rendering on the other queue is never
+* held up by an upload that is still in progress.
+*/
+
+#ifndef VULKAN_STAGING_RING_H
+#define VULKAN_STAGING_RING_H
+
+#include <vulkan/vulkan.h>
+#include "vulkan_memory_allocator.h"
+
+#include <deque>
+#include <vector>
+
+class vulkan_staging_ring
+{
+public:
+	/**
+	* \brief Create the staging buffer and the command pool used to record copies
+	* \param device the logical device
+	* \param allocator the allocator to take the staging memory from
+	* \param queue_family the queue family the copies will be submitted to
+	* \param queue the queue the copies will be submitted to
+	* \param dst_queue_family the queue family that will use the uploaded resources
+	* \param dst_queue a queue of dst_queue_family, used to acquire the resources when the families differ
+	* \param size the size of the ring in bytes
+	*/
+	void init(const VkDevice device, vulkan_memory_allocator& allocator, const uint32_t queue_family,
+	          const VkQueue queue, const uint32_t dst_queue_family, const VkQueue dst_queue,
+	          const VkDeviceSize size = 32 * 1024 * 1024);
+
+	/**
+	* \brief Wait for all uploads to finish and destroy the ring
+	*/
+	void destroy();
+
+	/**
+	* \brief Queue a copy of data into a buffer. The data is copied into the ring straight away, so it can be
+	* released once this returns. Data larger than the ring is split over several submissions
+	* \param dst_buffer the buffer to copy to, it must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+	* \param dst_offset the offset in the buffer to copy to
+	* \param data the data to copy
+	* \param size the size of the data
+	*/
+	void upload_buffer(const VkBuffer dst_buffer, VkDeviceSize dst_offset, const void* data, VkDeviceSize size);
+
+	/**
+	* \brief Queue a copy of tightly packed texel data into the first mip level and layer of a 2D image. The image
+	* is transitioned from an undefined layout to final_layout
+	* \param dst_image the image to copy to, it must have been created with VK_IMAGE_USAGE_TRANSFER_DST_BIT
+	* \param extent the size of the image
+	* \param data the texel data
+	* \param size the size of the texel data, this has to fit in the ring
+	* \param final_layout the layout the image will be in once the copy has executed
+	*/
+	void upload_image(const VkImage dst_image, const VkExtent3D extent, const void* data, const VkDeviceSize size,
+	                  const VkImageLayout final_layout);
+
+	/**
+	* \brief Submit every queued copy in a single command buffer
+	* \return an id for the submission, which can be passed to is_ready and wait_ready
+	*/
+	uint64_t flush();
+
+	/**
+	* \brief Submit the acquire of any uploads whose transfer has finished and reuse the ring space of finished
+	* uploads. Call this once a frame, it never blocks
+	*/
+	void update();
+
+	/**
+	* \brief Check if the resources of a submission can be used by work submitted to the destination queue
+	* \param batch_id the id returned by flush
+	* \return true if the data is ready
+	*/
+	bool is_ready(const uint64_t batch_id) const;
+
+	/**
+	* \brief Block until the resources of a submission can be used by work submitted to the destination queue
+	* \param batch_id the id returned by flush
+	*/
+	void wait_ready(const uint64_t batch_id);
+
+	/**
+	* \brief Block until every submitted upload has finished executing
+	*/
+	void wait_idle();
+
+private:
+	/**
+	* \brief A submission of copies that may still be executing
+	*/
+	struct upload_batch
+	{
+		uint64_t id = 0;
+		VkCommandBuffer command_buffer = VK_NULL_HANDLE; //the copies, recorded for the transfer queue
+		VkFence fence = VK_NULL_HANDLE; //signalled when the copies have executed
+		VkDeviceSize bytes = 0; //the bytes of the ring used by the batch, including any skipped at the end of the ring
+
+		//Ownership transfer, only used when the queue families differ
+		VkSemaphore transferred = VK_NULL_HANDLE; //signalled by the copies, waited on by the acquire
+		VkCommandBuffer acquire_command_buffer = VK_NULL_HANDLE; //the acquire barriers for the destination queue
+		VkFence acquire_fence = VK_NULL_HANDLE; //signalled when the acquire has executed
+		bool acquire_submitted = false;
+		std::vector<VkBufferMemoryBarrier> buffer_barriers; //the buffers to hand over to the destination queue
+		std::vector<VkImageMemoryBarrier> image_barriers; //the images to hand over to the destination queue
+	};
+
+	VkDevice device_ = VK_NULL_HANDLE;
+	vulkan_memory_allocator* allocator_ = nullptr;
+
+	//Queues
+	uint32_t queue_family_ = 0;
+	VkQueue queue_ = VK_NULL_HANDLE;
+	uint32_t dst_queue_family_ = 0;
+	VkQueue dst_queue_ = VK_NULL_HANDLE;
+	VkCommandPool command_pool_ = VK_NULL_HANDLE;
+	VkCommandPool dst_command_pool_ = VK_NULL_HANDLE;
+
+	//The ring
+	VkBuffer buffer_ = VK_NULL_HANDLE;
+	memory_allocation allocation_;
+	VkDeviceSize size_ = 0;
+	VkDeviceSize head_ = 0; //where the next data will be written
+	VkDeviceSize used_ = 0; //the bytes written that the GPU may still read from
+
+	//Batches
+	upload_batch recording_; //the batch copies are currently being recorded into
+	std::deque<upload_batch> in_flight_; //submitted batches, oldest first
+	std::vector<upload_batch> free_batches_; //finished batches whose command buffers and fences can be reused
+	uint64_t next_batch_id_ = 1;
+	uint64_t ready_batch_id_ = 0; //every batch up to and including this id is ready on the destination queue
+
+	/**
+	* \brief Check if the resources have to be handed over between queue families
+	* \return true if the copies run on a different queue family than the one using the resources
+	*/
+	bool transfers_ownership() const
+	{
+		return queue_family_ != dst_queue_family_;
+	}
+
+	/**
+	* \brief Reserve space in the ring, flushing and waiting on older uploads if the ring is full
+	* \param size the number of bytes needed
+	* \return the offset of the space in the ring
+	*/
+	VkDeviceSize reserve(const VkDeviceSize size);
+
+	/**
+	* \brief Make sure the recording batch has a command buffer that is ready to record into
+	*/
+	void begin_recording();
+
+	/**
+	* \brief Record and submit the acquire barriers of a batch on the destination queue
+	* \param batch the batch whose copies have finished
+	*/
+	void submit_acquire(upload_batch& batch);
+
+	/**
+	* \brief Submit the acquires of batches whose copies have finished, in submission order
+	* \param wait_for_next if true block until the copies of the oldest batch that has not been acquired have finished
+	*/
+	void acquire_transferred(const bool wait_for_next);
+
+	/**
+	* \brief Submit the acquires of finished transfers and release the ring space of finished batches
+	* \param wait_for_oldest if true block until at least the oldest batch has finished
+	*/
+	void reclaim(const bool wait_for_oldest);
+};
+
+#endif